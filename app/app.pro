@@ -0,0 +1,54 @@
+QT += core gui widgets sql
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++17
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+TARGET = hinlibs
+
+include(../hinlibs_core.pri)
+
+# No -lsqlite3: the SysAdmin window's backups run in hinlibs-cli (see
+# maintenance.cpp), so nothing here links SQLite beside Qt's own copy.
+
+SRC = $$PWD/..
+
+SOURCES += \
+    $$SRC/homewindow.cpp \
+    $$SRC/librarianwindow.cpp \
+    $$SRC/main.cpp \
+    $$SRC/mainwindow.cpp \
+    $$SRC/patronwindow.cpp \
+    $$SRC/returnloansmodel.cpp \
+    $$SRC/sysadminwindow.cpp
+
+HEADERS += \
+    $$SRC/homewindow.h \
+    $$SRC/librarianwindow.h \
+    $$SRC/mainwindow.h \
+    $$SRC/patronwindow.h \
+    $$SRC/returnloansmodel.h \
+    $$SRC/sysadminwindow.h
+
+FORMS += \
+    $$SRC/homewindow.ui \
+    $$SRC/librarianwindow.ui \
+    $$SRC/mainwindow.ui \
+    $$SRC/patronwindow.ui \
+    $$SRC/sysadminwindow.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+RESOURCES += \
+    $$SRC/resources.qrc
+
+unix {
+    QMAKE_POST_LINK += cp $$shell_path($$SRC/hinlibs.sqlite3) $$shell_path($$OUT_PWD)
+}
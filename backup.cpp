@@ -0,0 +1,274 @@
+#include "backup.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace hinlibs {
+
+namespace {
+
+const char* const kTables[] = { "users", "items", "loans", "holds", "policy" };
+
+// A QSQLITE connection private to one call, removed again on scope exit.
+class ScopedConnection {
+public:
+    ScopedConnection(const QString& path, const QString& options) {
+        static std::atomic<int> serial{0};
+        name_ = QString("hinlibs-backup-%1").arg(serial++);
+        db_ = QSqlDatabase::addDatabase("QSQLITE", name_);
+        db_.setDatabaseName(path);
+        db_.setConnectOptions(options);
+        db_.open();
+    }
+    ~ScopedConnection() {
+        db_.close();
+        db_ = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name_);
+    }
+
+    QSqlDatabase& db() { return db_; }
+
+private:
+    QString name_;
+    QSqlDatabase db_;
+};
+
+// A connection opened through the sqlite3 C API that hinlibs links, for the
+// backup API. QSQLITE's own handle is not used: Qt may bundle a different
+// copy of SQLite, and a handle from one copy must not reach the other.
+class ScopedHandle {
+public:
+    ScopedHandle(const QString& path, int flags, int busyTimeoutMs) {
+        if (sqlite3_open_v2(path.toUtf8().constData(), &db_, flags, nullptr) != SQLITE_OK) {
+            error_ = db_ ? sqlite3_errmsg(db_) : "Out of memory";
+            sqlite3_close(db_);
+            db_ = nullptr;
+            return;
+        }
+        sqlite3_busy_timeout(db_, busyTimeoutMs);
+    }
+    ~ScopedHandle() { sqlite3_close(db_); }
+    ScopedHandle(const ScopedHandle&) = delete;
+    ScopedHandle& operator=(const ScopedHandle&) = delete;
+
+    sqlite3* get() const { return db_; }
+    const std::string& error() const { return error_; }
+
+private:
+    sqlite3* db_ = nullptr;
+    std::string error_;
+};
+
+bool checkFile(const QString& path, QHash<QString, qint64>* rows, QString* error) {
+    if (!QFile::exists(path)) {
+        *error = "No file at " + path;
+        return false;
+    }
+    ScopedConnection c(path, "QSQLITE_OPEN_READONLY");
+    if (!c.db().isOpen()) {
+        *error = c.db().lastError().text();
+        return false;
+    }
+    QSqlQuery check(c.db());
+    if (!check.exec("PRAGMA integrity_check") || !check.next()) {
+        *error = "integrity_check failed: " + check.lastError().text();
+        return false;
+    }
+    if (check.value(0).toString() != "ok") {
+        *error = "integrity_check: " + check.value(0).toString();
+        return false;
+    }
+    for (const char* table : kTables) {
+        QSqlQuery count(c.db());
+        if (!count.exec(QString("SELECT COUNT(*) FROM %1").arg(table)) || !count.next()) {
+            *error = QString("Table %1 is missing or unreadable").arg(table);
+            return false;
+        }
+        if (rows) rows->insert(table, count.value(0).toLongLong());
+    }
+    return true;
+}
+
+// Copies src into dst step by step, filling in the copy metrics.
+bool copyPages(sqlite3* src, sqlite3* dst, const BackupOptions& options, BackupReport* out) {
+    sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main");
+    if (!backup) {
+        out->error = sqlite3_errmsg(dst);
+        return false;
+    }
+
+    int pages = std::max(options.pagesPerStep, 1);
+    int lastRemaining = -1;
+    bool cancelled = false;
+    int rc;
+    for (;;) {
+        QElapsedTimer step;
+        step.start();
+        rc = sqlite3_backup_step(backup, pages);
+        const double ms = step.nsecsElapsed() / 1e6;
+        ++out->steps;
+        out->lockedSeconds += ms / 1000.0;
+        out->longestStepMs = std::max(out->longestStepMs, ms);
+
+        const int remaining = sqlite3_backup_remaining(backup);
+        const int total = sqlite3_backup_pagecount(backup);
+        // A write from another connection restarts the copy at page one
+        if (lastRemaining >= 0 && remaining > lastRemaining) ++out->restarts;
+        lastRemaining = remaining;
+
+        if (rc == SQLITE_DONE) break;
+        // Writes keep outrunning the copy: take the rest in one step, which
+        // holds the source's read lock until it is done
+        if (pages > 0 && out->restarts > std::max(options.maxRestarts, 0)) {
+            pages = -1;
+            out->finishedInOneStep = true;
+        }
+        if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            ++out->busyRetries;
+        } else if (rc != SQLITE_OK) {
+            break;
+        }
+        if (options.onStep) {
+            if (!options.onStep(total - remaining, total)) {
+                cancelled = true;
+                break;
+            }
+        } else if (options.pauseBetweenSteps.count() > 0) {
+            std::this_thread::sleep_for(options.pauseBetweenSteps);
+        }
+    }
+    out->pages = sqlite3_backup_pagecount(backup);
+    sqlite3_backup_finish(backup);
+
+    if (cancelled) {
+        out->error = "Cancelled";
+        return false;
+    }
+    if (rc != SQLITE_DONE) {
+        out->error = sqlite3_errstr(rc);
+        return false;
+    }
+    return true;
+}
+
+int pageSize(sqlite3* db) {
+    sqlite3_stmt* stmt = nullptr;
+    int size = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA page_size", -1, &stmt, nullptr) == SQLITE_OK
+        && sqlite3_step(stmt) == SQLITE_ROW) {
+        size = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return size;
+}
+
+// Copies between two freshly opened handles and fills in the size.
+bool copyFile(const QString& sourcePath, int sourceFlags, const QString& destPath,
+              const BackupOptions& options, BackupReport* out) {
+    ScopedHandle source(sourcePath, sourceFlags, 2000);
+    ScopedHandle dest(destPath, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, 2000);
+    if (!source.get() || !dest.get()) {
+        out->error = source.get() ? dest.error() : source.error();
+        return false;
+    }
+    const bool ok = copyPages(source.get(), dest.get(), options, out);
+    out->pageSize = pageSize(dest.get());
+    out->bytes = std::uint64_t(out->pages) * std::uint64_t(out->pageSize);
+    return ok;
+}
+
+} // namespace
+
+bool BackupDatabase(const QString& sourcePath, const QString& destPath,
+                    const BackupOptions& options, BackupReport* report) {
+    QElapsedTimer timer;
+    timer.start();
+    BackupReport out;
+    out.path = destPath.toStdString();
+    const QString partial = destPath + ".part";
+
+    QFile::remove(partial);
+    bool ok = copyFile(sourcePath, SQLITE_OPEN_READONLY, partial, options, &out);
+
+    if (ok && options.verify) {
+        QString why;
+        ok = out.verified = checkFile(partial, nullptr, &why);
+        if (!ok) out.error = "Copy failed verification: " + why.toStdString();
+    }
+    if (ok && !QFile::rename(partial, destPath)) {
+        ok = false;
+        out.error = "Cannot rename the copy to " + destPath.toStdString();
+    }
+    if (!ok) QFile::remove(partial);
+
+    out.seconds = timer.nsecsElapsed() / 1e9;
+    if (report) *report = out;
+    return ok;
+}
+
+bool RestoreDatabase(const QString& backupPath, const QString& targetPath,
+                     const BackupOptions& options, BackupReport* report) {
+    QElapsedTimer timer;
+    timer.start();
+    BackupReport out;
+    out.path = targetPath.toStdString();
+
+    // Never overwrite the live file with a bad copy
+    QHash<QString, qint64> expected;
+    QString why;
+    bool ok = checkFile(backupPath, &expected, &why);
+    if (!ok) out.error = "Backup failed verification: " + why.toStdString();
+
+    if (ok) ok = copyFile(backupPath, SQLITE_OPEN_READONLY, targetPath, options, &out);
+
+    if (ok) {
+        QHash<QString, qint64> restored;
+        ok = checkFile(targetPath, &restored, &why);
+        if (ok && restored != expected) {
+            ok = false;
+            why = "row counts differ from the backup";
+        }
+        out.verified = ok;
+        if (!ok) out.error = "Restored database failed verification: " + why.toStdString();
+    }
+
+    out.seconds = timer.nsecsElapsed() / 1e9;
+    if (report) *report = out;
+    return ok;
+}
+
+bool VerifyBackup(const QString& path, QString* error) {
+    QString why;
+    const bool ok = checkFile(path, nullptr, &why);
+    if (!ok && error) *error = why;
+    return ok;
+}
+
+QString BackupFileName(const QDateTime& when) {
+    return QString("hinlibs-%1.sqlite3").arg(when.toString("yyyyMMdd-hhmmss"));
+}
+
+QStringList RotateBackups(const QString& dir, int keep) {
+    QDir d(dir);
+    QStringList names = d.entryList({ "hinlibs-*-*.sqlite3" }, QDir::Files, QDir::Name);
+    QStringList removed;
+    while (names.size() > std::max(keep, 0)) {
+        const QString oldest = names.takeFirst();
+        if (d.remove(oldest)) removed << oldest;
+    }
+    return removed;
+}
+
+} // namespace hinlibs
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+
+namespace hinlibs {
+
+struct BackupOptions {
+    int pagesPerStep = 256;
+    // Sleep between steps; the source is unlocked while it lasts.
+    std::chrono::milliseconds pauseBetweenSteps{20};
+    // integrity_check the copy before it replaces anything.
+    bool verify = true;
+    // Each write to the source by another connection starts the copy over.
+    // After this many restarts the rest is copied in a single step instead,
+    // holding the source's read lock until it is done (in WAL mode writers
+    // still commit meanwhile).
+    int maxRestarts = 8;
+    // Called after every step with pages copied and total; return false to
+    // abandon the copy. When set, it is responsible for pausing.
+    std::function<bool(int copied, int total)> onStep;
+};
+
+struct BackupReport {
+    std::string path;               // the file written
+    int pages = 0;
+    int pageSize = 0;
+    std::uint64_t bytes = 0;
+    int steps = 0;
+    int busyRetries = 0;            // steps refused because a writer held the source
+    int restarts = 0;               // another connection wrote; copying began again
+    bool finishedInOneStep = false; // maxRestarts was reached
+    double seconds = 0.0;
+    // Time spent inside sqlite3_backup_step. Each step holds a read lock on
+    // the source, so in rollback-journal mode a writer committing then waits
+    // at most longestStepMs.
+    double lockedSeconds = 0.0;
+    double longestStepMs = 0.0;
+    bool verified = false;
+    std::string error;
+
+    double megabytesPerSecond() const { return seconds > 0 ? bytes / 1e6 / seconds : 0.0; }
+};
+
+// Copies the live database at sourcePath to destPath with SQLite's online
+// backup API, pagesPerStep pages at a time, so circulation keeps committing
+// while it runs. The copy is written to destPath + ".part" and only renamed
+// into place once complete (and verified, if asked).
+//
+// Both files are opened with the SQLite that hinlibs links (-lsqlite3), not
+// through QSQLITE. Don't call it from a process that has the database open
+// through QSQLITE: unless Qt was built against this same library, two copies
+// of SQLite would release each other's POSIX locks when one closes the file.
+// The desktop app runs `hinlibs-cli backup` instead (see MaintenanceService).
+bool BackupDatabase(const QString& sourcePath, const QString& destPath,
+                    const BackupOptions& options, BackupReport* report);
+
+// Checks backupPath, then copies it over targetPath the same way and checks
+// that every table has the row count the backup had. Run it with the app
+// closed: open connections would keep serving their caches.
+bool RestoreDatabase(const QString& backupPath, const QString& targetPath,
+                     const BackupOptions& options, BackupReport* report);
+
+// integrity_check passes and the HinLIBS tables are all present.
+bool VerifyBackup(const QString& path, QString* error = nullptr);
+
+// hinlibs-<yyyyMMdd-hhmmss>.sqlite3; names sort in time order.
+QString BackupFileName(const QDateTime& when);
+
+// Deletes all but the newest keep backups in dir. Returns the removed names.
+QStringList RotateBackups(const QString& dir, int keep);
+
+} // namespace hinlibs
@@ -0,0 +1,20 @@
+# Headless benchmark for the database layer; see main.cpp for options.
+
+QT -= gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = hinlibs-bench
+
+include(../hinlibs_core.pri)
+
+SOURCES += \
+    datagen.cpp \
+    main.cpp
+
+HEADERS += \
+    datagen.h \
+    zipf.h
+
+RESOURCES += \
+    bench.qrc
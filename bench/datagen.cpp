@@ -0,0 +1,226 @@
+#include "datagen.h"
+#include "zipf.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace hinlibs::bench {
+
+namespace {
+
+const char* const kWords[] = {
+    "Shadow", "River", "Garden", "Winter", "Empire", "Silent", "Glass", "Harbor",
+    "Northern", "Secret", "Iron", "Lost", "Golden", "Paper", "Stone", "Hidden",
+    "Summer", "Midnight", "Broken", "Distant", "Wild", "Last", "Crimson", "Quiet"
+};
+constexpr std::size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+const char* const kGenres[] = { "Classic", "Fantasy", "Romance", "Mystery", "Sci-Fi", "Drama", "Adventure" };
+const char* const kRatings[] = { "G", "PG", "PG-13", "R", "E", "E10+", "T", "M" };
+
+bool execOrFail(QSqlQuery& q, QString* error) {
+    if (q.exec()) return true;
+    if (error) *error = q.lastError().text();
+    return false;
+}
+
+// hinlibs.sql is bundled as a resource so the schema never drifts from the app's.
+bool createSchema(QSqlDatabase db, QString* error) {
+    QFile f(":/hinlibs.sql");
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Cannot read bundled hinlibs.sql";
+        return false;
+    }
+
+    QStringList lines;
+    for (const QString& line : QString::fromUtf8(f.readAll()).split('\n')) {
+        if (!line.trimmed().startsWith("--")) lines << line;
+    }
+
+    QSqlQuery q(db);
+    for (const QString& stmt : lines.join("\n").split(';')) {
+        if (stmt.trimmed().isEmpty()) continue;
+        if (!q.exec(stmt)) {
+            if (error) *error = q.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+QString isoDaysAgo(qint64 now, int days) {
+    return QDateTime::fromSecsSinceEpoch(now - qint64(days) * 86400, Qt::UTC).toString(Qt::ISODate);
+}
+
+} // namespace
+
+QString SyntheticItemId(std::size_t index) {
+    return QString("I%1").arg(qulonglong(index + 1), 7, 10, QLatin1Char('0'));
+}
+
+QString SyntheticPatronId(std::size_t index) {
+    return QString("U%1").arg(qulonglong(index + 1), 7, 10, QLatin1Char('0'));
+}
+
+QString SyntheticUsername(std::size_t index) {
+    return QString("patron%1").arg(qulonglong(index + 1), 7, 10, QLatin1Char('0'));
+}
+
+bool GenerateDataset(QSqlDatabase db, const DatasetConfig& config,
+                     DatasetStats* stats, QString* error) {
+    QElapsedTimer timer;
+    timer.start();
+
+    // Generation only: durability doesn't matter until the data is in.
+    QSqlQuery pragma(db);
+    pragma.exec("PRAGMA journal_mode=MEMORY");
+    pragma.exec("PRAGMA synchronous=OFF");
+
+    if (!createSchema(db, error)) return false;
+
+    std::mt19937_64 rng(config.seed);
+    std::uniform_int_distribution<int> percent(0, 99);
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+
+    DatasetStats out;
+    db.transaction();
+
+    // ---- Patrons ----
+    {
+        QSqlQuery ins(db);
+        ins.prepare("INSERT INTO users (id, username, role) VALUES (?, ?, 'Patron')");
+        for (std::size_t i = 0; i < config.patrons; ++i) {
+            ins.bindValue(0, SyntheticPatronId(i));
+            ins.bindValue(1, SyntheticUsername(i));
+            if (!execOrFail(ins, error)) { db.rollback(); return false; }
+        }
+        out.patrons = config.patrons;
+    }
+
+    // ---- Items ----
+    std::vector<bool> checkedOut(config.items, false);
+    {
+        QSqlQuery ins(db);
+        ins.prepare("INSERT INTO items (id, title, authorOrCreator, format, status, publicationYear, "
+                    "isbn, deweyDecimal, genre, rating, issueNumber, publicationDate) "
+                    "VALUES (?, ?, ?, ?, 'Available', ?, ?, ?, ?, ?, ?, ?)");
+        std::uniform_int_distribution<std::size_t> word(0, kWordCount - 1);
+        std::uniform_int_distribution<int> year(1850, 2025);
+        for (std::size_t i = 0; i < config.items; ++i) {
+            const int roll = percent(rng);
+            const QString format = roll < 60 ? "Book" : roll < 75 ? "Magazine" : roll < 90 ? "Movie" : "VideoGame";
+            const int y = year(rng);
+
+            ins.bindValue(0, SyntheticItemId(i));
+            ins.bindValue(1, QString("%1 %2 %3").arg(kWords[word(rng)], kWords[word(rng)]).arg(qulonglong(i + 1)));
+            ins.bindValue(2, QString("Author %1").arg(qulonglong(i % 5000 + 1)));
+            ins.bindValue(3, format);
+            ins.bindValue(4, y);
+            ins.bindValue(5, format == "Book" ? QVariant(QString("978%1").arg(qulonglong(i), 10, 10, QLatin1Char('0'))) : QVariant(QVariant::String));
+            ins.bindValue(6, format == "Book" && roll % 2 ? QVariant(QString("%1.%2").arg(roll * 9).arg(y % 100)) : QVariant(QVariant::String));
+            ins.bindValue(7, format != "Magazine" ? QVariant(kGenres[i % 7]) : QVariant(QVariant::String));
+            ins.bindValue(8, format == "Movie" || format == "VideoGame" ? QVariant(kRatings[i % 8]) : QVariant(QVariant::String));
+            ins.bindValue(9, format == "Magazine" ? QVariant(QString("%1-%2").arg(y).arg(i % 12 + 1)) : QVariant(QVariant::String));
+            ins.bindValue(10, format == "Magazine" ? QVariant(QString("%1-01-01").arg(y)) : QVariant(QVariant::String));
+            if (!execOrFail(ins, error)) { db.rollback(); return false; }
+        }
+        out.items = config.items;
+    }
+
+    // ---- Loans: popular items go out first, heavy readers borrow most ----
+    std::vector<std::size_t> loanedItems;
+    if (config.items > 0 && config.patrons > 0) {
+        const std::size_t maxLoans = std::min(config.loans, std::min(config.items, config.patrons * 3));
+        ZipfDistribution itemRank(config.items, config.zipfExponent);
+        ZipfDistribution patronRank(config.patrons, config.zipfExponent * 0.5);
+        std::vector<unsigned char> loansPerPatron(config.patrons, 0);
+        std::uniform_int_distribution<int> age(0, 28);
+
+        QSqlQuery ins(db);
+        ins.prepare("INSERT INTO loans (id, patronId, itemId, checkoutDate, dueDate) VALUES (?, ?, ?, ?, ?)");
+        QSqlQuery upd(db);
+        upd.prepare("UPDATE items SET status='CheckedOut' WHERE id=?");
+
+        std::size_t nextFreeItem = 0;
+        std::size_t nextFreePatron = 0;
+        while (loanedItems.size() < maxLoans) {
+            // Zipf picks collide on the head once it's all out; fall back to a scan.
+            std::size_t item = itemRank(rng) - 1;
+            for (int tries = 0; checkedOut[item] && tries < 8; ++tries) item = itemRank(rng) - 1;
+            while (checkedOut[item]) item = nextFreeItem++;
+
+            std::size_t patron = patronRank(rng) - 1;
+            for (int tries = 0; loansPerPatron[patron] >= 3 && tries < 8; ++tries) patron = patronRank(rng) - 1;
+            while (loansPerPatron[patron] >= 3) patron = nextFreePatron++;
+
+            checkedOut[item] = true;
+            ++loansPerPatron[patron];
+
+            const int daysOut = age(rng);
+            ins.bindValue(0, QString("L%1").arg(qulonglong(loanedItems.size() + 1)));
+            ins.bindValue(1, SyntheticPatronId(patron));
+            ins.bindValue(2, SyntheticItemId(item));
+            ins.bindValue(3, isoDaysAgo(now, daysOut));
+            ins.bindValue(4, isoDaysAgo(now, daysOut - 14));
+            if (!execOrFail(ins, error)) { db.rollback(); return false; }
+
+            upd.bindValue(0, SyntheticItemId(item));
+            if (!execOrFail(upd, error)) { db.rollback(); return false; }
+
+            loanedItems.push_back(item);
+        }
+        out.loans = loanedItems.size();
+    }
+
+    // ---- Holds: queue up behind the most popular checked-out items ----
+    if (!loanedItems.empty() && config.patrons > 0) {
+        std::sort(loanedItems.begin(), loanedItems.end());  // lower index = more popular
+        ZipfDistribution queueRank(loanedItems.size(), config.zipfExponent);
+        std::uniform_int_distribution<std::size_t> anyPatron(0, config.patrons - 1);
+        std::vector<std::uint32_t> queueLength(loanedItems.size(), 0);
+        std::unordered_set<std::uint64_t> seen;
+
+        QSqlQuery ins(db);
+        ins.prepare("INSERT INTO holds (id, patronId, itemId, queuePosition) VALUES (?, ?, ?, ?)");
+
+        const std::size_t wanted = std::min<std::size_t>(config.holds, loanedItems.size() * config.patrons);
+        std::size_t attempts = 0;
+        while (out.holds < wanted && attempts++ < wanted * 4) {
+            const std::size_t slot = queueRank(rng) - 1;
+            const std::size_t patron = anyPatron(rng);
+            const std::uint64_t key = std::uint64_t(slot) * config.patrons + patron;
+            if (!seen.insert(key).second) continue;
+
+            ins.bindValue(0, QString("H%1").arg(qulonglong(out.holds + 1)));
+            ins.bindValue(1, SyntheticPatronId(patron));
+            ins.bindValue(2, SyntheticItemId(loanedItems[slot]));
+            ins.bindValue(3, int(++queueLength[slot]));
+            if (!execOrFail(ins, error)) { db.rollback(); return false; }
+            ++out.holds;
+        }
+    }
+
+    if (!db.commit()) {
+        if (error) *error = db.lastError().text();
+        return false;
+    }
+
+    pragma.exec("PRAGMA journal_mode=DELETE");
+    pragma.exec("PRAGMA synchronous=FULL");
+    pragma.exec("ANALYZE");
+
+    out.seconds = timer.nsecsElapsed() / 1.0e9;
+    if (stats) *stats = out;
+    return true;
+}
+
+} // namespace hinlibs::bench
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <QSqlDatabase>
+#include <QString>
+
+namespace hinlibs::bench {
+
+// Size and shape of a synthetic library. Loans and holds follow a Zipf
+// popularity curve over items, so a few titles are always out with long
+// queues while the long tail sits on the shelf.
+struct DatasetConfig {
+    std::size_t items   = 100000;
+    std::size_t patrons = 20000;
+    std::size_t loans   = 30000;   // capped at 3 per patron and one per item
+    std::size_t holds   = 20000;   // only on checked-out items
+    double zipfExponent = 1.0;
+    std::uint64_t seed  = 42;
+};
+
+struct DatasetStats {
+    std::size_t items = 0;
+    std::size_t patrons = 0;
+    std::size_t loans = 0;
+    std::size_t holds = 0;
+    double seconds = 0.0;
+};
+
+// Creates the HinLIBS schema (plus the demo seed rows from hinlibs.sql) in an
+// empty, open SQLite database and bulk-inserts the synthetic rows.
+bool GenerateDataset(QSqlDatabase db, const DatasetConfig& config,
+                     DatasetStats* stats, QString* error);
+
+// Ids/usernames the generator assigns; index is 0-based.
+QString SyntheticItemId(std::size_t index);
+QString SyntheticPatronId(std::size_t index);
+QString SyntheticUsername(std::size_t index);
+
+} // namespace hinlibs::bench
@@ -0,0 +1,439 @@
+// hinlibs-bench: generates a synthetic library at a chosen scale and times
+// every public Database method against it. Results go to stdout (or --out)
+// as JSON so runs from different builds can be diffed.
+
+#include "database.h"
+#include "datagen.h"
+#include "item.h"
+#include "zipf.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <vector>
+
+// ---- Allocation counting (whole process) ----
+static std::atomic<std::uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace hinlibs;
+using namespace hinlibs::bench;
+
+namespace {
+
+// Collects per-call latencies for one method.
+class Sampler {
+public:
+    Sampler(QString method, const Database& db, std::size_t expected)
+        : method_(std::move(method)), db_(db) {
+        samplesNs_.reserve(expected);
+    }
+
+    // fn returns the number of rows the call produced.
+    template <typename Fn>
+    void run(Fn&& fn) {
+        const auto allocsBefore = g_allocations.load(std::memory_order_relaxed);
+        const auto stmtsBefore = db_.StatementCount();
+        QElapsedTimer timer;
+        timer.start();
+        rows_ += static_cast<std::uint64_t>(fn());
+        samplesNs_.push_back(timer.nsecsElapsed());
+        allocs_ += g_allocations.load(std::memory_order_relaxed) - allocsBefore;
+        statements_ += db_.StatementCount() - stmtsBefore;
+    }
+
+    QJsonObject result() {
+        QJsonObject o;
+        o["method"] = method_;
+        o["iterations"] = static_cast<qint64>(samplesNs_.size());
+        if (samplesNs_.empty()) return o;
+
+        std::sort(samplesNs_.begin(), samplesNs_.end());
+        qint64 total = 0;
+        for (auto ns : samplesNs_) total += ns;
+        const double n = static_cast<double>(samplesNs_.size());
+        auto pct = [&](double p) {
+            const auto idx = static_cast<std::size_t>(p * (samplesNs_.size() - 1));
+            return samplesNs_[idx] / 1.0e3;
+        };
+
+        o["p50Us"] = pct(0.50);
+        o["p99Us"] = pct(0.99);
+        o["maxUs"] = samplesNs_.back() / 1.0e3;
+        o["meanUs"] = total / n / 1.0e3;
+        o["opsPerSec"] = total > 0 ? n / (total / 1.0e9) : 0.0;
+        o["rowsPerSec"] = total > 0 ? rows_ / (total / 1.0e9) : 0.0;
+        o["rowsPerOp"] = rows_ / n;
+        o["allocsPerOp"] = allocs_ / n;
+        o["statementsPerOp"] = statements_ / n;
+        return o;
+    }
+
+private:
+    QString method_;
+    const Database& db_;
+    std::vector<qint64> samplesNs_;
+    std::uint64_t rows_ = 0;
+    std::uint64_t allocs_ = 0;
+    std::uint64_t statements_ = 0;
+};
+
+QStringList selectIds(QSqlDatabase db, const QString& sql) {
+    QStringList ids;
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    if (q.exec(sql)) {
+        while (q.next()) ids << q.value(0).toString();
+    }
+    return ids;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("hinlibs-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks every public Database method on a synthetic library.");
+    parser.addHelpOption();
+    QCommandLineOption scaleOpt("scale", "Preset: small (10k items), medium (100k), large (1M), huge (10M).", "preset");
+    QCommandLineOption itemsOpt("items", "Catalogue size.", "n");
+    QCommandLineOption patronsOpt("patrons", "Number of patrons.", "n");
+    QCommandLineOption loansOpt("loans", "Active loans.", "n");
+    QCommandLineOption holdsOpt("holds", "Active holds.", "n");
+    QCommandLineOption zipfOpt("zipf", "Popularity skew exponent (default 1.0).", "s");
+    QCommandLineOption seedOpt("seed", "Random seed.", "n");
+    QCommandLineOption iterOpt("iterations", "Calls per point-lookup method (default 2000).", "n");
+    QCommandLineOption scanOpt("scan-iterations", "Calls per full-catalogue method (default 5).", "n");
+    QCommandLineOption dbOpt("db", "SQLite file to generate into (default: temp file, removed afterwards).", "path");
+    QCommandLineOption outOpt("out", "Write JSON results here instead of stdout.", "path");
+    parser.addOptions({ scaleOpt, itemsOpt, patronsOpt, loansOpt, holdsOpt, zipfOpt, seedOpt,
+                        iterOpt, scanOpt, dbOpt, outOpt });
+    parser.process(app);
+
+    DatasetConfig config;
+    const QString scale = parser.value(scaleOpt);
+    const std::size_t presetItems = scale == "small" ? 10000 : scale == "large" ? 1000000
+                                  : scale == "huge" ? 10000000 : 100000;
+    config.items = presetItems;
+    config.patrons = presetItems / 5;
+    config.loans = presetItems * 3 / 10;
+    config.holds = presetItems / 5;
+    if (parser.isSet(itemsOpt)) config.items = parser.value(itemsOpt).toULongLong();
+    if (parser.isSet(patronsOpt)) config.patrons = parser.value(patronsOpt).toULongLong();
+    if (parser.isSet(loansOpt)) config.loans = parser.value(loansOpt).toULongLong();
+    if (parser.isSet(holdsOpt)) config.holds = parser.value(holdsOpt).toULongLong();
+    if (parser.isSet(zipfOpt)) config.zipfExponent = parser.value(zipfOpt).toDouble();
+    if (parser.isSet(seedOpt)) config.seed = parser.value(seedOpt).toULongLong();
+    const std::size_t iterations = parser.isSet(iterOpt) ? parser.value(iterOpt).toULongLong() : 2000;
+    const std::size_t scanIterations = parser.isSet(scanOpt) ? parser.value(scanOpt).toULongLong() : 5;
+
+    const bool tempDb = !parser.isSet(dbOpt);
+    const QString dbPath = tempDb ? QDir::temp().filePath(QString("hinlibs-bench-%1.sqlite3").arg(QCoreApplication::applicationPid()))
+                                  : parser.value(dbOpt);
+    QFile::remove(dbPath);
+
+    QTextStream err(stderr);
+    {
+        QSqlDatabase sqlDb = QSqlDatabase::addDatabase("QSQLITE", "bench");
+        sqlDb.setDatabaseName(dbPath);
+        if (!sqlDb.open()) {
+            err << "Cannot open " << dbPath << "\n";
+            return 1;
+        }
+
+        err << "Generating " << config.items << " items, " << config.patrons << " patrons, "
+            << config.loans << " loans, " << config.holds << " holds...\n";
+        err.flush();
+        DatasetStats stats;
+        QString error;
+        if (!GenerateDataset(sqlDb, config, &stats, &error)) {
+            err << "Generation failed: " << error << "\n";
+            return 1;
+        }
+
+        Database db(sqlDb);
+        std::mt19937_64 rng(config.seed + 1);
+        ZipfDistribution itemRank(std::max<std::size_t>(config.items, 1), config.zipfExponent);
+        std::uniform_int_distribution<std::size_t> anyPatron(0, config.patrons ? config.patrons - 1 : 0);
+        auto randomItem = [&] { return SyntheticItemId(itemRank(rng) - 1).toStdString(); };
+        auto randomPatron = [&] { return SyntheticPatronId(anyPatron(rng)).toStdString(); };
+
+        // Ids for round-trip benchmarks
+        const QStringList loanIds = selectIds(sqlDb, "SELECT id FROM loans LIMIT 1000");
+        const QStringList holdIds = selectIds(sqlDb, "SELECT id FROM holds LIMIT 1000");
+        const QStringList shelfItems = selectIds(sqlDb, "SELECT id FROM items WHERE status='Available' LIMIT 1000");
+        const QStringList outItems = selectIds(sqlDb, "SELECT itemId FROM loans LIMIT 1000");
+        const QStringList idlePatrons = selectIds(sqlDb,
+            "SELECT id FROM users WHERE role='Patron' AND id NOT IN (SELECT patronId FROM loans) "
+            "AND id NOT IN (SELECT patronId FROM holds) LIMIT 1");
+        const std::string benchPatron = idlePatrons.isEmpty() ? "U001" : idlePatrons.first().toStdString();
+
+        QJsonArray results;
+        auto record = [&](Sampler& s) {
+            const QJsonObject r = s.result();
+            results.append(r);
+            err << "  " << r["method"].toString() << "\n";
+            err.flush();
+        };
+
+        {
+            Sampler s("FindUserByName", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.FindUserByName(SyntheticUsername(anyPatron(rng)).toStdString()) ? 1 : 0; });
+            record(s);
+        }
+        {
+            // Same few usernames again: exercises the LRU cache
+            Sampler s("FindUserByName (cached)", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.FindUserByName(SyntheticUsername(i % 16).toStdString()) ? 1 : 0; });
+            record(s);
+        }
+        {
+            // A few typed characters past the common "patron" stem
+            Sampler s("CompleteUsernames", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.CompleteUsernames(SyntheticUsername(anyPatron(rng)).left(9).toStdString(), 10).size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetUserById", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetUserById(randomPatron()) ? 1 : 0; });
+            record(s);
+        }
+        {
+            Sampler s("GetCatalogueItems", db, scanIterations);
+            for (std::size_t i = 0; i < scanIterations; ++i)
+                s.run([&] { return db.GetCatalogueItems().size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetCatalogueSummaries", db, scanIterations);
+            for (std::size_t i = 0; i < scanIterations; ++i)
+                s.run([&] { return db.GetCatalogueSummaries().size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetAvailableCatalogue", db, scanIterations);
+            for (std::size_t i = 0; i < scanIterations; ++i)
+                s.run([&] { return db.GetAvailableCatalogue().size(); });
+            record(s);
+        }
+        {
+            // Fresh handles each call, so every one is stale and gets filled
+            Sampler s("HydrateItems (100 handles)", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i) {
+                std::vector<Item> handles;
+                handles.reserve(100);
+                for (int k = 0; k < 100; ++k) handles.emplace_back(&db, randomItem());
+                s.run([&] {
+                    db.HydrateItems(handles);
+                    return std::count_if(handles.begin(), handles.end(), [](const Item& h) { return h.isHydrated(); });
+                });
+            }
+            record(s);
+        }
+        {
+            Sampler s("GetItemDetails", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetItemDetails(randomItem()) ? 1 : 0; });
+            record(s);
+        }
+        {
+            Sampler s("GetItemSummary", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetItemSummary(randomItem()) ? 1 : 0; });
+            record(s);
+        }
+        {
+            Sampler s("GetActiveLoanCount", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetActiveLoanCount(randomPatron()); });
+            record(s);
+        }
+        {
+            Sampler s("GetFinesOwed", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetFinesOwed(randomPatron()) > 0 ? 1 : 0; });
+            record(s);
+        }
+        {
+            Sampler s("IsItemAvailable", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.IsItemAvailable(randomItem()) ? 1 : 0; });
+            record(s);
+        }
+        {
+            Sampler s("GetPatronAccountStatus", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { auto v = db.GetPatronAccountStatus(randomPatron()); return v.loans.size() + v.holds.size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetPatronDashboard", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { auto d = db.GetPatronDashboard(randomPatron()); return d.loans.size() + d.holds.size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetPatronActiveLoans", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetPatronActiveLoans(randomPatron()).size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetPatronLoansWithItems", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetPatronLoansWithItems(randomPatron()).size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetPatronActiveHolds", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetPatronActiveHolds(randomPatron()).size(); });
+            record(s);
+        }
+        {
+            Sampler s("GetHoldQueueForItem", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetHoldQueueForItem(randomItem()).size(); });
+            record(s);
+        }
+        if (!loanIds.isEmpty()) {
+            Sampler s("GetLoanById", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetLoanById(loanIds[int(i % loanIds.size())].toStdString()) ? 1 : 0; });
+            record(s);
+        }
+        if (!holdIds.isEmpty()) {
+            Sampler s("GetHoldById", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.GetHoldById(holdIds[int(i % holdIds.size())].toStdString()) ? 1 : 0; });
+            record(s);
+        }
+        {
+            Sampler s("MaxActiveLoansPerPatron", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.MaxActiveLoansPerPatron() ? 1 : 0; });
+            record(s);
+        }
+        {
+            Sampler s("LoanPeriodDays", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i)
+                s.run([&] { return db.LoanPeriodDays() ? 1 : 0; });
+            record(s);
+        }
+
+        // ---- Mutations, run as do/undo pairs so the dataset stays the same ----
+        if (!shelfItems.isEmpty()) {
+            Sampler checkout("CheckoutItem", db, iterations);
+            Sampler giveBack("ReturnItem", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i) {
+                const std::string item = shelfItems[int(i % shelfItems.size())].toStdString();
+                checkout.run([&] { return db.CheckoutItem(benchPatron, item).ok ? 1 : 0; });
+                giveBack.run([&] { return db.ReturnItem(benchPatron, item).ok ? 1 : 0; });
+            }
+            record(checkout);
+            record(giveBack);
+        }
+        if (!outItems.isEmpty()) {
+            Sampler place("PlaceHold", db, iterations);
+            Sampler cancel("CancelHold", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i) {
+                const std::string item = outItems[int(i % outItems.size())].toStdString();
+                place.run([&] { return db.PlaceHold(benchPatron, item).ok ? 1 : 0; });
+                cancel.run([&] { return db.CancelHold(benchPatron, item).ok ? 1 : 0; });
+            }
+            record(place);
+            record(cancel);
+        }
+        {
+            Sampler charge("ChargeFine", db, iterations);
+            Sampler settle("SettleFine", db, iterations);
+            for (std::size_t i = 0; i < iterations; ++i) {
+                charge.run([&] { return db.ChargeFine(benchPatron, 125).ok ? 1 : 0; });
+                settle.run([&] { return db.SettleFine(benchPatron, 125, FineSettlement::Payment).ok ? 1 : 0; });
+            }
+            record(charge);
+            record(settle);
+        }
+        {
+            Sampler add("AddItem", db, iterations);
+            Sampler remove("RemoveItem", db, iterations);
+            ItemDetails d{};
+            d.title = "Benchmark Item";
+            d.authorOrCreator = "hinlibs-bench";
+            d.format = ItemFormat::Book;
+            d.status = ItemStatus::Available;
+            for (std::size_t i = 0; i < iterations; ++i) {
+                ItemId added;
+                add.run([&] { auto r = db.AddItem(d); if (r.ok && r.value) added = *r.value; return r.ok ? 1 : 0; });
+                remove.run([&] { return !added.empty() && db.RemoveItem(added).ok ? 1 : 0; });
+            }
+            record(add);
+            record(remove);
+        }
+
+        QJsonObject dataset;
+        dataset["items"] = static_cast<qint64>(stats.items);
+        dataset["patrons"] = static_cast<qint64>(stats.patrons);
+        dataset["loans"] = static_cast<qint64>(stats.loans);
+        dataset["holds"] = static_cast<qint64>(stats.holds);
+        dataset["zipfExponent"] = config.zipfExponent;
+        dataset["seed"] = static_cast<qint64>(config.seed);
+        dataset["generationSeconds"] = stats.seconds;
+        dataset["rowsPerSec"] = stats.seconds > 0
+            ? (stats.items + stats.patrons + stats.loans + stats.holds) / stats.seconds : 0.0;
+
+        QJsonObject root;
+        root["tool"] = "hinlibs-bench";
+        root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        root["dataset"] = dataset;
+        root["iterations"] = static_cast<qint64>(iterations);
+        root["scanIterations"] = static_cast<qint64>(scanIterations);
+        root["results"] = results;
+
+        const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+        if (parser.isSet(outOpt)) {
+            QFile out(parser.value(outOpt));
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                err << "Cannot write " << parser.value(outOpt) << "\n";
+                return 1;
+            }
+            out.write(json);
+        } else {
+            QTextStream(stdout) << json;
+        }
+
+        sqlDb.close();
+    }
+    QSqlDatabase::removeDatabase("bench");
+    if (tempDb) QFile::remove(dbPath);
+    return 0;
+}
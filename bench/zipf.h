@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+namespace hinlibs::bench {
+
+// Zipf-distributed ranks in [1, n] with O(1) memory, using rejection-inversion
+// (Hörmann & Derflinger, 1996). Rank 1 is the most popular.
+class ZipfDistribution {
+public:
+    ZipfDistribution(std::uint64_t n, double exponent)
+        : n_(n ? n : 1), exponent_(exponent) {
+        hIntegralX1_ = hIntegral(1.5) - 1.0;
+        hIntegralN_ = hIntegral(static_cast<double>(n_) + 0.5);
+        s_ = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    template <typename Rng>
+    std::uint64_t operator()(Rng& rng) const {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        while (true) {
+            const double u = hIntegralN_ + unit(rng) * (hIntegralX1_ - hIntegralN_);
+            const double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            if (k < 1.0) k = 1.0;
+            else if (k > static_cast<double>(n_)) k = static_cast<double>(n_);
+            if (k - x <= s_ || u >= hIntegral(k + 0.5) - h(k)) {
+                return static_cast<std::uint64_t>(k);
+            }
+        }
+    }
+
+    std::uint64_t size() const { return n_; }
+
+private:
+    double h(double x) const { return std::exp(-exponent_ * std::log(x)); }
+
+    double hIntegral(double x) const {
+        const double logX = std::log(x);
+        return helper2((1.0 - exponent_) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        double t = x * (1.0 - exponent_);
+        if (t < -1.0) t = -1.0;
+        return std::exp(helper1(t) * x);
+    }
+
+    // log1p(x)/x and expm1(x)/x, stable near zero
+    static double helper1(double x) {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+    static double helper2(double x) {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+    }
+
+    std::uint64_t n_;
+    double exponent_;
+    double hIntegralX1_;
+    double hIntegralN_;
+    double s_;
+};
+
+} // namespace hinlibs::bench
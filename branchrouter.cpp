@@ -0,0 +1,599 @@
+#include "branchrouter.h"
+#include "database.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace hinlibs {
+
+// Schema of a branch file. It is the full HinLIBS schema so Database can run
+// unchanged against it; only items, loans, holds, policy and fineRates are
+// populated. users stays empty: fine balances live in the home database, and
+// the router settles branch fines there (see ReturnItem).
+static const char* const kShardSchema[] = {
+    "CREATE TABLE IF NOT EXISTS users (id TEXT PRIMARY KEY, username TEXT UNIQUE NOT NULL, role TEXT NOT NULL)",
+    "CREATE TABLE IF NOT EXISTS items (id TEXT PRIMARY KEY, title TEXT NOT NULL, authorOrCreator TEXT,"
+    " format TEXT NOT NULL, status TEXT NOT NULL, publicationYear INTEGER, isbn TEXT, deweyDecimal TEXT,"
+    " genre TEXT, rating TEXT, issueNumber TEXT, publicationDate TEXT)",
+    "CREATE TABLE IF NOT EXISTS loans (id TEXT PRIMARY KEY, patronId TEXT NOT NULL, itemId TEXT NOT NULL,"
+    " checkoutDate TEXT NOT NULL, dueDate TEXT NOT NULL)",
+    "CREATE TABLE IF NOT EXISTS holds (id TEXT PRIMARY KEY, patronId TEXT NOT NULL, itemId TEXT NOT NULL,"
+    " queuePosition INTEGER NOT NULL)",
+    "CREATE TABLE IF NOT EXISTS policy (maxActiveLoansPerPatron INTEGER, loanPeriodDays INTEGER,"
+    " fineThresholdCents INTEGER)",
+    "CREATE TABLE IF NOT EXISTS fineRates (format TEXT PRIMARY KEY, centsPerDay INTEGER NOT NULL,"
+    " maxCentsPerLoan INTEGER NOT NULL)",
+    "CREATE TABLE IF NOT EXISTS pendingFines (id INTEGER PRIMARY KEY AUTOINCREMENT, patronId TEXT NOT NULL,"
+    " cents INTEGER NOT NULL)",
+    "CREATE INDEX IF NOT EXISTS idx_items_title ON items(title)",
+    "CREATE INDEX IF NOT EXISTS idx_loans_patron ON loans(patronId)",
+    "CREATE INDEX IF NOT EXISTS idx_holds_item ON holds(itemId, queuePosition)",
+    "CREATE INDEX IF NOT EXISTS idx_holds_patron_item ON holds(patronId, itemId)",
+};
+
+// ----- Shard: one database file, one connection, one thread -----
+// QSqlDatabase connections may only be used from the thread that opened
+// them, so every call against a shard is posted to its thread.
+class BranchRouter::Shard {
+public:
+    Shard(QString path, QString connection, QStringList setupSql)
+        : connection_(std::move(connection)) {
+        std::promise<bool> ready;
+        auto opened = ready.get_future();
+        thread_ = std::thread([this, path = std::move(path), setupSql = std::move(setupSql), &ready]() {
+            loop(path, setupSql, ready);
+        });
+        open_ = opened.get();
+    }
+
+    ~Shard() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    bool isOpen() const { return open_; }
+    // Why opening failed; empty when open.
+    const QString& error() const { return error_; }
+
+    // fn(Database&) runs on the shard's thread.
+    template <typename F>
+    auto run(F fn) -> std::future<decltype(fn(std::declval<Database&>()))> {
+        using R = decltype(fn(std::declval<Database&>()));
+        auto task = std::make_shared<std::packaged_task<R()>>([this, fn = std::move(fn)]() mutable { return fn(*db_); });
+        auto result = task->get_future();
+        post([task]() { (*task)(); });
+        return result;
+    }
+
+    // fn(QSqlDatabase&) for the few statements Database has no method for.
+    template <typename F>
+    auto runSql(F fn) -> std::future<decltype(fn(std::declval<QSqlDatabase&>()))> {
+        using R = decltype(fn(std::declval<QSqlDatabase&>()));
+        auto task = std::make_shared<std::packaged_task<R()>>([this, fn = std::move(fn)]() mutable { return fn(sql_); });
+        auto result = task->get_future();
+        post([task]() { (*task)(); });
+        return result;
+    }
+
+private:
+    void post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    void loop(const QString& path, const QStringList& setupSql, std::promise<bool>& ready) {
+        {
+            sql_ = QSqlDatabase::addDatabase("QSQLITE", connection_);
+            sql_.setDatabaseName(path);
+            bool ok = sql_.open();
+            if (!ok) error_ = QString("Cannot open %1: %2").arg(path, sql_.lastError().text());
+            for (const QString& stmt : setupSql) {
+                if (!ok) break;
+                QSqlQuery q(sql_);
+                ok = q.exec(stmt);
+                if (!ok) error_ = QString("Cannot set up %1: %2").arg(path, q.lastError().text());
+            }
+            if (ok) db_ = std::make_unique<Database>(sql_);
+            ready.set_value(ok);
+
+            while (ok) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                    if (queue_.empty()) break;
+                    job = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+                job();
+            }
+
+            db_.reset();
+            sql_.close();
+            sql_ = QSqlDatabase();
+        }
+        QSqlDatabase::removeDatabase(connection_);
+    }
+
+    QString connection_;
+    QSqlDatabase sql_;
+    std::unique_ptr<Database> db_;
+    bool open_ = false;
+    QString error_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_ = false;
+};
+
+// ----- construction -----
+BranchRouter::BranchRouter(QString homePath, QString shardDir)
+    : homePath_(std::move(homePath)), shardDir_(std::move(shardDir)) {}
+
+BranchRouter::~BranchRouter() = default;
+
+bool BranchRouter::Open(QString* error) {
+    if (!QDir().mkpath(shardDir_)) {
+        if (error) *error = "Cannot create " + shardDir_;
+        return false;
+    }
+
+    auto home = std::make_unique<Shard>(
+        homePath_, QString("hinlibs-home-%1").arg(reinterpret_cast<quintptr>(this)),
+        QStringList{ "CREATE TABLE IF NOT EXISTS branches (code TEXT PRIMARY KEY, name TEXT NOT NULL)" });
+    if (!home->isOpen()) {
+        if (error) *error = home->error();
+        return false;
+    }
+
+    auto branches = home->runSql([](QSqlDatabase& sql) {
+        std::vector<BranchInfo> out;
+        QSqlQuery q(sql);
+        if (q.exec("SELECT code, name FROM branches ORDER BY code")) {
+            while (q.next()) out.push_back({ q.value(0).toString().toStdString(), q.value(1).toString().toStdString() });
+        }
+        return out;
+    }).get();
+    maxLoans_ = static_cast<int>(home->run([](Database& db) { return db.MaxActiveLoansPerPatron(); }).get());
+    loanDays_ = home->run([](Database& db) { return db.LoanPeriodDays(); }).get();
+    finePolicy_ = home->runSql([](QSqlDatabase& sql) {
+        FinePolicy policy;
+        QSqlQuery q(sql);
+        if (q.exec("SELECT fineThresholdCents FROM policy") && q.next()) policy.thresholdCents = q.value(0);
+        if (q.exec("SELECT format, centsPerDay, maxCentsPerLoan FROM fineRates")) {
+            while (q.next()) policy.rates.push_back({ q.value(0), q.value(1), q.value(2) });
+        }
+        return policy;
+    }).get();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    branches_ = std::move(branches);
+    shards_[""] = std::move(home);
+    return true;
+}
+
+// ----- Branches -----
+std::vector<BranchInfo> BranchRouter::Branches() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return branches_;
+}
+
+OperationResult BranchRouter::AddBranch(const std::string& code, const std::string& name) {
+    OperationResult r;
+    const bool valid = !code.empty() && std::all_of(code.begin(), code.end(), [](unsigned char c) { return std::isalnum(c); });
+    if (!valid) {
+        r.ok = false; r.message = "Branch code must be letters and digits"; return r;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& b : branches_) {
+            if (b.code == code) { r.ok = false; r.message = "Branch already exists"; return r; }
+        }
+    }
+
+    Shard* home = shard("");
+    const bool inserted = home && home->runSql([&](QSqlDatabase& sql) {
+        QSqlQuery q(sql);
+        q.prepare("INSERT INTO branches (code, name) VALUES (?, ?)");
+        q.addBindValue(QString::fromStdString(code));
+        q.addBindValue(QString::fromStdString(name));
+        return q.exec();
+    }).get();
+    if (!inserted) {
+        r.ok = false; r.message = "Insert failed"; return r;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        branches_.push_back({ code, name });
+    }
+    if (!shard(code)) {
+        r.ok = false; r.error = CirculationError::StorageError; r.message = shardError(code); return r;
+    }
+    r.ok = true;
+    return r;
+}
+
+QString BranchRouter::shardPath(const std::string& code) const {
+    return QDir(shardDir_).filePath(QString("hinlibs-%1.sqlite3").arg(QString::fromStdString(code)));
+}
+
+BranchRouter::Shard* BranchRouter::shard(const std::string& branch) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = shards_.find(branch);
+    if (it != shards_.end()) return it->second.get();
+
+    const bool known = std::any_of(branches_.begin(), branches_.end(), [&](const BranchInfo& b) { return b.code == branch; });
+    if (!known) return nullptr;
+
+    QStringList setup;
+    for (const char* stmt : kShardSchema) setup << stmt;
+    setup << QString("INSERT INTO policy (maxActiveLoansPerPatron, loanPeriodDays) SELECT %1, %2 WHERE NOT EXISTS (SELECT 1 FROM policy)").arg(maxLoans_).arg(loanDays_);
+
+    auto s = std::make_unique<Shard>(
+        shardPath(branch),
+        QString("hinlibs-shard-%1-%2").arg(reinterpret_cast<quintptr>(this)).arg(QString::fromStdString(branch)),
+        setup);
+    if (!s->isOpen()) {
+        openErrors_[branch] = s->error().toStdString();
+        return nullptr;
+    }
+    // Fines follow the home database's threshold and rates, whatever the
+    // branch file was created with
+    const QString copyError = s->runSql([policy = finePolicy_](QSqlDatabase& sql) {
+        QSqlQuery q(sql);
+        bool ok = sql.transaction();
+        if (ok) {
+            q.prepare("UPDATE policy SET fineThresholdCents = ?");
+            q.addBindValue(policy.thresholdCents);
+            ok = q.exec() && q.exec("DELETE FROM fineRates");
+        }
+        if (ok) q.prepare("INSERT INTO fineRates (format, centsPerDay, maxCentsPerLoan) VALUES (?, ?, ?)");
+        for (const auto& rate : policy.rates) {
+            if (!ok) break;
+            for (const QVariant& v : rate) q.addBindValue(v);
+            ok = q.exec();
+        }
+        if (ok && sql.commit()) return QString();
+        const QString why = q.lastError().text();
+        sql.rollback();
+        return why.isEmpty() ? sql.lastError().text() : why;
+    }).get();
+    if (!copyError.isEmpty()) {
+        openErrors_[branch] = QString("Cannot copy the fine policy to %1: %2").arg(shardPath(branch), copyError).toStdString();
+        return nullptr;
+    }
+    // Fines from returns whose move home was cut short last time
+    auto home = shards_.find("");
+    if (home != shards_.end()) {
+        const std::string why = movePendingFines(branch, *s, *home->second);
+        if (!why.empty()) qDebug() << "Branch" << QString::fromStdString(branch) << "fines stay pending:" << QString::fromStdString(why);
+    }
+    openErrors_.erase(branch);
+    return (shards_[branch] = std::move(s)).get();
+}
+
+// Charges each of the branch's pending fines at home, then clears it from
+// the branch. The charge is keyed "<branch>:<id>", so if the clear is lost
+// the next attempt finds it already charged. Returns the first failure.
+std::string BranchRouter::movePendingFines(const std::string& branch, Shard& from, Shard& home) {
+    std::string failure;
+    const auto pending = from.run([](Database& db) { return db.GetPendingFines(); }).get();
+    for (const PendingFine& fine : pending) {
+        const std::string reference = branch + ":" + std::to_string(fine.id);
+        const auto charged = home.run([fine, reference](Database& db) {
+            return db.ChargeFine(fine.patronId, fine.cents, reference);
+        }).get();
+        if (!charged.ok) {
+            if (failure.empty()) failure = charged.message;
+            continue;
+        }
+        from.run([id = fine.id](Database& db) { return db.ClearPendingFine(id); }).get();
+    }
+    return failure;
+}
+
+std::string BranchRouter::shardError(const std::string& branch) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = openErrors_.find(branch);
+    return it == openErrors_.end() ? std::string() : it->second;
+}
+
+// A null shard is either an unknown branch (the caller's own error) or one
+// whose file would not open (StorageError with the reason).
+template <typename R>
+static bool storageFailure(const std::string& why, R* r) {
+    if (why.empty()) return false;
+    r->ok = false; r->error = CirculationError::StorageError; r->message = why;
+    return true;
+}
+
+std::vector<std::pair<std::string, BranchRouter::Shard*>> BranchRouter::allShards() const {
+    std::vector<std::string> codes{ "" };
+    for (const auto& b : Branches()) codes.push_back(b.code);
+
+    std::vector<std::pair<std::string, Shard*>> out;
+    for (const auto& code : codes) {
+        if (Shard* s = shard(code)) out.emplace_back(code, s);
+    }
+    return out;
+}
+
+// ----- Item ids -----
+ItemId BranchRouter::GlobalItemId(const std::string& branch, const ItemId& localId) {
+    return branch.empty() ? localId : branch + "." + localId;
+}
+
+std::pair<std::string, ItemId> BranchRouter::SplitItemId(const ItemId& itemId) {
+    const auto dot = itemId.find('.');
+    if (dot == std::string::npos) return { std::string{}, itemId };
+    return { itemId.substr(0, dot), itemId.substr(dot + 1) };
+}
+
+// Runs fn on every shard at once and collects {branch, result} in shard order.
+template <typename Shards, typename F>
+static auto fanOut(const Shards& shards, F fn) {
+    using R = decltype(fn(std::declval<Database&>()));
+    std::vector<std::future<R>> pending;
+    pending.reserve(shards.size());
+    for (const auto& entry : shards) pending.push_back(entry.second->run(fn));
+
+    std::vector<std::pair<std::string, R>> out;
+    out.reserve(shards.size());
+    for (std::size_t i = 0; i < shards.size(); ++i) out.emplace_back(shards[i].first, pending[i].get());
+    return out;
+}
+
+// ----- Session / Identification -----
+std::optional<UserRecord> BranchRouter::FindUserByName(const std::string& username) const {
+    Shard* home = shard("");
+    if (!home) return std::nullopt;
+    return home->run([username](Database& db) { return db.FindUserByName(username); }).get();
+}
+
+std::optional<UserRecord> BranchRouter::GetUserById(const UserId& id) const {
+    Shard* home = shard("");
+    if (!home) return std::nullopt;
+    return home->run([id](Database& db) { return db.GetUserById(id); }).get();
+}
+
+// ----- Catalogue -----
+static std::vector<ItemSummary> mergeByTitle(std::vector<std::pair<std::string, std::vector<ItemSummary>>> parts) {
+    std::vector<ItemSummary> out;
+    for (auto& [code, items] : parts) {
+        for (auto& s : items) {
+            s.id = BranchRouter::GlobalItemId(code, s.id);
+            out.push_back(std::move(s));
+        }
+    }
+    std::stable_sort(out.begin(), out.end(), [](const ItemSummary& a, const ItemSummary& b) { return a.title < b.title; });
+    return out;
+}
+
+std::vector<ItemSummary> BranchRouter::GetCatalogueSummaries() const {
+    return mergeByTitle(fanOut(allShards(), [](Database& db) { return db.GetCatalogueSummaries(); }));
+}
+
+std::vector<ItemSummary> BranchRouter::GetAvailableCatalogue() const {
+    return mergeByTitle(fanOut(allShards(), [](Database& db) { return db.GetAvailableCatalogue(); }));
+}
+
+std::optional<ItemDetails> BranchRouter::GetItemDetails(const ItemId& itemId) const {
+    const auto [branch, local] = SplitItemId(itemId);
+    Shard* s = shard(branch);
+    if (!s) return std::nullopt;
+    auto details = s->run([local = local](Database& db) { return db.GetItemDetails(local); }).get();
+    if (details) details->id = itemId;
+    return details;
+}
+
+ValueResult<ItemId> BranchRouter::AddItem(const std::string& branch, const ItemDetails& detailsWithoutId) {
+    Shard* s = shard(branch);
+    if (!s) {
+        ValueResult<ItemId> r;
+        if (storageFailure(shardError(branch), &r)) return r;
+        r.ok = false; r.message = "Unknown branch";
+        return r;
+    }
+    auto r = s->run([detailsWithoutId](Database& db) { return db.AddItem(detailsWithoutId); }).get();
+    if (r.value) r.value = GlobalItemId(branch, *r.value);
+    return r;
+}
+
+OperationResult BranchRouter::RemoveItem(const ItemId& itemId) {
+    const auto [branch, local] = SplitItemId(itemId);
+    Shard* s = shard(branch);
+    if (!s) {
+        OperationResult r;
+        if (storageFailure(shardError(branch), &r)) return r;
+        r.ok = false; r.message = "Item not found";
+        return r;
+    }
+    return s->run([local = local](Database& db) { return db.RemoveItem(local); }).get();
+}
+
+// ----- Circulation -----
+ValueResult<LoanSnapshot> BranchRouter::CheckoutItem(const PatronId& patronId, const ItemId& itemId) {
+    const auto [branch, local] = SplitItemId(itemId);
+    Shard* target = shard(branch);
+    if (!target) {
+        ValueResult<LoanSnapshot> r;
+        if (storageFailure(shardError(branch), &r)) return r;
+        r.ok = false; r.error = CirculationError::ItemNotFound; r.message = "Item not found";
+        return r;
+    }
+
+    // Two checkouts by one patron at different branches must not both pass
+    // the limit; other patrons are unaffected.
+    std::lock_guard<std::mutex> patronLock(patronLocks_[std::hash<std::string>{}(patronId) % kPatronStripes]);
+
+    // Loans and fines in the other shards; the home database's share of the
+    // fines includes the settled balance
+    std::vector<std::pair<std::string, Shard*>> others;
+    for (const auto& entry : allShards()) {
+        if (entry.second != target) others.push_back(entry);
+    }
+    std::size_t loansElsewhere = 0;
+    std::int64_t finesElsewhere = 0;
+    for (const auto& [code, owed] : fanOut(others, [patronId](Database& db) {
+             return std::make_pair(db.GetActiveLoanCount(patronId), db.GetFinesOwed(patronId));
+         })) {
+        loansElsewhere += owed.first;
+        finesElsewhere += owed.second;
+    }
+
+    auto r = target->run([patronId, local = local, loansElsewhere, finesElsewhere](Database& db) {
+        return db.CheckoutItem(patronId, local, loansElsewhere, finesElsewhere);
+    }).get();
+    if (r.value) r.value->itemId = itemId;
+    return r;
+}
+
+OperationResult BranchRouter::ReturnItem(const PatronId& patronId, const ItemId& itemId) {
+    const auto [branch, local] = SplitItemId(itemId);
+    Shard* s = shard(branch);
+    if (!s) {
+        OperationResult r;
+        if (storageFailure(shardError(branch), &r)) return r;
+        r.ok = false; r.error = CirculationError::LoanNotFound; r.message = "No active loan for this item by this patron";
+        return r;
+    }
+    if (branch.empty()) {
+        return s->run([patronId, local = local](Database& db) { return db.ReturnItem(patronId, local); }).get();
+    }
+
+    // The shard has no user records: the return commits its fine to the
+    // branch's pendingFines, which is then moved to the balance at home. A
+    // move that fails leaves the fine pending (still counted as owed) and is
+    // retried on the next return with a fine, or when the branch next opens.
+    std::int64_t fine = 0;
+    auto r = s->run([patronId, local = local, &fine](Database& db) { return db.ReturnItem(patronId, local, &fine); }).get();
+    if (!r.ok || fine <= 0) return r;
+    Shard* home = shard("");
+    const std::string why = home ? movePendingFines(branch, *s, *home) : "the home database is not open";
+    if (!why.empty()) r.message = "Returned; the fine is held at the branch until it can be charged: " + why;
+    return r;
+}
+
+ValueResult<std::size_t> BranchRouter::PlaceHold(const PatronId& patronId, const ItemId& itemId) {
+    const auto [branch, local] = SplitItemId(itemId);
+    Shard* s = shard(branch);
+    if (!s) {
+        ValueResult<std::size_t> r;
+        if (storageFailure(shardError(branch), &r)) return r;
+        r.ok = false; r.error = CirculationError::ItemNotFound; r.message = "Item not found";
+        return r;
+    }
+    return s->run([patronId, local = local](Database& db) { return db.PlaceHold(patronId, local); }).get();
+}
+
+OperationResult BranchRouter::CancelHold(const PatronId& patronId, const ItemId& itemId) {
+    const auto [branch, local] = SplitItemId(itemId);
+    Shard* s = shard(branch);
+    if (!s) {
+        OperationResult r;
+        if (storageFailure(shardError(branch), &r)) return r;
+        r.ok = false; r.error = CirculationError::HoldNotFound; r.message = "Hold not found";
+        return r;
+    }
+    return s->run([patronId, local = local](Database& db) { return db.CancelHold(patronId, local); }).get();
+}
+
+ValueResult<std::int64_t> BranchRouter::SettleFine(const PatronId& patronId, std::int64_t cents, FineSettlement how) {
+    Shard* home = shard("");
+    if (!home) {
+        ValueResult<std::int64_t> r;
+        r.ok = false; r.error = CirculationError::StorageError; r.message = "Home database is not open";
+        return r;
+    }
+    return home->run([patronId, cents, how](Database& db) { return db.SettleFine(patronId, cents, how); }).get();
+}
+
+// ----- Per-patron views -----
+std::size_t BranchRouter::GetActiveLoanCount(const PatronId& patronId) const {
+    std::size_t total = 0;
+    for (const auto& [code, n] : fanOut(allShards(), [patronId](Database& db) { return db.GetActiveLoanCount(patronId); })) {
+        total += n;
+    }
+    return total;
+}
+
+std::int64_t BranchRouter::GetFinesOwed(const PatronId& patronId) const {
+    std::int64_t total = 0;
+    for (const auto& [code, cents] : fanOut(allShards(), [patronId](Database& db) { return db.GetFinesOwed(patronId); })) {
+        total += cents;
+    }
+    return total;
+}
+
+std::optional<std::int64_t> BranchRouter::FineThresholdCents() const {
+    if (finePolicy_.thresholdCents.isNull()) return std::nullopt;
+    return finePolicy_.thresholdCents.toLongLong();
+}
+
+PatronDashboard BranchRouter::GetPatronDashboard(const PatronId& patronId) const {
+    PatronDashboard dash;
+    for (auto& [code, part] : fanOut(allShards(), [patronId](Database& db) { return db.GetPatronDashboard(patronId); })) {
+        for (auto& l : part.loans) {
+            l.loan.itemId = GlobalItemId(code, l.loan.itemId);
+            dash.loans.push_back(std::move(l));
+        }
+        for (auto& h : part.holds) {
+            h.hold.itemId = GlobalItemId(code, h.hold.itemId);
+            dash.holds.push_back(std::move(h));
+        }
+    }
+    std::stable_sort(dash.holds.begin(), dash.holds.end(), [](const DashboardHold& a, const DashboardHold& b) {
+        return a.hold.queuePosition < b.hold.queuePosition;
+    });
+    return dash;
+}
+
+std::vector<LoanSnapshot> BranchRouter::GetPatronActiveLoans(const PatronId& patronId) const {
+    std::vector<LoanSnapshot> out;
+    for (auto& [code, part] : fanOut(allShards(), [patronId](Database& db) { return db.GetPatronActiveLoans(patronId); })) {
+        for (auto& l : part) {
+            l.itemId = GlobalItemId(code, l.itemId);
+            out.push_back(std::move(l));
+        }
+    }
+    return out;
+}
+
+std::vector<HoldSnapshot> BranchRouter::GetPatronActiveHolds(const PatronId& patronId) const {
+    std::vector<HoldSnapshot> out;
+    for (auto& [code, part] : fanOut(allShards(), [patronId](Database& db) { return db.GetPatronActiveHolds(patronId); })) {
+        for (auto& h : part) {
+            h.itemId = GlobalItemId(code, h.itemId);
+            out.push_back(std::move(h));
+        }
+    }
+    std::stable_sort(out.begin(), out.end(), [](const HoldSnapshot& a, const HoldSnapshot& b) {
+        return a.queuePosition < b.queuePosition;
+    });
+    return out;
+}
+
+} // namespace hinlibs
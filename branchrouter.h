@@ -0,0 +1,121 @@
+#pragma once
+
+#include "types.h"
+
+#include <QString>
+#include <QVariant>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hinlibs {
+
+class Database;
+
+struct BranchInfo {
+    std::string code;   // letters and digits; prefixes the branch's item ids
+    std::string name;
+};
+
+// Branch-aware storage. The home database keeps users, policy, the branch
+// list and any items not assigned to a branch; each branch keeps its own
+// items, loans and holds in its own file (<shardDir>/hinlibs-<code>.sqlite3),
+// so branches never wait on each other's write lock.
+//
+// Item ids are routed by prefix: "DT.I004" is item I004 in branch DT's file,
+// a bare "I004" lives in the home database. Each shard, home included, is
+// served by its own thread and connection, opened on first use; operations on
+// one item go to one shard, and per-patron views fan out to all shards in
+// parallel and are merged.
+class BranchRouter {
+public:
+    BranchRouter(QString homePath, QString shardDir);
+    ~BranchRouter();
+
+    BranchRouter(const BranchRouter&) = delete;
+    BranchRouter& operator=(const BranchRouter&) = delete;
+
+    // Opens the home database and reads the branch list.
+    bool Open(QString* error = nullptr);
+
+    // ----- Branches -----
+    std::vector<BranchInfo> Branches() const;
+    // Registers the branch and creates its database file.
+    OperationResult AddBranch(const std::string& code, const std::string& name);
+
+    static ItemId GlobalItemId(const std::string& branch, const ItemId& localId);
+    // {branch, localId}; branch is empty for home items.
+    static std::pair<std::string, ItemId> SplitItemId(const ItemId& itemId);
+
+    // ----- Session / Identification -----
+    std::optional<UserRecord> FindUserByName(const std::string& username) const;
+    std::optional<UserRecord> GetUserById(const UserId& id) const;
+
+    // ----- Catalogue (all branches, ordered by title) -----
+    std::vector<ItemSummary> GetCatalogueSummaries() const;
+    std::vector<ItemSummary> GetAvailableCatalogue() const;
+    std::optional<ItemDetails> GetItemDetails(const ItemId& itemId) const;
+
+    ValueResult<ItemId> AddItem(const std::string& branch, const ItemDetails& detailsWithoutId);
+    OperationResult RemoveItem(const ItemId& itemId);
+
+    // ----- Circulation (one shard each) -----
+    // The loan limit and the fine threshold are global: loans and accruing
+    // fines in the other shards are counted, and checkouts by the same patron
+    // are serialized across branches. Fine balances are kept and settled in
+    // the home database; branches use its threshold and rates, and hold the
+    // fines of their returns until home has charged them.
+    ValueResult<LoanSnapshot> CheckoutItem(const PatronId& patronId, const ItemId& itemId);
+    OperationResult ReturnItem(const PatronId& patronId, const ItemId& itemId);
+    ValueResult<std::size_t> PlaceHold(const PatronId& patronId, const ItemId& itemId);
+    OperationResult CancelHold(const PatronId& patronId, const ItemId& itemId);
+    // Fine balances live with the users, in the home database.
+    ValueResult<std::int64_t> SettleFine(const PatronId& patronId, std::int64_t cents, FineSettlement how);
+
+    // ----- Per-patron views (fanned out) -----
+    std::size_t GetActiveLoanCount(const PatronId& patronId) const;
+    // The home balance plus fines pending and accruing in every branch.
+    std::int64_t GetFinesOwed(const PatronId& patronId) const;
+    // The home database's threshold, which every branch applies.
+    std::optional<std::int64_t> FineThresholdCents() const;
+    PatronDashboard GetPatronDashboard(const PatronId& patronId) const;
+    std::vector<LoanSnapshot> GetPatronActiveLoans(const PatronId& patronId) const;
+    std::vector<HoldSnapshot> GetPatronActiveHolds(const PatronId& patronId) const;
+
+private:
+    class Shard;
+
+    Shard* shard(const std::string& branch) const;      // opens on demand; null if unknown or unopenable
+    std::string shardError(const std::string& branch) const;  // why shard() last failed to open it
+    std::vector<std::pair<std::string, Shard*>> allShards() const;
+    static std::string movePendingFines(const std::string& branch, Shard& from, Shard& home);
+    QString shardPath(const std::string& code) const;
+
+    QString homePath_;
+    QString shardDir_;
+    int maxLoans_ = 3;
+    int loanDays_ = 14;
+    // Home policy.fineThresholdCents (null for no limit) and fineRates rows
+    // {format, centsPerDay, maxCentsPerLoan}, copied to every branch on open.
+    struct FinePolicy {
+        QVariant thresholdCents;
+        std::vector<std::array<QVariant, 3>> rates;
+    };
+    FinePolicy finePolicy_;
+
+    mutable std::mutex mutex_;  // guards branches_, shards_ and openErrors_
+    std::vector<BranchInfo> branches_;
+    mutable std::map<std::string, std::unique_ptr<Shard>> shards_;  // "" = home
+    mutable std::map<std::string, std::string> openErrors_;
+
+    // Striped by patron id; see CheckoutItem.
+    static constexpr std::size_t kPatronStripes = 64;
+    mutable std::array<std::mutex, kPatronStripes> patronLocks_;
+};
+
+} // namespace hinlibs
@@ -0,0 +1,245 @@
+#include "catalogueexport.h"
+
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStringList>
+#include <QVariant>
+
+#include <algorithm>
+#include <vector>
+
+namespace hinlibs {
+
+namespace {
+
+QString formatName(ItemFormat f) {
+    switch (f) {
+        case ItemFormat::Book: return "Book";
+        case ItemFormat::Magazine: return "Magazine";
+        case ItemFormat::Movie: return "Movie";
+        case ItemFormat::VideoGame: return "VideoGame";
+    }
+    return "Book";
+}
+
+QString statusName(ItemStatus st) {
+    return st == ItemStatus::Available ? "Available" : "CheckedOut";
+}
+
+// Buffers output and hands it to the device in large writes.
+class BufferedWriter {
+public:
+    BufferedWriter(QIODevice* out, int capacity) : out_(out), capacity_(capacity) {
+        buf_.reserve(capacity_);
+    }
+
+    void append(const char* s, int n) { buf_.append(s, n); }
+    void append(const QByteArray& b) { buf_.append(b); }
+    void append(char c) { buf_.append(c); }
+
+    // Called at row boundaries.
+    bool maybeFlush() { return buf_.size() < capacity_ || flush(); }
+
+    bool flush() {
+        if (buf_.isEmpty()) return true;
+        const qint64 n = out_->write(buf_);
+        if (n != buf_.size()) return false;
+        written_ += static_cast<std::uint64_t>(n);
+        buf_.clear();   // keeps the allocation
+        return true;
+    }
+
+    std::uint64_t written() const { return written_; }
+
+private:
+    QIODevice* out_;
+    int capacity_;
+    QByteArray buf_;
+    std::uint64_t written_ = 0;
+};
+
+void appendCsvField(BufferedWriter& w, const QByteArray& v) {
+    bool quote = false;
+    for (char c : v) {
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') { quote = true; break; }
+    }
+    if (!quote) { w.append(v); return; }
+    w.append('"');
+    for (char c : v) {
+        if (c == '"') w.append('"');
+        w.append(c);
+    }
+    w.append('"');
+}
+
+void appendJsonString(BufferedWriter& w, const QByteArray& v) {
+    static const char hex[] = "0123456789abcdef";
+    w.append('"');
+    for (char ch : v) {
+        const auto c = static_cast<unsigned char>(ch);
+        switch (c) {
+            case '"':  w.append("\\\"", 2); break;
+            case '\\': w.append("\\\\", 2); break;
+            case '\n': w.append("\\n", 2); break;
+            case '\r': w.append("\\r", 2); break;
+            case '\t': w.append("\\t", 2); break;
+            default:
+                if (c < 0x20) {
+                    const char esc[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                    w.append(esc, 6);
+                } else {
+                    w.append(ch);   // UTF-8 passes through
+                }
+        }
+    }
+    w.append('"');
+}
+
+bool isNumeric(const QVariant& v) {
+    switch (v.type()) {
+        case QVariant::Int: case QVariant::LongLong: case QVariant::UInt:
+        case QVariant::ULongLong: case QVariant::Double:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// SELECT for one table with the item filters applied; binds go to *binds.
+QString selectFor(ExportTable table, const ExportOptions& options, QVariantList* binds) {
+    QStringList itemWhere;
+    if (options.itemFormat) { itemWhere << "format = ?"; *binds << formatName(*options.itemFormat); }
+    if (options.itemStatus) { itemWhere << "status = ?"; *binds << statusName(*options.itemStatus); }
+    const QString itemFilter = itemWhere.join(" AND ");
+
+    switch (table) {
+        case ExportTable::Items:
+            return "SELECT id, title, authorOrCreator, format, status, publicationYear, isbn, deweyDecimal, "
+                   "genre, rating, issueNumber, publicationDate FROM items"
+                   + (itemFilter.isEmpty() ? QString() : " WHERE " + itemFilter) + " ORDER BY id";
+        case ExportTable::Loans:
+            return "SELECT id, patronId, itemId, checkoutDate, dueDate FROM loans"
+                   + (itemFilter.isEmpty() ? QString() : " WHERE itemId IN (SELECT id FROM items WHERE " + itemFilter + ")")
+                   + " ORDER BY id";
+        case ExportTable::Holds:
+            return "SELECT id, patronId, itemId, queuePosition FROM holds"
+                   + (itemFilter.isEmpty() ? QString() : " WHERE itemId IN (SELECT id FROM items WHERE " + itemFilter + ")")
+                   + " ORDER BY itemId, queuePosition";
+    }
+    return QString();
+}
+
+bool exportOne(QSqlDatabase db, const ExportTarget& target, const ExportOptions& options,
+               ExportReport* out, QString* error) {
+    QVariantList binds;
+    QSqlQuery q(db);
+    q.setForwardOnly(true);     // rows are not cached by Qt
+    q.prepare(selectFor(target.table, options, &binds));
+    for (const QVariant& b : binds) q.addBindValue(b);
+    if (!q.exec()) {
+        *error = q.lastError().text();
+        return false;
+    }
+
+    const QSqlRecord rec = q.record();
+    const int columns = rec.count();
+    std::vector<QByteArray> names;
+    for (int i = 0; i < columns; ++i) names.push_back(rec.fieldName(i).toUtf8());
+
+    BufferedWriter w(target.out, std::max(options.bufferBytes, 4096));
+    const bool csv = options.format == ExportFormat::Csv;
+    if (csv) {
+        for (int i = 0; i < columns; ++i) {
+            if (i) w.append(',');
+            w.append(names[i]);
+        }
+        w.append('\n');
+    }
+
+    while (q.next()) {
+        if (csv) {
+            for (int i = 0; i < columns; ++i) {
+                if (i) w.append(',');
+                const QVariant v = q.value(i);
+                if (!v.isNull()) appendCsvField(w, v.toString().toUtf8());
+            }
+        } else {
+            w.append('{');
+            for (int i = 0; i < columns; ++i) {
+                if (i) w.append(',');
+                appendJsonString(w, names[i]);
+                w.append(':');
+                const QVariant v = q.value(i);
+                if (v.isNull()) w.append("null", 4);
+                else if (isNumeric(v)) w.append(v.toString().toUtf8());
+                else appendJsonString(w, v.toString().toUtf8());
+            }
+            w.append('}');
+        }
+        w.append('\n');
+        ++out->rows;
+        if (!w.maybeFlush()) {
+            *error = "Write failed: " + target.out->errorString();
+            return false;
+        }
+    }
+    if (q.lastError().isValid()) {
+        *error = q.lastError().text();
+        return false;
+    }
+    if (!w.flush()) {
+        *error = "Write failed: " + target.out->errorString();
+        return false;
+    }
+    out->bytes += w.written();
+    return true;
+}
+
+} // namespace
+
+const char* ExportTableName(ExportTable table) {
+    switch (table) {
+        case ExportTable::Items: return "items";
+        case ExportTable::Loans: return "loans";
+        case ExportTable::Holds: return "holds";
+    }
+    return "items";
+}
+
+bool ExportCatalogue(QSqlDatabase db, const std::vector<ExportTarget>& targets,
+                     const ExportOptions& options, ExportReport* report) {
+    QElapsedTimer timer;
+    timer.start();
+    ExportReport out;
+    QString error;
+
+    QSqlQuery mode(db);
+    const QString journal = mode.exec("PRAGMA journal_mode") && mode.next() ? mode.value(0).toString() : QString();
+    mode.finish();
+    if (journal.compare("wal", Qt::CaseInsensitive) != 0) {
+        out.error = "Export needs WAL journal mode (the database uses " + journal.toStdString() +
+                    "); its read transaction would block checkouts and returns";
+        if (report) *report = out;
+        return false;
+    }
+
+    // One read transaction: every table comes from the same snapshot.
+    const bool began = db.transaction();
+    bool ok = began;
+    if (!ok) error = db.lastError().text();
+    for (const ExportTarget& t : targets) {
+        if (!ok) break;
+        ok = exportOne(db, t, options, &out, &error);
+    }
+    if (began) db.rollback();     // read-only; nothing to keep
+
+    out.seconds = timer.nsecsElapsed() / 1e9;
+    if (!ok) out.error = error.toStdString();
+    if (report) *report = out;
+    return ok;
+}
+
+} // namespace hinlibs
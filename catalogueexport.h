@@ -0,0 +1,54 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <QSqlDatabase>
+
+class QIODevice;
+
+namespace hinlibs {
+
+enum class ExportFormat {
+    Csv,        // header row, RFC 4180 quoting, NULL as an empty field
+    JsonLines   // one object per row, NULL as null
+};
+
+enum class ExportTable { Items, Loans, Holds };
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::Csv;
+    // Restrict items to these; loans and holds follow their item.
+    std::optional<ItemFormat> itemFormat;
+    std::optional<ItemStatus> itemStatus;
+    int bufferBytes = 1 << 20;  // flushed to the device when full
+};
+
+struct ExportTarget {
+    ExportTable table;
+    QIODevice* out;             // open for writing
+};
+
+struct ExportReport {
+    std::uint64_t rows = 0;
+    std::uint64_t bytes = 0;
+    double seconds = 0.0;
+    std::string error;
+};
+
+// Writes each table straight from a forward-only cursor into a reused
+// buffer, so memory does not grow with table size. All targets are read in
+// one transaction and see the same snapshot. That read transaction would
+// block every writer under a rollback journal, so the export refuses to run
+// unless the database is in WAL mode (the app, server and CLI switch it on
+// when they open the file); with WAL circulation keeps committing.
+bool ExportCatalogue(QSqlDatabase db, const std::vector<ExportTarget>& targets,
+                     const ExportOptions& options, ExportReport* report);
+
+const char* ExportTableName(ExportTable table);
+
+} // namespace hinlibs
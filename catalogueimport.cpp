@@ -0,0 +1,652 @@
+#include "catalogueimport.h"
+
+#include <QDate>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QLockFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace hinlibs {
+
+namespace {
+
+// Rows per multi-row INSERT; 11 bound columns each keeps a full statement
+// under SQLite's historical 999-variable limit.
+constexpr int kBoundColumns = 11;
+constexpr int kRowsPerStatement = 80;
+static_assert(kBoundColumns * kRowsPerStatement <= 999, "too many bound variables per INSERT");
+constexpr std::size_t kMaxReportedErrors = 20;
+constexpr int kImportLockWaitMs = 5000;
+
+struct RawRecord {
+    QByteArray text;
+    std::uint64_t line = 0;     // first line of the record, 1-based
+};
+
+struct RawBatch {
+    std::uint64_t seq = 0;
+    std::vector<RawRecord> records;
+};
+
+// Validated row, already in the items table's representation.
+struct ParsedItem {
+    QString title;
+    QString author;
+    QString format;             // Book / Magazine / Movie / VideoGame
+    std::optional<int> year;
+    QString isbn;               // null QString -> NULL
+    QString dewey;
+    QString genre;
+    QString rating;
+    QString issue;
+    QString date;
+};
+
+struct ParsedBatch {
+    std::vector<ParsedItem> items;
+    std::vector<std::string> errors;
+    std::uint64_t rejected = 0;
+};
+
+// ----- Field normalization shared by both formats -----
+
+QString nullIfEmpty(const QString& s) {
+    const QString t = s.trimmed();
+    return t.isEmpty() ? QString() : t;
+}
+
+std::optional<QString> normalizeFormat(const QString& s) {
+    const QString f = s.trimmed().toLower().remove(' ');
+    if (f == "book") return QString("Book");
+    if (f == "magazine" || f == "serial") return QString("Magazine");
+    if (f == "movie" || f == "film" || f == "dvd") return QString("Movie");
+    if (f == "videogame" || f == "game") return QString("VideoGame");
+    return std::nullopt;
+}
+
+// Final checks; returns the reason on failure.
+std::optional<std::string> validate(ParsedItem& item) {
+    item.title = item.title.trimmed();
+    if (item.title.isEmpty()) return std::string("missing title");
+    if (item.format.isEmpty()) return std::string("missing or unknown format");
+    if (item.year && (*item.year < 0 || *item.year > 9999)) return std::string("publication year out of range");
+    if (!item.isbn.isNull()) {
+        QString digits = item.isbn;
+        digits.remove('-').remove(' ');
+        if ((digits.size() != 10 && digits.size() != 13) ||
+            !std::all_of(digits.begin(), digits.end(), [](QChar c) { return c.isDigit() || c == 'X' || c == 'x'; })) {
+            return "bad ISBN '" + item.isbn.toStdString() + "'";
+        }
+        item.isbn = digits.toUpper();
+    }
+    if (!item.date.isNull() && !QDate::fromString(item.date, Qt::ISODate).isValid()) {
+        return "bad publication date '" + item.date.toStdString() + "'";
+    }
+    return std::nullopt;
+}
+
+// ----- CSV -----
+// Header names, case-insensitive: title, author (or authorOrCreator, creator),
+// format, year (publicationYear), isbn, dewey (deweyDecimal), genre, rating,
+// issue (issueNumber), date (publicationDate). Unknown columns are ignored.
+struct CsvColumns {
+    int title = -1, author = -1, format = -1, year = -1, isbn = -1;
+    int dewey = -1, genre = -1, rating = -1, issue = -1, date = -1;
+};
+
+QStringList splitCsv(const QByteArray& record) {
+    QStringList fields;
+    QByteArray field;
+    bool quoted = false;
+    for (int i = 0; i < record.size(); ++i) {
+        const char c = record.at(i);
+        if (quoted) {
+            if (c == '"' && i + 1 < record.size() && record.at(i + 1) == '"') { field.append('"'); ++i; }
+            else if (c == '"') quoted = false;
+            else field.append(c);
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields << QString::fromUtf8(field);
+            field.clear();
+        } else {
+            field.append(c);
+        }
+    }
+    fields << QString::fromUtf8(field);
+    return fields;
+}
+
+CsvColumns mapCsvHeader(const QStringList& header) {
+    CsvColumns c;
+    for (int i = 0; i < header.size(); ++i) {
+        const QString h = header.at(i).trimmed().toLower();
+        if (h == "title") c.title = i;
+        else if (h == "author" || h == "authororcreator" || h == "creator") c.author = i;
+        else if (h == "format") c.format = i;
+        else if (h == "year" || h == "publicationyear") c.year = i;
+        else if (h == "isbn") c.isbn = i;
+        else if (h == "dewey" || h == "deweydecimal") c.dewey = i;
+        else if (h == "genre") c.genre = i;
+        else if (h == "rating") c.rating = i;
+        else if (h == "issue" || h == "issuenumber") c.issue = i;
+        else if (h == "date" || h == "publicationdate") c.date = i;
+    }
+    return c;
+}
+
+std::optional<std::string> parseCsv(const RawRecord& raw, const CsvColumns& cols, ParsedItem* item) {
+    const QStringList f = splitCsv(raw.text);
+    auto at = [&](int i) { return i >= 0 && i < f.size() ? f.at(i) : QString(); };
+
+    item->title = at(cols.title);
+    item->author = at(cols.author).trimmed();
+    item->format = normalizeFormat(at(cols.format)).value_or(QString());
+    if (const QString y = at(cols.year).trimmed(); !y.isEmpty()) {
+        bool ok = false;
+        item->year = y.toInt(&ok);
+        if (!ok) return "bad year '" + y.toStdString() + "'";
+    }
+    item->isbn = nullIfEmpty(at(cols.isbn));
+    item->dewey = nullIfEmpty(at(cols.dewey));
+    item->genre = nullIfEmpty(at(cols.genre));
+    item->rating = nullIfEmpty(at(cols.rating));
+    item->issue = nullIfEmpty(at(cols.issue));
+    item->date = nullIfEmpty(at(cols.date));
+    return validate(*item);
+}
+
+// Reads one CSV record; quoted fields may span lines.
+bool readCsvRecord(QIODevice& in, RawRecord* out, std::uint64_t* line, std::uint64_t* bytes) {
+    out->text.clear();
+    out->line = *line + 1;
+    bool inQuotes = false;
+    while (!in.atEnd()) {
+        QByteArray l = in.readLine();
+        ++*line;
+        *bytes += static_cast<std::uint64_t>(l.size());
+        inQuotes ^= (l.count('"') % 2) != 0;
+        out->text.append(l);
+        if (!inQuotes) break;
+    }
+    while (out->text.endsWith('\n') || out->text.endsWith('\r')) out->text.chop(1);
+    return !out->text.isEmpty() || !in.atEnd();
+}
+
+// ----- MARC text (.mrk) -----
+// "=LDR  00000nam a2200000 a 4500", "=245  10$aTitle /$cAuthor.", one field
+// per line, records separated by blank lines. Leader/06-07 give the format.
+QString subfield(const QString& data, QChar code) {
+    const int start = data.indexOf(QString("$") + code);
+    if (start < 0) return QString();
+    const int end = data.indexOf('$', start + 2);
+    return data.mid(start + 2, end < 0 ? -1 : end - start - 2).trimmed();
+}
+
+QString stripIsbdPunctuation(QString s) {
+    while (!s.isEmpty() && QString(" /:;,.=").contains(s.back())) s.chop(1);
+    return s;
+}
+
+std::optional<std::string> parseMrk(const RawRecord& raw, ParsedItem* item) {
+    QString leader;
+    QString author;
+    QString statement;   // 245$c
+    QString year;
+    for (const QByteArray& rawLine : raw.text.split('\n')) {
+        const QString l = QString::fromUtf8(rawLine).trimmed();
+        if (l.size() < 5 || !l.startsWith('=')) continue;
+        const QString tag = l.mid(1, 3);
+        const QString data = l.mid(6);   // "=TTT  " then indicators + subfields
+        if (tag == "LDR") leader = data;
+        else if (tag == "245") { item->title = stripIsbdPunctuation(subfield(data, 'a')); statement = subfield(data, 'c'); }
+        else if ((tag == "100" || tag == "110") && author.isEmpty()) author = stripIsbdPunctuation(subfield(data, 'a'));
+        else if ((tag == "264" || tag == "260") && year.isEmpty()) year = subfield(data, 'c');
+        else if (tag == "020" && item->isbn.isNull()) item->isbn = nullIfEmpty(subfield(data, 'a').section(' ', 0, 0));
+        else if (tag == "082" && item->dewey.isNull()) item->dewey = nullIfEmpty(subfield(data, 'a').remove('/'));
+        else if (tag == "655" && item->genre.isNull()) item->genre = nullIfEmpty(stripIsbdPunctuation(subfield(data, 'a')));
+        else if (tag == "521" && item->rating.isNull()) item->rating = nullIfEmpty(stripIsbdPunctuation(subfield(data, 'a')));
+        else if (tag == "362" && item->issue.isNull()) item->issue = nullIfEmpty(stripIsbdPunctuation(subfield(data, 'a')));
+    }
+
+    if (leader.size() < 8) return std::string("missing leader");
+    const QChar type = leader.at(6);
+    const QChar level = leader.at(7);
+    if (type == 'a' && level == 's') item->format = "Magazine";
+    else if (type == 'a' || type == 't') item->format = "Book";
+    else if (type == 'g') item->format = "Movie";
+    else if (type == 'm') item->format = "VideoGame";
+    else return "unsupported record type '" + QString(type).toStdString() + "'";
+
+    item->author = !author.isEmpty() ? author : stripIsbdPunctuation(statement);
+    for (int i = 0; i + 4 <= year.size(); ++i) {
+        bool ok = false;
+        const int y = year.mid(i, 4).toInt(&ok);
+        if (ok) { item->year = y; break; }
+    }
+    return validate(*item);
+}
+
+bool readMrkRecord(QIODevice& in, RawRecord* out, std::uint64_t* line, std::uint64_t* bytes) {
+    out->text.clear();
+    while (!in.atEnd()) {
+        const QByteArray l = in.readLine();
+        ++*line;
+        *bytes += static_cast<std::uint64_t>(l.size());
+        if (l.trimmed().isEmpty()) {
+            if (!out->text.isEmpty()) return true;
+            continue;
+        }
+        if (out->text.isEmpty()) out->line = *line;
+        out->text.append(l);
+    }
+    return !out->text.isEmpty();
+}
+
+// ----- Writer -----
+QString insertSql(int rows) {
+    QString sql = "INSERT INTO items (id, title, authorOrCreator, format, status, publicationYear, isbn, "
+                  "deweyDecimal, genre, rating, issueNumber, publicationDate) VALUES ";
+    const QString tuple = "(?, ?, ?, ?, 'Available', ?, ?, ?, ?, ?, ?, ?)";
+    for (int i = 0; i < rows; ++i) {
+        if (i) sql += ", ";
+        sql += tuple;
+    }
+    return sql;
+}
+
+QVariant orNull(const QString& s) {
+    return s.isNull() ? QVariant(QVariant::String) : QVariant(s);
+}
+
+class Writer {
+public:
+    Writer(QSqlDatabase db, int rowsPerTransaction) : db_(db), rowsPerTransaction_(rowsPerTransaction) {}
+
+    bool start(QString* error) {
+        QSqlQuery q(db_);
+        if (!q.exec("SELECT MAX(CAST(SUBSTR(id, 2) AS INTEGER)) FROM items WHERE id LIKE 'I%'")) {
+            *error = q.lastError().text();
+            return false;
+        }
+        if (q.next()) nextId_ = q.value(0).toLongLong() + 1;
+        full_ = QSqlQuery(db_);
+        full_.prepare(insertSql(kRowsPerStatement));
+        return begin(error);
+    }
+
+    bool add(const ParsedItem& item, QString* error) {
+        pending_.push_back(item);
+        if (pending_.size() < static_cast<std::size_t>(kRowsPerStatement)) return true;
+        return flushRows(error);
+    }
+
+    bool finish(QString* error) {
+        if (!pending_.empty() && !flushRows(error)) return false;
+        if (inTxn_ && !db_.commit()) { *error = db_.lastError().text(); return false; }
+        inTxn_ = false;
+        committed_ += uncommitted_;
+        uncommitted_ = 0;
+        return true;
+    }
+
+    void abort() {
+        if (inTxn_) db_.rollback();
+        inTxn_ = false;
+        uncommitted_ = 0;
+    }
+
+    std::uint64_t committed() const { return committed_; }
+
+private:
+    bool begin(QString* error) {
+        if (!db_.transaction()) { *error = db_.lastError().text(); return false; }
+        inTxn_ = true;
+        return true;
+    }
+
+    bool flushRows(QString* error) {
+        const int rows = static_cast<int>(pending_.size());
+        QSqlQuery tail(db_);
+        QSqlQuery* q = &full_;
+        if (rows != kRowsPerStatement) {
+            tail.prepare(insertSql(rows));
+            q = &tail;
+        }
+
+        int col = 0;
+        for (const ParsedItem& it : pending_) {
+            q->bindValue(col++, QString("I%1").arg(nextId_++, 3, 10, QLatin1Char('0')));
+            q->bindValue(col++, it.title);
+            q->bindValue(col++, it.author);
+            q->bindValue(col++, it.format);
+            q->bindValue(col++, it.year ? QVariant(*it.year) : QVariant(QVariant::Int));
+            q->bindValue(col++, orNull(it.isbn));
+            q->bindValue(col++, orNull(it.dewey));
+            q->bindValue(col++, orNull(it.genre));
+            q->bindValue(col++, orNull(it.rating));
+            q->bindValue(col++, orNull(it.issue));
+            q->bindValue(col++, orNull(it.date));
+        }
+        pending_.clear();
+        if (!q->exec()) {
+            *error = q->lastError().text();
+            return false;
+        }
+
+        uncommitted_ += static_cast<std::uint64_t>(rows);
+        if (uncommitted_ >= static_cast<std::uint64_t>(rowsPerTransaction_)) {
+            if (!db_.commit()) { *error = db_.lastError().text(); return false; }
+            inTxn_ = false;
+            committed_ += uncommitted_;
+            uncommitted_ = 0;
+            return begin(error);
+        }
+        return true;
+    }
+
+    QSqlDatabase db_;
+    int rowsPerTransaction_;
+    QSqlQuery full_;
+    std::vector<ParsedItem> pending_;
+    qlonglong nextId_ = 1;
+    bool inTxn_ = false;
+    std::uint64_t uncommitted_ = 0;
+    std::uint64_t committed_ = 0;
+};
+
+// ----- Pipeline -----
+// Batches flow reader -> parsers -> writer. At most maxInFlight batches are
+// read but not yet written, which bounds memory.
+struct Pipeline {
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable parsedReady;
+    std::condition_variable spaceFree;
+    std::deque<RawBatch> work;
+    std::map<std::uint64_t, ParsedBatch> parsed;
+    std::uint64_t batchesRead = 0;
+    std::size_t inFlight = 0;
+    std::size_t maxInFlight = 0;
+    bool readerDone = false;
+    bool aborted = false;
+
+    bool push(RawBatch batch) {
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceFree.wait(lock, [&] { return inFlight < maxInFlight || aborted; });
+        if (aborted) return false;
+        work.push_back(std::move(batch));
+        ++inFlight;
+        ++batchesRead;
+        workReady.notify_one();
+        return true;
+    }
+
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+        workReady.notify_all();
+        spaceFree.notify_all();
+        parsedReady.notify_all();
+    }
+};
+
+} // namespace
+
+// Runs statements in one transaction; false (and rolled back) at the first
+// that fails.
+static bool runInTransaction(QSqlDatabase db, const QStringList& statements, QString* error) {
+    if (!db.transaction()) {
+        *error = db.lastError().text();
+        return false;
+    }
+    for (const QString& sql : statements) {
+        QSqlQuery q(db);
+        if (!q.exec(sql)) {
+            *error = q.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        *error = db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+// ----- Import lock -----
+CatalogueImportLock::CatalogueImportLock(const QSqlDatabase& db) {
+    const QString path = db.databaseName();
+    if (path.isEmpty() || path == ":memory:") return;
+    file_ = std::make_unique<QLockFile>(path + ".import.lock");
+    // An import can run for minutes; only a dead owner makes the lock stale.
+    file_->setStaleLockTime(0);
+}
+
+CatalogueImportLock::~CatalogueImportLock() = default;   // QLockFile unlocks
+
+bool CatalogueImportLock::tryLock(int timeoutMs) {
+    if (!file_ || file_->tryLock(timeoutMs)) return true;
+    return file_->error() != QLockFile::LockFailedError;
+}
+
+static QString sqlString(QString s) {
+    return "'" + s.replace('\'', "''") + "'";
+}
+
+// Records each items index in importDeferredIndexes and drops it, in one
+// transaction: either all are dropped and remembered, or none are.
+static bool deferIndexes(QSqlDatabase db, QString* error) {
+    QSqlQuery q(db);
+    if (!q.exec("SELECT name, sql FROM sqlite_master WHERE type='index' AND tbl_name='items' AND sql IS NOT NULL")) {
+        *error = q.lastError().text();
+        return false;
+    }
+    QStringList statements{ "CREATE TABLE IF NOT EXISTS importDeferredIndexes (name TEXT PRIMARY KEY, sql TEXT NOT NULL)" };
+    while (q.next()) {
+        const QString name = q.value(0).toString();
+        statements << QString("INSERT OR REPLACE INTO importDeferredIndexes VALUES (%1, %2)")
+                          .arg(sqlString(name), sqlString(q.value(1).toString()))
+                   << QString("DROP INDEX \"%1\"").arg(name);
+    }
+    q.finish();
+    return runInTransaction(db, statements, error);
+}
+
+bool RestoreDeferredIndexes(QSqlDatabase db, QString* error) {
+    QString why;
+    QSqlQuery q(db);
+    if (!q.exec("SELECT name, sql FROM importDeferredIndexes")) return true;   // never deferred
+    QStringList statements;
+    while (q.next()) {
+        statements << q.value(1).toString()
+                   << QString("DELETE FROM importDeferredIndexes WHERE name = %1").arg(sqlString(q.value(0).toString()));
+    }
+    q.finish();
+    if (statements.isEmpty() || runInTransaction(db, statements, &why)) return true;
+    if (error) *error = why;
+    return false;
+}
+
+ImportFormat GuessImportFormat(const QString& path) {
+    return path.endsWith(".mrk", Qt::CaseInsensitive) ? ImportFormat::Mrk : ImportFormat::Csv;
+}
+
+bool ImportCatalogue(QSqlDatabase db, QIODevice& input, const ImportOptions& options,
+                     ImportReport* report) {
+    QElapsedTimer timer;
+    timer.start();
+    ImportReport out;
+    std::uint64_t line = 0;
+
+    auto fail = [&](const QString& message) {
+        out.fatal = message.toStdString();
+        out.seconds = timer.nsecsElapsed() / 1e9;
+        if (report) *report = out;
+        return false;
+    };
+
+    // The CSV header is read here so parsers can share the column map.
+    CsvColumns columns;
+    if (options.format == ImportFormat::Csv) {
+        RawRecord header;
+        if (!readCsvRecord(input, &header, &line, &out.bytes)) return fail("Empty input");
+        columns = mapCsvHeader(splitCsv(header.text));
+        if (columns.title < 0 || columns.format < 0) return fail("CSV header needs title and format columns");
+    }
+
+    // ----- Indexes on items are rebuilt once at the end -----
+    // Openers hold the lock only around their index upkeep, so a short wait
+    // rides that out; another import holds it for its whole load.
+    CatalogueImportLock importLock(db);
+    if (!importLock.tryLock(kImportLockWaitMs)) return fail("Another catalogue import is running on this database");
+    QString error;
+    if (!RestoreDeferredIndexes(db, &error)) return fail("Cannot restore indexes from an earlier import: " + error);
+    if (options.deferIndexes && !deferIndexes(db, &error)) return fail("Cannot drop items indexes: " + error);
+    // On failure the reason is added to error; the definitions stay in
+    // importDeferredIndexes for the next open to retry.
+    auto rebuildIndexes = [&]() {
+        QString why;
+        if (RestoreDeferredIndexes(db, &why)) return true;
+        error += (error.isEmpty() ? "" : "; ") + QString("Cannot rebuild items indexes: ") + why;
+        return false;
+    };
+
+    Writer writer(db, std::max(options.rowsPerTransaction, kRowsPerStatement));
+    if (!writer.start(&error)) {
+        rebuildIndexes();
+        return fail(error);
+    }
+
+    const int hw = static_cast<int>(std::thread::hardware_concurrency());
+    const int parsers = options.parserThreads > 0 ? options.parserThreads : std::max(1, hw - 2);
+    const std::size_t perBatch = static_cast<std::size_t>(std::max(1, options.recordsPerBatch));
+
+    Pipeline pipe;
+    pipe.maxInFlight = static_cast<std::size_t>(parsers) * 2 + 2;
+
+    // ----- Reader -----
+    std::uint64_t records = 0;
+    std::uint64_t bytes = out.bytes;
+    std::thread reader([&]() {
+        RawBatch batch;
+        RawRecord rec;
+        std::uint64_t seq = 0;
+        const bool csv = options.format == ImportFormat::Csv;
+        while (csv ? readCsvRecord(input, &rec, &line, &bytes) : readMrkRecord(input, &rec, &line, &bytes)) {
+            if (rec.text.trimmed().isEmpty()) continue;
+            batch.records.push_back(std::move(rec));
+            rec = RawRecord{};
+            ++records;
+            if (batch.records.size() == perBatch) {
+                batch.seq = seq++;
+                if (!pipe.push(std::move(batch))) return;
+                batch = RawBatch{};
+            }
+        }
+        if (!batch.records.empty()) {
+            batch.seq = seq++;
+            pipe.push(std::move(batch));
+        }
+        std::lock_guard<std::mutex> lock(pipe.mutex);
+        pipe.readerDone = true;
+        pipe.workReady.notify_all();
+        pipe.parsedReady.notify_all();
+    });
+
+    // ----- Parsers -----
+    std::vector<std::thread> pool;
+    for (int t = 0; t < parsers; ++t) {
+        pool.emplace_back([&]() {
+            for (;;) {
+                RawBatch batch;
+                {
+                    std::unique_lock<std::mutex> lock(pipe.mutex);
+                    pipe.workReady.wait(lock, [&] { return pipe.aborted || !pipe.work.empty() || pipe.readerDone; });
+                    if (pipe.aborted || pipe.work.empty()) return;
+                    batch = std::move(pipe.work.front());
+                    pipe.work.pop_front();
+                }
+
+                ParsedBatch result;
+                result.items.reserve(batch.records.size());
+                for (const RawRecord& raw : batch.records) {
+                    ParsedItem item;
+                    const auto reason = options.format == ImportFormat::Csv ? parseCsv(raw, columns, &item)
+                                                                            : parseMrk(raw, &item);
+                    if (reason) {
+                        ++result.rejected;
+                        if (result.errors.size() < kMaxReportedErrors)
+                            result.errors.push_back("line " + std::to_string(raw.line) + ": " + *reason);
+                    } else {
+                        result.items.push_back(std::move(item));
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(pipe.mutex);
+                pipe.parsed.emplace(batch.seq, std::move(result));
+                pipe.parsedReady.notify_all();
+            }
+        });
+    }
+
+    // ----- Writer (this thread owns db) -----
+    bool ok = true;
+    for (std::uint64_t next = 0;; ++next) {
+        ParsedBatch batch;
+        {
+            std::unique_lock<std::mutex> lock(pipe.mutex);
+            pipe.parsedReady.wait(lock, [&] {
+                return pipe.parsed.count(next) || (pipe.readerDone && next == pipe.batchesRead);
+            });
+            auto it = pipe.parsed.find(next);
+            if (it == pipe.parsed.end()) break;
+            batch = std::move(it->second);
+            pipe.parsed.erase(it);
+            --pipe.inFlight;
+            pipe.spaceFree.notify_one();
+        }
+
+        out.rejected += batch.rejected;
+        for (auto& e : batch.errors) {
+            if (out.errors.size() < kMaxReportedErrors) out.errors.push_back(std::move(e));
+        }
+        for (const ParsedItem& item : batch.items) {
+            if (!writer.add(item, &error)) { ok = false; break; }
+        }
+        if (!ok) break;
+    }
+
+    if (ok) ok = writer.finish(&error);
+    if (!ok) {
+        writer.abort();
+        pipe.abort();
+    }
+    reader.join();
+    for (auto& t : pool) t.join();
+    if (!rebuildIndexes()) ok = false;
+
+    out.records = records;
+    out.bytes = bytes;
+    out.imported = writer.committed();
+    if (!ok) return fail(error);
+
+    out.seconds = timer.nsecsElapsed() / 1e9;
+    if (report) *report = out;
+    return true;
+}
+
+} // namespace hinlibs
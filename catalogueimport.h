@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QSqlDatabase>
+#include <QString>
+
+class QIODevice;
+class QLockFile;
+
+namespace hinlibs {
+
+enum class ImportFormat {
+    Csv,    // header row naming the columns; see catalogueimport.cpp
+    Mrk     // MARC text ("=245  10$aTitle"), records separated by blank lines
+};
+
+struct ImportOptions {
+    ImportFormat format = ImportFormat::Csv;
+    int parserThreads = 0;              // 0: one per core, less the reader and writer
+    int recordsPerBatch = 1000;         // unit of work handed to a parser
+    int rowsPerTransaction = 50000;
+    // Drop items indexes during the load and rebuild them after. The dropped
+    // definitions are kept in importDeferredIndexes until rebuilt, so a load
+    // that dies halfway has them restored by RestoreDeferredIndexes. Opening
+    // the file meanwhile, in this process or another, leaves them dropped
+    // (see CatalogueImportLock).
+    bool deferIndexes = true;
+};
+
+struct ImportReport {
+    std::uint64_t records = 0;          // records read
+    std::uint64_t imported = 0;         // rows committed
+    std::uint64_t rejected = 0;         // failed validation
+    std::uint64_t bytes = 0;
+    double seconds = 0.0;
+    std::vector<std::string> errors;    // first rejections, "line N: reason"
+    std::string fatal;                  // set when the load stopped early
+
+    double recordsPerSecond() const { return seconds > 0 ? records / seconds : 0.0; }
+};
+
+// Streams a catalogue export into the items table. Reading, parsing and
+// writing overlap: one thread reads raw records, a pool parses and validates
+// them, and the calling thread (which must own db) inserts them in input
+// order with multi-row INSERTs inside large transactions. Memory stays
+// bounded by a few batches whatever the input size.
+//
+// Ids continue from the highest existing I-number, found with one scan at
+// the start; ids in the input are not used. Rejected records are counted and
+// skipped. Returns false only when the load stopped early (report->fatal);
+// rows committed before that remain.
+bool ImportCatalogue(QSqlDatabase db, QIODevice& input, const ImportOptions& options,
+                     ImportReport* report);
+
+// "<database file>.import.lock". ImportCatalogue holds it for the whole
+// load; a Database opening the file takes it, without waiting, around its
+// items index upkeep and skips that upkeep while an import has it. A lock
+// left by a process that died is taken over. In-memory databases, and
+// directories the lock can't be written to, always lock.
+class CatalogueImportLock {
+public:
+    explicit CatalogueImportLock(const QSqlDatabase& db);
+    ~CatalogueImportLock();
+
+    bool tryLock(int timeoutMs = 0);
+
+private:
+    std::unique_ptr<QLockFile> file_;
+};
+
+// Recreates indexes an interrupted import dropped, in one transaction.
+// Called by ImportCatalogue and when a Database opens the file; the caller
+// holds the CatalogueImportLock.
+bool RestoreDeferredIndexes(QSqlDatabase db, QString* error = nullptr);
+
+// By file extension: .mrk -> Mrk, anything else -> Csv.
+ImportFormat GuessImportFormat(const QString& path);
+
+} // namespace hinlibs
@@ -0,0 +1,205 @@
+#include "cataloguesnapshot.h"
+
+#include <QDateTime>
+#include <QSaveFile>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace hinlibs {
+
+namespace {
+
+constexpr char kMagic[8] = { 'H', 'L', 'C', 'A', 'T', 'S', 'N', 'P' };
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint32_t sourceStamp;
+    std::uint32_t reserved;
+    std::int64_t writtenAt;     // ms since epoch
+    std::uint64_t heapSize;
+};
+static_assert(sizeof(Header) == 40, "snapshot header layout");
+
+bool validFormat(std::uint8_t v) { return v <= static_cast<std::uint8_t>(ItemFormat::VideoGame); }
+bool validStatus(std::uint8_t v) { return v <= static_cast<std::uint8_t>(ItemStatus::CheckedOut); }
+
+} // namespace
+
+struct CatalogueSnapshot::Record {
+    std::uint32_t idOffset, idLength;
+    std::uint32_t titleOffset, titleLength;
+    std::uint32_t authorOffset, authorLength;
+    std::uint8_t format;
+    std::uint8_t status;
+    std::uint8_t padding[2];
+};
+
+CatalogueSnapshot::~CatalogueSnapshot() {
+    if (base_) file_.unmap(const_cast<uchar*>(base_));
+}
+
+std::unique_ptr<CatalogueSnapshot> CatalogueSnapshot::Open(const QString& path, QString* error) {
+    static_assert(sizeof(Record) == 28, "snapshot record layout");
+    auto fail = [error](const QString& why) {
+        if (error) *error = why;
+        return std::unique_ptr<CatalogueSnapshot>();
+    };
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    return fail("Catalogue snapshots are only mapped on little-endian hosts");
+#endif
+
+    std::unique_ptr<CatalogueSnapshot> snap(new CatalogueSnapshot);
+    snap->file_.setFileName(path);
+    if (!snap->file_.open(QIODevice::ReadOnly)) return fail(snap->file_.errorString());
+
+    const qint64 size = snap->file_.size();
+    if (size < static_cast<qint64>(sizeof(Header))) return fail("Snapshot is truncated");
+    const uchar* base = snap->file_.map(0, size);
+    if (!base) return fail(snap->file_.errorString());
+    snap->base_ = base;
+
+    Header h;
+    std::memcpy(&h, base, sizeof h);
+    if (std::memcmp(h.magic, kMagic, sizeof kMagic) != 0) return fail("Not a catalogue snapshot");
+    if (h.version != kVersion) return fail(QString("Snapshot version %1, expected %2").arg(h.version).arg(kVersion));
+
+    const quint64 recordsEnd = sizeof(Header) + quint64(h.count) * sizeof(Record);
+    const quint64 indexEnd = recordsEnd + quint64(h.count) * sizeof(std::uint32_t);
+    if (indexEnd + h.heapSize != static_cast<quint64>(size)) return fail("Snapshot size does not match its header");
+
+    snap->records_ = reinterpret_cast<const Record*>(base + sizeof(Header));
+    snap->titleIndex_ = reinterpret_cast<const std::uint32_t*>(base + recordsEnd);
+    snap->heap_ = reinterpret_cast<const char*>(base + indexEnd);
+    snap->count_ = h.count;
+    snap->sourceStamp_ = h.sourceStamp;
+    snap->writtenAt_ = h.writtenAt;
+
+    // One pass over the fixed-width parts so the accessors need no checks.
+    // The strings themselves are never parsed.
+    auto inHeap = [&h](std::uint32_t off, std::uint32_t len) {
+        return quint64(off) + len <= h.heapSize;
+    };
+    for (std::size_t i = 0; i < snap->count_; ++i) {
+        const Record& r = snap->records_[i];
+        if (!inHeap(r.idOffset, r.idLength) || !inHeap(r.titleOffset, r.titleLength)
+            || !inHeap(r.authorOffset, r.authorLength)
+            || !validFormat(r.format) || !validStatus(r.status)
+            || snap->titleIndex_[i] >= h.count) {
+            return fail(QString("Snapshot record %1 is corrupt").arg(i));
+        }
+    }
+    return snap;
+}
+
+bool CatalogueSnapshot::Write(const QString& path, const std::vector<ItemSummary>& items,
+                              std::uint32_t sourceStamp, QString* error) {
+    auto fail = [error](const QString& why) {
+        if (error) *error = why;
+        return false;
+    };
+
+    std::vector<Record> records(items.size());
+    QByteArray heap;
+    auto put = [&heap](const std::string& s, std::uint32_t* offset, std::uint32_t* length) {
+        *offset = static_cast<std::uint32_t>(heap.size());
+        *length = static_cast<std::uint32_t>(s.size());
+        heap.append(s.data(), static_cast<int>(s.size()));
+    };
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        const ItemSummary& s = items[i];
+        Record& r = records[i];
+        put(s.id, &r.idOffset, &r.idLength);
+        put(s.title, &r.titleOffset, &r.titleLength);
+        put(s.authorOrCreator, &r.authorOffset, &r.authorLength);
+        r.format = static_cast<std::uint8_t>(s.format);
+        r.status = static_cast<std::uint8_t>(s.status);
+        r.padding[0] = r.padding[1] = 0;
+    }
+
+    // Byte order, matching SQLite's default BINARY collation for ORDER BY title
+    std::vector<std::uint32_t> index(items.size());
+    std::iota(index.begin(), index.end(), 0u);
+    std::stable_sort(index.begin(), index.end(), [&items](std::uint32_t a, std::uint32_t b) {
+        return items[a].title < items[b].title;
+    });
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = kVersion;
+    h.count = static_cast<std::uint32_t>(items.size());
+    h.sourceStamp = sourceStamp;
+    h.writtenAt = QDateTime::currentMSecsSinceEpoch();
+    h.heapSize = static_cast<std::uint64_t>(heap.size());
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) return fail(out.errorString());
+    const qint64 recordBytes = static_cast<qint64>(records.size() * sizeof(Record));
+    const qint64 indexBytes = static_cast<qint64>(index.size() * sizeof(std::uint32_t));
+    if (out.write(reinterpret_cast<const char*>(&h), sizeof h) != sizeof h
+        || out.write(reinterpret_cast<const char*>(records.data()), recordBytes) != recordBytes
+        || out.write(reinterpret_cast<const char*>(index.data()), indexBytes) != indexBytes
+        || out.write(heap) != heap.size()) {
+        out.cancelWriting();
+        return fail(out.errorString());
+    }
+    if (!out.commit()) return fail(out.errorString());
+    return true;
+}
+
+const CatalogueSnapshot::Record& CatalogueSnapshot::record(std::size_t rank) const {
+    return records_[titleIndex_[rank]];
+}
+
+std::string_view CatalogueSnapshot::text(std::uint32_t offset, std::uint32_t length) const {
+    return std::string_view(heap_ + offset, length);
+}
+
+std::string_view CatalogueSnapshot::id(std::size_t rank) const {
+    const Record& r = record(rank);
+    return text(r.idOffset, r.idLength);
+}
+
+std::string_view CatalogueSnapshot::title(std::size_t rank) const {
+    const Record& r = record(rank);
+    return text(r.titleOffset, r.titleLength);
+}
+
+std::string_view CatalogueSnapshot::authorOrCreator(std::size_t rank) const {
+    const Record& r = record(rank);
+    return text(r.authorOffset, r.authorLength);
+}
+
+ItemFormat CatalogueSnapshot::format(std::size_t rank) const {
+    return static_cast<ItemFormat>(record(rank).format);
+}
+
+ItemStatus CatalogueSnapshot::status(std::size_t rank) const {
+    return static_cast<ItemStatus>(record(rank).status);
+}
+
+ItemSummary CatalogueSnapshot::summary(std::size_t rank) const {
+    ItemSummary s;
+    s.id = std::string(id(rank));
+    s.title = std::string(title(rank));
+    s.authorOrCreator = std::string(authorOrCreator(rank));
+    s.format = format(rank);
+    s.status = status(rank);
+    return s;
+}
+
+std::vector<ItemSummary> CatalogueSnapshot::summaries(bool availableOnly) const {
+    std::vector<ItemSummary> out;
+    out.reserve(count_);
+    for (std::size_t i = 0; i < count_; ++i) {
+        if (availableOnly && status(i) != ItemStatus::Available) continue;
+        out.push_back(summary(i));
+    }
+    return out;
+}
+
+} // namespace hinlibs
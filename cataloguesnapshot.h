@@ -0,0 +1,76 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+namespace hinlibs {
+
+// Read-only, memory-mapped copy of the catalogue summaries, used to draw the
+// home screen before SQLite has been queried. The file is versioned and laid
+// out for direct access, so opening it is a map plus a bounds check:
+//
+//   Header
+//   Record[count]          fixed width, in the order written
+//   quint32[count]         title index: record numbers in title order
+//   string heap            UTF-8, not terminated
+//
+// All integers are little-endian. sourceStamp is Database::CatalogueStamp()
+// at the time of writing; a snapshot whose stamp differs from the database's
+// is stale and should be rewritten.
+class CatalogueSnapshot {
+public:
+    static constexpr std::uint32_t kVersion = 1;
+
+    CatalogueSnapshot(const CatalogueSnapshot&) = delete;
+    CatalogueSnapshot& operator=(const CatalogueSnapshot&) = delete;
+    ~CatalogueSnapshot();
+
+    // Maps the file at path. Returns nullptr (and sets *error) when it is
+    // missing, from another version, or fails validation.
+    static std::unique_ptr<CatalogueSnapshot> Open(const QString& path, QString* error = nullptr);
+
+    // Writes summaries to path atomically (temporary file + rename).
+    static bool Write(const QString& path, const std::vector<ItemSummary>& items,
+                      std::uint32_t sourceStamp, QString* error = nullptr);
+
+    std::size_t size() const { return count_; }
+    std::uint32_t sourceStamp() const { return sourceStamp_; }
+    qint64 writtenAtMsecs() const { return writtenAt_; }
+
+    // Accessors take a position in title order. Views point into the
+    // mapping and stay valid for the lifetime of the snapshot.
+    std::string_view id(std::size_t rank) const;
+    std::string_view title(std::size_t rank) const;
+    std::string_view authorOrCreator(std::size_t rank) const;
+    ItemFormat format(std::size_t rank) const;
+    ItemStatus status(std::size_t rank) const;
+
+    ItemSummary summary(std::size_t rank) const;
+    // Every summary in title order, optionally only those available.
+    std::vector<ItemSummary> summaries(bool availableOnly) const;
+
+private:
+    struct Record;
+
+    CatalogueSnapshot() = default;
+    const Record& record(std::size_t rank) const;
+    std::string_view text(std::uint32_t offset, std::uint32_t length) const;
+
+    QFile file_;
+    const uchar* base_ = nullptr;
+    const Record* records_ = nullptr;
+    const std::uint32_t* titleIndex_ = nullptr;
+    const char* heap_ = nullptr;
+    std::size_t count_ = 0;
+    std::uint32_t sourceStamp_ = 0;
+    qint64 writtenAt_ = 0;
+};
+
+} // namespace hinlibs
@@ -0,0 +1,31 @@
+#include "changenotifier.h"
+
+#include <QMetaMethod>
+#include <QTimer>
+
+namespace hinlibs {
+
+ChangeNotifier::ChangeNotifier(QObject* parent) : QObject(parent) {
+    // Needed for queued connections from windows on other threads
+    qRegisterMetaType<QVector<hinlibs::ChangeEvent>>("QVector<hinlibs::ChangeEvent>");
+}
+
+void ChangeNotifier::publish(ChangeEvent event) {
+    static const QMetaMethod changedSignal = QMetaMethod::fromSignal(&ChangeNotifier::changed);
+    if (!isSignalConnected(changedSignal)) return;
+
+    pending_.push_back(std::move(event));
+    if (flushScheduled_) return;
+    flushScheduled_ = true;
+    QTimer::singleShot(0, this, &ChangeNotifier::flush);
+}
+
+void ChangeNotifier::flush() {
+    flushScheduled_ = false;
+    if (pending_.isEmpty()) return;
+    QVector<ChangeEvent> events;
+    events.swap(pending_);
+    emit changed(events);
+}
+
+} // namespace hinlibs
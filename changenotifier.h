@@ -0,0 +1,51 @@
+#pragma once
+
+#include "types.h"
+
+#include <QMetaType>
+#include <QObject>
+#include <QVector>
+
+namespace hinlibs {
+
+enum class ChangeKind {
+    ItemAdded,
+    ItemRemoved,
+    ItemStatusChanged,  // status carries the new value
+    LoanCreated,
+    LoanClosed,
+    HoldQueueChanged    // a hold was placed or cancelled on itemId
+};
+
+struct ChangeEvent {
+    ChangeKind kind = ChangeKind::ItemStatusChanged;
+    ItemId     itemId;
+    PatronId   patronId;                        // loans and holds only
+    ItemStatus status = ItemStatus::Available;  // ItemStatusChanged only
+};
+
+// Publishes Database changes to the UI. Database calls publish() after each
+// successful commit; events are collected and delivered as one changed()
+// signal per event-loop pass, so a burst of returns repaints once. Nothing
+// is collected while no one is connected, which keeps headless tools (no
+// event loop) free of the cost.
+class ChangeNotifier : public QObject {
+    Q_OBJECT
+public:
+    explicit ChangeNotifier(QObject* parent = nullptr);
+
+    void publish(ChangeEvent event);
+
+signals:
+    void changed(const QVector<hinlibs::ChangeEvent>& events);
+
+private:
+    void flush();
+
+    QVector<ChangeEvent> pending_;
+    bool flushScheduled_ = false;
+};
+
+} // namespace hinlibs
+
+Q_DECLARE_METATYPE(hinlibs::ChangeEvent)
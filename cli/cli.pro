@@ -0,0 +1,25 @@
+# Headless command-line client; see main.cpp for commands.
+
+QT -= gui
+QT += network
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = hinlibs-cli
+
+include(../hinlibs_core.pri)
+
+# backup and restore use SQLite's online backup API directly
+LIBS += -lsqlite3
+
+# Speaks the hinlibs-server protocol, and runs it in-process without --server
+INCLUDEPATH += $$PWD/../server
+
+SOURCES += \
+    ../server/circulationclient.cpp \
+    ../server/protocol.cpp \
+    main.cpp
+
+HEADERS += \
+    ../server/circulationclient.h \
+    ../server/protocol.h
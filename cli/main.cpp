@@ -0,0 +1,530 @@
+// hinlibs-cli: headless front end to the core library. Runs one patron or
+// catalogue command and exits, so circulation can be scripted (or driven over
+// ssh) without a display server. With --server the command goes to a running
+// hinlibs-server instead of opening the database file.
+//
+//   hinlibs-cli [--db path | --server name] catalogue [--all]
+//   hinlibs-cli [--db path | --server name] item <itemId>
+//   hinlibs-cli [--db path | --server name] status <username>
+//   hinlibs-cli [--db path | --server name] borrow|return|hold|cancel <username> <itemId>
+//   hinlibs-cli [--db path | --server name] pay <username> <cents>
+//   hinlibs-cli [--db path] waive <username> <cents>
+//   hinlibs-cli [--db path] import [--format csv|mrk] [--threads n] <file>
+//   hinlibs-cli [--db path] export [--format csv|jsonl] [--item-format f] [--status s]
+//               [--out path] items|loans|holds|all[,...]
+//   hinlibs-cli [--db path] backup [--out dir] [--keep n] [--pages n] [--pause ms] [--progress]
+//   hinlibs-cli [--db path] restore <backupFile>
+//   hinlibs-cli verify <backupFile>
+//   hinlibs-cli oplog dump <log>
+//   hinlibs-cli oplog checkpoint [--checkpoint old] <log> <out>
+//   hinlibs-cli [--db path] oplog checkpoint-db <log> <out>
+//   hinlibs-cli [--db path] oplog replay [--checkpoint file] [--apply] <log>
+//
+// Local borrow/return/hold/cancel/pay/waive append to the operation log
+// given with --oplog.
+//
+// Exit status: 0 on success, 1 when the command was refused (or, for import,
+// some records were rejected), 2 on usage, database or connection errors.
+
+#include "backup.h"
+#include "catalogueexport.h"
+#include "catalogueimport.h"
+#include "circulationclient.h"
+#include "database.h"
+#include "oplog.h"
+#include "protocol.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTextStream>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace hinlibs;
+
+namespace {
+
+void printSummary(QTextStream& out, const QJsonObject& s) {
+    out << s.value("id").toString() << "\t" << s.value("title").toString() << "\t"
+        << s.value("author").toString() << "\t" << s.value("format").toString() << "\t"
+        << s.value("status").toString() << "\n";
+}
+
+void printResult(QTextStream& out, const QString& command, const QJsonObject& request, const QJsonObject& response) {
+    const QJsonValue result = response.value("result");
+    const QString item = request.value("item").toString();
+
+    if (command == "catalogue") {
+        for (const QJsonValue& v : result.toArray()) printSummary(out, v.toObject());
+    } else if (command == "item") {
+        const QJsonObject d = result.toObject();
+        printSummary(out, d);
+        static const char* const extras[][2] = {
+            { "year", "Year" }, { "isbn", "ISBN" }, { "dewey", "Dewey" },
+            { "genre", "Genre" }, { "rating", "Rating" }, { "issue", "Issue" },
+        };
+        for (const auto& e : extras) {
+            if (d.contains(e[0])) out << e[1] << ":\t" << d.value(e[0]).toVariant().toString() << "\n";
+        }
+    } else if (command == "status") {
+        const QJsonArray loans = result.toObject().value("loans").toArray();
+        const QJsonArray holds = result.toObject().value("holds").toArray();
+        out << "Loans (" << loans.size() << "):\n";
+        for (const QJsonValue& v : loans) {
+            const QJsonObject l = v.toObject();
+            out << "  " << l.value("item").toString() << "\t" << l.value("title").toString()
+                << "\tdue " << l.value("dueDate").toString() << "\n";
+        }
+        out << "Holds (" << holds.size() << "):\n";
+        for (const QJsonValue& v : holds) {
+            const QJsonObject h = v.toObject();
+            out << "  " << h.value("item").toString() << "\t" << h.value("title").toString()
+                << "\tposition " << h.value("position").toInt() << "\n";
+        }
+        const QJsonValue limit = result.toObject().value("fineLimit");
+        out << "Fines owed: " << QString::number(result.toObject().value("finesOwed").toDouble() / 100.0, 'f', 2)
+            << (!limit.isDouble() ? QString(" (no limit)")
+                               : QString(" (checkout refused above %1)").arg(limit.toDouble() / 100.0, 0, 'f', 2))
+            << "\n";
+    } else if (command == "borrow") {
+        out << "Borrowed " << item << ", due " << result.toObject().value("dueDate").toString() << "\n";
+    } else if (command == "return") {
+        out << "Returned " << item << "\n";
+    } else if (command == "hold") {
+        out << (response.contains("message") ? "Already holding " : "Hold placed on ") << item
+            << ", position " << result.toObject().value("position").toInt() << "\n";
+    } else if (command == "cancel") {
+        out << "Hold cancelled on " << item << "\n";
+    } else if (command == "pay" || command == "waive") {
+        if (response.contains("message")) out << response.value("message").toString() << ", ";
+        out << "balance " << QString::number(result.toObject().value("balance").toDouble() / 100.0, 'f', 2) << "\n";
+    }
+}
+
+bool openDatabase(const QString& path, QTextStream& err) {
+    if (!QFileInfo::exists(path)) {
+        err << "No database at " << path << "\n";
+        return false;
+    }
+    QSqlDatabase sqlDb = QSqlDatabase::addDatabase("QSQLITE");
+    sqlDb.setDatabaseName(path);
+    if (!sqlDb.open()) {
+        err << "Cannot open " << path << "\n";
+        return false;
+    }
+    // Readers (exports, backups) then never block the desks' writes.
+    QSqlQuery(sqlDb).exec("PRAGMA journal_mode=WAL");
+    return true;
+}
+
+int runImport(const QString& path, const QString& format, int threads, QTextStream& out, QTextStream& err) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        err << "Cannot read " << path << "\n";
+        return 2;
+    }
+
+    ImportOptions options;
+    options.format = format.isEmpty() ? GuessImportFormat(path)
+                                      : (format == "mrk" ? ImportFormat::Mrk : ImportFormat::Csv);
+    options.parserThreads = threads;
+
+    ImportReport report;
+    const bool ok = ImportCatalogue(QSqlDatabase::database(), file, options, &report);
+    for (const auto& e : report.errors) err << QString::fromStdString(e) << "\n";
+    if (report.rejected > report.errors.size()) err << "... " << (report.rejected - report.errors.size()) << " more rejected\n";
+
+    out << "Imported " << report.imported << " of " << report.records << " records ("
+        << report.rejected << " rejected) in " << QString::number(report.seconds, 'f', 2) << " s: "
+        << QString::number(report.recordsPerSecond(), 'f', 0) << " records/s, "
+        << QString::number(report.seconds > 0 ? report.bytes / 1e6 / report.seconds : 0.0, 'f', 1) << " MB/s\n";
+    if (!ok) {
+        err << "Import stopped: " << QString::fromStdString(report.fatal) << "\n";
+        return 2;
+    }
+    return report.rejected ? 1 : 0;
+}
+
+int runExport(const QString& tableList, const QString& format, const QString& itemFormat,
+              const QString& status, const QString& outPath, QTextStream& err) {
+    std::vector<ExportTable> tables;
+    for (const QString& t : tableList.toLower().split(',', Qt::SkipEmptyParts)) {
+        if (t == "items" || t == "all") tables.push_back(ExportTable::Items);
+        if (t == "loans" || t == "all") tables.push_back(ExportTable::Loans);
+        if (t == "holds" || t == "all") tables.push_back(ExportTable::Holds);
+        if (t != "items" && t != "loans" && t != "holds" && t != "all") {
+            err << "Unknown table: " << t << "\n";
+            return 2;
+        }
+    }
+
+    ExportOptions options;
+    options.format = format == "jsonl" ? ExportFormat::JsonLines : ExportFormat::Csv;
+    if (!itemFormat.isEmpty()) {
+        const QString f = itemFormat.toLower();
+        if (f == "book") options.itemFormat = ItemFormat::Book;
+        else if (f == "magazine") options.itemFormat = ItemFormat::Magazine;
+        else if (f == "movie") options.itemFormat = ItemFormat::Movie;
+        else if (f == "videogame") options.itemFormat = ItemFormat::VideoGame;
+        else { err << "Unknown item format: " << itemFormat << "\n"; return 2; }
+    }
+    if (!status.isEmpty()) {
+        const QString st = status.toLower();
+        if (st == "available") options.itemStatus = ItemStatus::Available;
+        else if (st == "checkedout") options.itemStatus = ItemStatus::CheckedOut;
+        else { err << "Unknown status: " << status << "\n"; return 2; }
+    }
+
+    // One table goes to --out or stdout; several go to <dir>/<table>.<ext>.
+    std::vector<std::unique_ptr<QFile>> files;
+    std::vector<ExportTarget> targets;
+    const QString ext = options.format == ExportFormat::Csv ? "csv" : "jsonl";
+    for (ExportTable t : tables) {
+        auto file = std::make_unique<QFile>();
+        bool opened;
+        if (tables.size() == 1 && outPath.isEmpty()) {
+            opened = file->open(stdout, QIODevice::WriteOnly);
+        } else if (tables.size() == 1) {
+            file->setFileName(outPath);
+            opened = file->open(QIODevice::WriteOnly | QIODevice::Truncate);
+        } else {
+            const QString dir = outPath.isEmpty() ? QString(".") : outPath;
+            QDir().mkpath(dir);
+            file->setFileName(QDir(dir).filePath(QString("%1.%2").arg(ExportTableName(t), ext)));
+            opened = file->open(QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+        if (!opened) {
+            err << "Cannot write " << file->fileName() << "\n";
+            return 2;
+        }
+        targets.push_back({ t, file.get() });
+        files.push_back(std::move(file));
+    }
+
+    ExportReport report;
+    const bool ok = ExportCatalogue(QSqlDatabase::database(), targets, options, &report);
+    err << "Exported " << report.rows << " rows, " << QString::number(report.bytes / 1e6, 'f', 1) << " MB in "
+        << QString::number(report.seconds, 'f', 2) << " s\n";
+    if (!ok) {
+        err << "Export failed: " << QString::fromStdString(report.error) << "\n";
+        return 2;
+    }
+    return 0;
+}
+
+void printBackupReport(QTextStream& err, const char* verb, const BackupReport& r) {
+    err << verb << " " << r.pages << " pages (" << QString::number(r.bytes / 1e6, 'f', 1) << " MB) in "
+        << QString::number(r.seconds, 'f', 2) << " s, " << QString::number(r.megabytesPerSecond(), 'f', 1) << " MB/s\n"
+        << "  " << r.steps << " steps, source locked " << QString::number(r.lockedSeconds * 1000, 'f', 0)
+        << " ms in total, longest " << QString::number(r.longestStepMs, 'f', 1) << " ms\n"
+        << "  " << r.busyRetries << " busy retries, " << r.restarts << " restarts"
+        << (r.finishedInOneStep ? " (rest copied in one step)" : "")
+        << (r.verified ? ", verified" : "") << "\n";
+}
+
+// With progress, "progress <copied> <total>" goes to stdout after every
+// step, ahead of the backup's path; the desktop app runs backups this way.
+int runBackup(const QString& dbPath, const QString& outDir, int keep, BackupOptions options, bool progress,
+              QTextStream& out, QTextStream& err) {
+    if (!QFileInfo::exists(dbPath)) {
+        err << "No database at " << dbPath << "\n";
+        return 2;
+    }
+    const QString dir = outDir.isEmpty() ? QFileInfo(dbPath).absoluteDir().filePath("backups") : outDir;
+    if (!QDir().mkpath(dir)) {
+        err << "Cannot create " << dir << "\n";
+        return 2;
+    }
+
+    if (progress) {
+        options.onStep = [&out, pause = options.pauseBetweenSteps](int copied, int total) {
+            out << "progress " << copied << " " << total << "\n";
+            out.flush();
+            std::this_thread::sleep_for(pause);
+            return true;
+        };
+    }
+    BackupReport report;
+    const QString target = QDir(dir).filePath(BackupFileName(QDateTime::currentDateTime()));
+    if (!BackupDatabase(dbPath, target, options, &report)) {
+        err << "Backup failed: " << QString::fromStdString(report.error) << "\n";
+        return 2;
+    }
+    printBackupReport(err, "Copied", report);
+    out << target << "\n";
+    if (keep > 0) {
+        for (const QString& name : RotateBackups(dir, keep)) err << "Removed " << name << "\n";
+    }
+    return 0;
+}
+
+int runRestore(const QString& backupPath, const QString& dbPath, QTextStream& err) {
+    BackupOptions options;
+    options.pauseBetweenSteps = std::chrono::milliseconds(0);   // nothing else should be running
+    BackupReport report;
+    if (!RestoreDatabase(backupPath, dbPath, options, &report)) {
+        err << "Restore failed: " << QString::fromStdString(report.error) << "\n";
+        return 2;
+    }
+    printBackupReport(err, "Restored", report);
+    return 0;
+}
+
+int runOpLog(const QStringList& args, const QString& checkpoint, bool apply, const QString& dbPath,
+             QTextStream& out, QTextStream& err) {
+    const QString sub = args.value(1);
+    if (sub == "dump" && args.size() == 3) {
+        OpLogReader reader;
+        QString error;
+        if (!reader.open(args.at(2), &error)) {
+            err << error << "\n";
+            return 2;
+        }
+        OpRecord r;
+        while (reader.next(&r)) {
+            out << r.seq << "\t" << QDateTime::fromMSecsSinceEpoch(r.atMs, Qt::UTC).toString(Qt::ISODate) << "\t"
+                << OpKindName(r.kind) << "\t" << QString::fromStdString(r.patronId) << "\t"
+                << QString::fromStdString(r.itemId) << "\t" << QString::fromStdString(r.recordId) << "\t"
+                << static_cast<qint64>(r.value) << "\n";
+        }
+        if (reader.tornTail()) {
+            err << "Log ends in a damaged record after byte " << reader.validBytes() << "\n";
+            if (const std::uint64_t past = reader.recordsPastDamage()) {
+                err << past << " intact records follow the damage and are not listed\n";
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // The live loans, holds and fine balances as a checkpoint at the log's
+    // last record, so a later replay --apply keeps circulation that predates
+    // the log. Records committed while this runs may be counted twice;
+    // replay reports those.
+    if (sub == "checkpoint-db" && args.size() == 4) {
+        OpLogReader reader;
+        QString error;
+        if (!reader.open(args.at(2), &error)) {
+            err << error << "\n";
+            return 2;
+        }
+        if (reader.isCheckpoint()) {
+            err << args.at(2) << " is a checkpoint, not a log\n";
+            return 2;
+        }
+        std::uint64_t seq = reader.baseSequence();
+        OpRecord r;
+        while (reader.next(&r)) seq = std::max(seq, r.seq);
+        if (reader.tornTail() && reader.recordsPastDamage() > 0) {
+            err << "Log is damaged after #" << seq << " with intact records after it\n";
+            return 2;
+        }
+        if (!openDatabase(dbPath, err)) return 2;
+        Database migrate(QSqlDatabase::database());   // older files lack the fine columns
+        CirculationState state;
+        if (!ReadCirculation(QSqlDatabase::database(), seq, &state, &error)
+            || !WriteOpLogCheckpoint(args.at(3), state, &error)) {
+            err << "Cannot write checkpoint: " << error << "\n";
+            return 2;
+        }
+        std::size_t holds = 0;
+        for (const auto& q : state.holds) holds += q.second.size();
+        err << "Checkpoint at #" << seq << ": " << state.loans.size() << " loans, " << holds << " holds, "
+            << state.fines.size() << " fine balances\n";
+        return 0;
+    }
+
+    const bool toCheckpoint = sub == "checkpoint" && args.size() == 4;
+    if (!toCheckpoint && !(sub == "replay" && args.size() == 3)) {
+        err << "Usage: oplog dump <log> | oplog checkpoint <log> <out> | oplog checkpoint-db <log> <out>"
+               " | oplog replay <log>\n";
+        return 2;
+    }
+
+    CirculationState state;
+    ReplayReport report;
+    if (!ReplayOpLog(checkpoint, args.at(2), &state, &report)) {
+        err << "Replay failed: " << QString::fromStdString(report.error) << "\n";
+        return 2;
+    }
+    for (const auto& p : report.problems) err << QString::fromStdString(p) << "\n";
+    if (report.tornTail) err << "Log ends in a damaged record; replayed up to it\n";
+    std::size_t holds = 0;
+    for (const auto& q : state.holds) holds += q.second.size();
+    err << "Replayed " << report.applied << " records (" << report.skipped << " before the checkpoint, "
+        << report.checkpointRecords << " from it) to #" << state.seq << ": "
+        << state.loans.size() << " loans, " << holds << " holds, "
+        << state.fines.size() << " fine balances\n";
+
+    if (toCheckpoint) {
+        QString error;
+        if (!WriteOpLogCheckpoint(args.at(3), state, &error)) {
+            err << "Cannot write checkpoint: " << error << "\n";
+            return 2;
+        }
+        return 0;
+    }
+    if (apply) {
+        // The tables are replaced wholesale: anything the replay got wrong
+        // or never saw would be lost
+        if (!report.problems.empty()) {
+            err << "Not applying a replay with problems\n";
+            return 1;
+        }
+        if (checkpoint.isEmpty()) {
+            err << "--apply needs --checkpoint (see oplog checkpoint-db); the log alone "
+                   "does not hold loans and holds from before it began\n";
+            return 2;
+        }
+        if (!openDatabase(dbPath, err)) return 2;
+        Database migrate(QSqlDatabase::database());   // older files lack the fine columns
+        QString error;
+        if (!RestoreCirculation(QSqlDatabase::database(), state, &error)) {
+            err << "Cannot rebuild loans and holds: " << error << "\n";
+            return 2;
+        }
+        err << "Rebuilt loans, holds and fine balances in " << dbPath << "\n";
+    }
+    return report.problems.empty() ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("hinlibs-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless HinLIBS client.");
+    parser.addHelpOption();
+    QCommandLineOption dbOpt("db", "Database file (default: hinlibs.sqlite3 in the current directory).", "path");
+    QCommandLineOption serverOpt("server", "Send the command to a running hinlibs-server instead.", "name");
+    QCommandLineOption allOpt("all", "catalogue: include checked-out items.");
+    QCommandLineOption formatOpt("format", "import: csv or mrk (default: from the file extension); export: csv (default) or jsonl.", "format");
+    QCommandLineOption threadsOpt("threads", "import: parser threads (default: one per core).", "n");
+    QCommandLineOption itemFormatOpt("item-format", "export: only Book, Magazine, Movie or VideoGame items.", "format");
+    QCommandLineOption statusOpt("status", "export: only Available or CheckedOut items.", "status");
+    QCommandLineOption outOpt("out", "export: output file, or directory when exporting several tables; "
+                                     "backup: directory (default: backups/ next to the database).", "path");
+    QCommandLineOption keepOpt("keep", "backup: keep only the newest n backups in the directory.", "n");
+    QCommandLineOption pagesOpt("pages", "backup: pages copied per step (default 256).", "n");
+    QCommandLineOption pauseOpt("pause", "backup: milliseconds between steps (default 20).", "ms");
+    QCommandLineOption progressOpt("progress", "backup: print \"progress <copied> <total>\" after every step.");
+    QCommandLineOption opLogOpt("oplog", "Append local circulation changes to this operation log.", "path");
+    QCommandLineOption checkpointOpt("checkpoint", "oplog: start from this checkpoint.", "path");
+    QCommandLineOption applyOpt("apply", "oplog replay: rebuild loans, holds and fine balances in --db "
+                                         "(needs --checkpoint; refused if the replay reports problems).");
+    parser.addOptions({ dbOpt, serverOpt, allOpt, formatOpt, threadsOpt, itemFormatOpt, statusOpt, outOpt, keepOpt, pagesOpt,
+                        pauseOpt, progressOpt, opLogOpt, checkpointOpt, applyOpt });
+    parser.addPositionalArgument("command", "catalogue, item, status, borrow, return, hold, cancel, pay, waive, "
+                                            "import, export, backup, restore, verify or oplog.");
+    parser.addPositionalArgument("args", "Username and/or item id, depending on the command.", "[args...]");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QStringList args = parser.positionalArguments();
+    const QString command = args.value(0);
+    const QString dbPath = parser.isSet(dbOpt) ? parser.value(dbOpt) : QString("hinlibs.sqlite3");
+
+    // ----- Local-only commands -----
+    if (command == "import" && args.size() == 2 && !parser.isSet(serverOpt)) {
+        if (!openDatabase(dbPath, err)) return 2;
+        return runImport(args.at(1), parser.value(formatOpt).toLower(), parser.value(threadsOpt).toInt(), out, err);
+    }
+    if (command == "export" && args.size() == 2 && !parser.isSet(serverOpt)) {
+        if (!openDatabase(dbPath, err)) return 2;
+        return runExport(args.at(1), parser.value(formatOpt).toLower(), parser.value(itemFormatOpt),
+                         parser.value(statusOpt), parser.value(outOpt), err);
+    }
+
+    if (command == "backup" && args.size() == 1 && !parser.isSet(serverOpt)) {
+        BackupOptions options;
+        if (parser.value(pagesOpt).toInt() > 0) options.pagesPerStep = parser.value(pagesOpt).toInt();
+        if (parser.isSet(pauseOpt)) options.pauseBetweenSteps = std::chrono::milliseconds(std::max(0, parser.value(pauseOpt).toInt()));
+        return runBackup(dbPath, parser.value(outOpt), parser.value(keepOpt).toInt(), options, parser.isSet(progressOpt), out, err);
+    }
+    if (command == "restore" && args.size() == 2 && !parser.isSet(serverOpt)) {
+        return runRestore(args.at(1), dbPath, err);
+    }
+    if (command == "verify" && args.size() == 2) {
+        QString error;
+        if (!VerifyBackup(args.at(1), &error)) {
+            err << error << "\n";
+            return 1;
+        }
+        out << args.at(1) << ": ok\n";
+        return 0;
+    }
+
+    if (command == "oplog" && !parser.isSet(serverOpt)) {
+        return runOpLog(args, parser.value(checkpointOpt), parser.isSet(applyOpt), dbPath, out, err);
+    }
+
+    // ----- Build the request -----
+    QJsonObject request;
+    request["op"] = command;
+    if (command == "catalogue" && args.size() == 1) {
+        request["all"] = parser.isSet(allOpt);
+    } else if (command == "item" && args.size() == 2) {
+        request["item"] = args.at(1);
+    } else if (command == "status" && args.size() == 2) {
+        request["user"] = args.at(1);
+    } else if ((command == "pay" || command == "waive") && args.size() == 3) {
+        request["user"] = args.at(1);
+        request["cents"] = args.at(2).toLongLong();
+    } else if (service::IsWriteOp(command) && args.size() == 3) {
+        request["user"] = args.at(1);
+        request["item"] = args.at(2);
+    } else {
+        if (!args.isEmpty()) err << "Unknown command or wrong arguments: " << args.join(' ') << "\n\n";
+        parser.showHelp(2);
+    }
+
+    // ----- Run it locally or on the server -----
+    QJsonObject response;
+    if (parser.isSet(serverOpt)) {
+        CirculationClient client;
+        if (!client.connectTo(parser.value(serverOpt))) {
+            err << "Cannot connect to " << parser.value(serverOpt) << ": " << client.errorString() << "\n";
+            return 2;
+        }
+        const auto r = client.call(request);
+        if (!r) {
+            err << "No response from " << parser.value(serverOpt) << "\n";
+            return 2;
+        }
+        response = *r;
+    } else {
+        if (!openDatabase(dbPath, err)) return 2;
+        Database db(QSqlDatabase::database());
+        if (parser.isSet(opLogOpt)) {
+            auto log = std::make_shared<OpLogWriter>(parser.value(opLogOpt));
+            QString error;
+            if (!log->open(&error)) {
+                err << "Cannot open operation log: " << error << "\n";
+                return 2;
+            }
+            db.AttachOpLog(std::move(log));
+        }
+        response = service::HandleLocalRequest(db, request);
+    }
+
+    if (!response.value("ok").toBool()) {
+        err << response.value("message").toString() << "\n";
+        return response.value("error").toString() == "StorageError" ? 2 : 1;
+    }
+    printResult(out, command, request, response);
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "clock.h"
+
+namespace hinlibs {
+
+std::shared_ptr<const Clock> SystemClock::instance() {
+    static const auto clock = std::make_shared<const SystemClock>();
+    return clock;
+}
+
+SimulatedClock::SimulatedClock() : SimulatedClock(std::chrono::system_clock::now()) {}
+
+SimulatedClock::SimulatedClock(time_point start) : ticks_(start.time_since_epoch().count()) {}
+
+Clock::time_point SimulatedClock::now() const {
+    return time_point{ std::chrono::system_clock::duration{ ticks_.load(std::memory_order_acquire) } };
+}
+
+void SimulatedClock::set(time_point t) {
+    ticks_.store(t.time_since_epoch().count(), std::memory_order_release);
+}
+
+Clock::time_point SimulatedClock::advance(std::chrono::system_clock::duration by) {
+    const auto ticks = ticks_.fetch_add(by.count(), std::memory_order_acq_rel) + by.count();
+    return time_point{ std::chrono::system_clock::duration{ ticks } };
+}
+
+} // namespace hinlibs
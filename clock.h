@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace hinlibs {
+
+// Source of "now" for everything date-dependent: checkout and due dates,
+// days remaining, operation log stamps. Database and Session take one so
+// tests and workload simulations can move time instead of waiting for it.
+class Clock {
+public:
+    using time_point = std::chrono::system_clock::time_point;
+
+    virtual ~Clock() = default;
+    virtual time_point now() const = 0;
+};
+
+// Wall-clock time. Shared by every Database that was not given a clock.
+class SystemClock : public Clock {
+public:
+    time_point now() const override { return std::chrono::system_clock::now(); }
+
+    static std::shared_ptr<const Clock> instance();
+};
+
+// Time that only moves when told to. Thread-safe: workers on several
+// connections may share one and advance it concurrently.
+class SimulatedClock : public Clock {
+public:
+    // Starts at the current wall-clock time.
+    SimulatedClock();
+    explicit SimulatedClock(time_point start);
+
+    time_point now() const override;
+
+    void set(time_point t);
+    // Returns the new time.
+    time_point advance(std::chrono::system_clock::duration by);
+
+private:
+    std::atomic<std::chrono::system_clock::rep> ticks_;
+};
+
+} // namespace hinlibs
@@ -0,0 +1,58 @@
+# libhinlibscore: domain + database layer, QtCore/QtSql only.
+# Linked by the desktop app and every headless tool via hinlibs_core.pri.
+
+TEMPLATE = lib
+CONFIG += staticlib c++17
+QT = core sql
+
+TARGET = hinlibscore
+
+SRC = $$PWD/..
+INCLUDEPATH += $$SRC
+
+SOURCES += \
+    $$SRC/backup.cpp \
+    $$SRC/branchrouter.cpp \
+    $$SRC/catalogueexport.cpp \
+    $$SRC/catalogueimport.cpp \
+    $$SRC/cataloguesnapshot.cpp \
+    $$SRC/changenotifier.cpp \
+    $$SRC/clock.cpp \
+    $$SRC/database.cpp \
+    $$SRC/hold.cpp \
+    $$SRC/item.cpp \
+    $$SRC/librarian.cpp \
+    $$SRC/loan.cpp \
+    $$SRC/maintenance.cpp \
+    $$SRC/oplog.cpp \
+    $$SRC/patron.cpp \
+    $$SRC/querystats.cpp \
+    $$SRC/session.cpp \
+    $$SRC/sysadmin.cpp \
+    $$SRC/types.cpp \
+    $$SRC/user.cpp \
+    $$SRC/usernameindex.cpp
+
+HEADERS += \
+    $$SRC/backup.h \
+    $$SRC/branchrouter.h \
+    $$SRC/catalogueexport.h \
+    $$SRC/catalogueimport.h \
+    $$SRC/cataloguesnapshot.h \
+    $$SRC/changenotifier.h \
+    $$SRC/clock.h \
+    $$SRC/database.h \
+    $$SRC/hold.h \
+    $$SRC/item.h \
+    $$SRC/librarian.h \
+    $$SRC/loan.h \
+    $$SRC/lrucache.h \
+    $$SRC/maintenance.h \
+    $$SRC/oplog.h \
+    $$SRC/patron.h \
+    $$SRC/querystats.h \
+    $$SRC/session.h \
+    $$SRC/sysadmin.h \
+    $$SRC/types.h \
+    $$SRC/user.h \
+    $$SRC/usernameindex.h
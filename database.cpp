@@ -1,10 +1,18 @@
 #include "database.h"
+#include "catalogueimport.h"
+#include "cataloguesnapshot.h"
 #include "types.h"
 
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDateTime>
+#include <QRandomGenerator>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <algorithm>
+#include <unordered_map>
 
 namespace hinlibs {
 
@@ -52,30 +60,404 @@ static std::chrono::system_clock::time_point fromIso(const QString& iso) {
     return std::chrono::system_clock::time_point{std::chrono::seconds(dt.toSecsSinceEpoch())};
 }
 
+// Batched IN (...) lookups stay well under SQLite's default limit of 999
+// bound parameters.
+static constexpr std::size_t kInBatch = 500;
+
+static QString placeholders(std::size_t n) {
+    QStringList marks;
+    for (std::size_t i = 0; i < n; ++i) marks << "?";
+    return marks.join(',');
+}
+
 // ----- construction -----
-Database::Database(QSqlDatabase db) : db_(db) {}
+Database::Database(QSqlDatabase db) : db_(db) {
+    if (db_.isOpen()) {
+        ensureIndexes();
+        ensureFinesSchema();
+        ensureUserChangeTracking();
+        ensureCatalogueChangeTracking();
+    }
+}
+
+// Older database files predate these indexes; creating them is a no-op when
+// they already exist.
+void Database::ensureIndexes() {
+    static const char* const kIndexes[] = {
+        "CREATE INDEX IF NOT EXISTS idx_users_username_nocase ON users(username COLLATE NOCASE)",
+        "CREATE INDEX IF NOT EXISTS idx_loans_patron ON loans(patronId)",
+        "CREATE INDEX IF NOT EXISTS idx_holds_item ON holds(itemId, queuePosition)",
+        "CREATE INDEX IF NOT EXISTS idx_holds_patron_item ON holds(patronId, itemId)",
+    };
+    for (const char* sql : kIndexes) {
+        QSqlQuery q(db_);
+        q.prepare(sql);
+        if (!exec(q)) qDebug() << "ensureIndexes failed:" << q.lastError().text();
+    }
+
+    // Items indexes are dropped while a catalogue import runs, possibly in
+    // another process; that import rebuilds them, so leave them alone.
+    CatalogueImportLock importLock(db_);
+    if (!importLock.tryLock()) return;
+    // Put back items indexes that an interrupted catalogue import dropped.
+    QString error;
+    if (!RestoreDeferredIndexes(db_, &error)) qDebug() << "ensureIndexes: cannot restore deferred indexes:" << error;
+    QSqlQuery q(db_);
+    q.prepare("CREATE INDEX IF NOT EXISTS idx_items_title ON items(title)");
+    if (!exec(q)) qDebug() << "ensureIndexes failed:" << q.lastError().text();
+}
+
+// Database files from before fines have neither the balance and threshold
+// columns nor the rate table.
+void Database::ensureFinesSchema() {
+    auto hasColumn = [this](const char* table, const char* column) {
+        QSqlQuery q(db_);
+        q.prepare(QString("PRAGMA table_info(%1)").arg(table));
+        if (!exec(q)) return true;  // leave a database we cannot inspect alone
+        while (q.next()) {
+            if (q.value(1).toString() == column) return true;
+        }
+        return false;
+    };
+
+    QStringList statements;
+    if (!hasColumn("users", "fineBalanceCents"))
+        statements << "ALTER TABLE users ADD COLUMN fineBalanceCents INTEGER NOT NULL DEFAULT 0";
+    if (!hasColumn("policy", "fineThresholdCents"))
+        statements << "ALTER TABLE policy ADD COLUMN fineThresholdCents INTEGER DEFAULT 1000";
+
+    QSqlQuery t(db_);
+    t.prepare("SELECT 1 FROM sqlite_master WHERE type='table' AND name='fineRates'");
+    if (exec(t) && !t.next()) {
+        statements << "CREATE TABLE fineRates (format TEXT PRIMARY KEY, centsPerDay INTEGER NOT NULL, "
+                      "maxCentsPerLoan INTEGER NOT NULL)"
+                   << "INSERT INTO fineRates VALUES ('Book', 25, 1000), ('Magazine', 10, 500), "
+                      "('Movie', 100, 2500), ('VideoGame', 100, 3000)";
+    }
+
+    // Fines from returns in a file without the patron's record, and the
+    // branch fines already charged here; see ReturnItem and ChargeFine.
+    statements << "CREATE TABLE IF NOT EXISTS pendingFines (id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                  "patronId TEXT NOT NULL, cents INTEGER NOT NULL)"
+               << "CREATE TABLE IF NOT EXISTS chargedFines (reference TEXT PRIMARY KEY)";
+
+    for (const QString& sql : statements) {
+        QSqlQuery q(db_);
+        q.prepare(sql);
+        if (!exec(q)) qDebug() << "ensureFinesSchema failed:" << q.lastError().text();
+    }
+}
+
+// A one-row counter that triggers on users bump, so a Database can tell
+// that another connection (an import, the CLI, a second desk) changed user
+// records without re-reading them. Triggers are per row: bulk loads pay one
+// extra UPDATE per user.
+void Database::ensureUserChangeTracking() {
+    const char* const statements[] = {
+        "CREATE TABLE IF NOT EXISTS userChanges (generation INTEGER NOT NULL)",
+        "INSERT INTO userChanges SELECT 0 WHERE NOT EXISTS (SELECT 1 FROM userChanges)",
+        "CREATE TRIGGER IF NOT EXISTS users_changed_insert AFTER INSERT ON users "
+        "BEGIN UPDATE userChanges SET generation = generation + 1; END",
+        "CREATE TRIGGER IF NOT EXISTS users_changed_delete AFTER DELETE ON users "
+        "BEGIN UPDATE userChanges SET generation = generation + 1; END",
+        "CREATE TRIGGER IF NOT EXISTS users_changed_update AFTER UPDATE OF id, username, role ON users "
+        "BEGIN UPDATE userChanges SET generation = generation + 1; END",
+    };
+    for (const char* sql : statements) {
+        QSqlQuery q(db_);
+        q.prepare(sql);
+        if (!exec(q)) qDebug() << "ensureUserChangeTracking failed:" << q.lastError().text();
+    }
+    pollUserChanges();   // baseline for later polls
+}
+
+// The same for the columns a CatalogueSnapshot holds. The file change
+// counter in the SQLite header can't serve: in WAL mode it doesn't move on
+// commit.
+void Database::ensureCatalogueChangeTracking() {
+    const char* const statements[] = {
+        "CREATE TABLE IF NOT EXISTS catalogueChanges (generation INTEGER NOT NULL)",
+        "INSERT INTO catalogueChanges SELECT 1 WHERE NOT EXISTS (SELECT 1 FROM catalogueChanges)",
+        "CREATE TRIGGER IF NOT EXISTS items_changed_insert AFTER INSERT ON items "
+        "BEGIN UPDATE catalogueChanges SET generation = generation + 1; END",
+        "CREATE TRIGGER IF NOT EXISTS items_changed_delete AFTER DELETE ON items "
+        "BEGIN UPDATE catalogueChanges SET generation = generation + 1; END",
+        "CREATE TRIGGER IF NOT EXISTS items_changed_update "
+        "AFTER UPDATE OF id, title, authorOrCreator, format, status ON items "
+        "BEGIN UPDATE catalogueChanges SET generation = generation + 1; END",
+    };
+    for (const char* sql : statements) {
+        QSqlQuery q(db_);
+        q.prepare(sql);
+        if (!exec(q)) qDebug() << "ensureCatalogueChangeTracking failed:" << q.lastError().text();
+    }
+}
+
+// SQLITE_BUSY / SQLITE_LOCKED (primary codes, extended codes fold onto them)
+static bool isBusyError(const QSqlError& e) {
+    const int code = e.nativeErrorCode().toInt() & 0xff;
+    return code == 5 || code == 6;
+}
+
+// Every statement runs through here so callers can see how many round trips
+// a screen or an operation costs, and how long each one takes (see Stats()).
+bool Database::exec(QSqlQuery& q) const {
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = q.exec();
+    const auto elapsedNs = static_cast<std::uint64_t>(timer.nsecsElapsed());
+
+    long long rows = -1;
+    if (ok && stats_->countRows() && q.isSelect() && !q.isForwardOnly()) {
+        // Opt-in (see QueryStats::setCountRows): rows stay in Qt's cache.
+        rows = q.last() ? q.at() + 1 : 0;
+        q.seek(QSql::BeforeFirstRow);
+    }
+
+    stats_->recordStatement(q.lastQuery(), elapsedNs, rows, ok);
+    lastFailureBusy_ = !ok && isBusyError(q.lastError());
+    if (lastFailureBusy_) stats_->recordBusy();
+    return ok;
+}
+
+// BEGIN/COMMIT are where this connection waits on other writers, so their
+// time is tracked as lock wait.
+bool Database::begin(bool immediate) const {
+    QElapsedTimer timer;
+    timer.start();
+    bool ok;
+    if (txnDepth_ > 0) {
+        ok = savepoint("SAVEPOINT", txnDepth_);
+    } else if (immediate) {
+        QSqlQuery q(db_);
+        q.prepare("BEGIN IMMEDIATE");
+        ok = exec(q);
+    } else {
+        QSqlDatabase db(db_);
+        ok = db.transaction();
+    }
+    stats_->recordLockWait(static_cast<std::uint64_t>(timer.nsecsElapsed()));
+    if (ok) ++txnDepth_;
+    return ok;
+}
+
+bool Database::commit() const {
+    if (txnDepth_ > 1) {
+        if (!savepoint("RELEASE", --txnDepth_)) return false;
+        // This level's effects now stand or fall with the enclosing one, so
+        // rolling back a later sibling savepoint must not drop them
+        for (auto& pending : pendingEffects_) {
+            if (pending.first > txnDepth_) pending.first = txnDepth_;
+        }
+        return true;
+    }
+    txnDepth_ = 0;
+
+    QSqlDatabase db(db_);
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = db.commit();
+    stats_->recordLockWait(static_cast<std::uint64_t>(timer.nsecsElapsed()));
+    lastFailureBusy_ = !ok && isBusyError(db.lastError());
+    if (lastFailureBusy_) stats_->recordBusy();
+    if (ok) {
+        // Moved out first: an effect may start a transaction of its own
+        auto effects = std::move(pendingEffects_);
+        pendingEffects_.clear();
+        for (const auto& pending : effects) pending.second();
+    }
+    return ok;
+}
+
+// Busy means another connection held the write lock; the whole operation
+// can be retried as-is.
+CirculationError Database::storageError() const {
+    return lastFailureBusy_ ? CirculationError::Busy : CirculationError::StorageError;
+}
+
+void Database::rollback() const {
+    if (txnDepth_ > 1) {
+        // Undo this level only; the savepoint is then released so the
+        // enclosing transaction carries on without it.
+        const int undone = txnDepth_;
+        pendingEffects_.erase(std::remove_if(pendingEffects_.begin(), pendingEffects_.end(),
+                                             [undone](const auto& p) { return p.first >= undone; }),
+                              pendingEffects_.end());
+        --txnDepth_;
+        savepoint("ROLLBACK TO", txnDepth_);
+        savepoint("RELEASE", txnDepth_);
+        return;
+    }
+    txnDepth_ = 0;
+    pendingEffects_.clear();
+    QSqlDatabase db(db_);
+    db.rollback();
+}
+
+bool Database::savepoint(const char* verb, int depth) const {
+    QSqlQuery q(db_);
+    q.prepare(QString("%1 sp%2").arg(verb).arg(depth));
+    return exec(q);
+}
+
+void Database::afterCommit(std::function<void()> effect) const {
+    if (txnDepth_ > 0) pendingEffects_.emplace_back(txnDepth_, std::move(effect));
+    else effect();
+}
+
+void Database::publish(const ChangeEvent& event) const {
+    afterCommit([this, event]() { notifier_->publish(event); });
+}
+
+void Database::logOp(OpKind kind, const PatronId& patronId, const ItemId& itemId,
+                     const std::string& recordId, std::int64_t value) const {
+    if (!opLog_) return;
+    OpRecord r;
+    r.atMs = std::chrono::duration_cast<std::chrono::milliseconds>(clock_->now().time_since_epoch()).count();
+    r.kind = kind;
+    r.patronId = patronId;
+    r.itemId = itemId;
+    r.recordId = recordId;
+    r.value = value;
+    auto log = opLog_;
+    afterCommit([log, r]() { log->append(r); });
+}
+
+// ----- Transactions -----
+Database::Transaction::Transaction(const Database& db, TransactionMode mode) : db_(db) {
+    active_ = db_.begin(mode == TransactionMode::Immediate);
+}
+
+Database::Transaction::~Transaction() {
+    rollback();
+}
+
+bool Database::Transaction::commit() {
+    if (!active_) return false;
+    active_ = false;
+    const int depth = db_.txnDepth_;
+    if (db_.commit()) return true;
+    if (depth == 1) {
+        db_.rollback();
+    } else {
+        // RELEASE failed: undo this level and leave the outer one open
+        db_.pendingEffects_.erase(std::remove_if(db_.pendingEffects_.begin(), db_.pendingEffects_.end(),
+                                                 [depth](const auto& p) { return p.first >= depth; }),
+                                  db_.pendingEffects_.end());
+        db_.savepoint("ROLLBACK TO", depth - 1);
+        db_.savepoint("RELEASE", depth - 1);
+    }
+    return false;
+}
+
+void Database::Transaction::rollback() {
+    if (!active_) return;
+    active_ = false;
+    db_.rollback();
+}
+
+// ----- Group commit -----
+bool Database::BeginGroup() {
+    if (inGroup_ || txnDepth_ > 0) return false;
+    inGroup_ = begin(true);
+    return inGroup_;
+}
+
+bool Database::EndGroup() {
+    if (!inGroup_) return false;
+    inGroup_ = false;
+    if (!commit()) {
+        rollback();
+        return false;
+    }
+    if (opLog_) opLog_->sync();
+    return true;
+}
 
 // ----- Session / Identification -----
 std::optional<UserRecord> Database::FindUserByName(const std::string& username) const {
+    // NOCASE folds ASCII only, so fold the cache key the same way.
+    const std::string key = FoldUsername(username);
+    pollUserChanges();   // drops the cache if another connection changed users
+    if (auto hit = userCache_.get(key)) return hit;
+
+    // Comparing with COLLATE NOCASE (instead of LOWER() on the column) lets
+    // SQLite use idx_users_username_nocase rather than scanning users.
     QSqlQuery q(db_);
-    q.prepare("SELECT id, username, role FROM users WHERE LOWER(username) = LOWER(?)");
+    q.prepare("SELECT id, username, role FROM users WHERE username = ? COLLATE NOCASE");
     q.addBindValue(QString::fromStdString(username));
-    if (!q.exec() || !q.next()) {
-        qDebug() << "1";
-        return std::nullopt;
-    }
+    if (!exec(q) || !q.next()) return std::nullopt;
     UserRecord rec;
     rec.id = q.value(0).toString().toStdString();
     rec.username = q.value(1).toString().toStdString();
     rec.role = roleFromString(q.value(2).toString());
+    userCache_.put(key, rec);
     return rec;
 }
 
+std::vector<UserRecord> Database::CompleteUsernames(const std::string& prefix, std::size_t limit,
+                                                   std::optional<Role> role) const {
+    if (usernameIndexGeneration_ != UserGeneration()) {
+        std::vector<UserRecord> users;
+        QSqlQuery q(db_);
+        q.setForwardOnly(true);
+        q.prepare("SELECT id, username, role FROM users");
+        if (!exec(q)) return {};
+        while (q.next()) {
+            UserRecord rec;
+            rec.id = q.value(0).toString().toStdString();
+            rec.username = q.value(1).toString().toStdString();
+            rec.role = roleFromString(q.value(2).toString());
+            users.push_back(std::move(rec));
+        }
+        usernameIndex_.rebuild(std::move(users));
+        usernameIndexGeneration_ = userGeneration_;
+    }
+    return usernameIndex_.complete(prefix, limit, role);
+}
+
+void Database::MarkUserRecordsChanged() {
+    invalidateUserRecords();
+}
+
+void Database::invalidateUserRecords() const {
+    ++userGeneration_;
+    userCache_.clear();
+}
+
+std::uint64_t Database::UserGeneration() const {
+    pollUserChanges();
+    return userGeneration_;
+}
+
+// PRAGMA data_version only moves when another connection commits, so the
+// counter itself is read only after someone else has written something.
+void Database::pollUserChanges() const {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - userChangesPolledAt_ < kUserChangePollInterval) return;
+    userChangesPolledAt_ = now;
+
+    QSqlQuery v(db_);
+    v.prepare("PRAGMA data_version");
+    if (!exec(v) || !v.next()) return;
+    const qint64 dataVersion = v.value(0).toLongLong();
+    v.finish();
+    if (dataVersion == dataVersion_) return;
+    dataVersion_ = dataVersion;
+
+    QSqlQuery g(db_);
+    g.prepare("SELECT generation FROM userChanges");
+    if (!exec(g) || !g.next()) return;
+    const qint64 seen = g.value(0).toLongLong();
+    if (userChangesSeen_ >= 0 && seen != userChangesSeen_) invalidateUserRecords();
+    userChangesSeen_ = seen;
+}
+
 std::optional<UserRecord> Database::GetUserById(const UserId& id) const {
     QSqlQuery q(db_);
     q.prepare("SELECT id, username, role FROM users WHERE id=?");
     q.addBindValue(QString::fromStdString(id));
-    if (!q.exec() || !q.next()) return std::nullopt;
+    if (!exec(q) || !q.next()) return std::nullopt;
     UserRecord rec;
     rec.id = q.value(0).toString().toStdString();
     rec.username = q.value(1).toString().toStdString();
@@ -84,19 +466,80 @@ std::optional<UserRecord> Database::GetUserById(const UserId& id) const {
 }
 
 // ----- Catalogue -----
+static const char* const kItemDetailColumns =
+    "id, title, authorOrCreator, format, status, publicationYear, isbn, deweyDecimal, "
+    "genre, rating, issueNumber, publicationDate";
+
+static ItemDetails itemDetailsFromRow(const QSqlQuery& q) {
+    ItemDetails d;
+    d.id = q.value(0).toString().toStdString();
+    d.title = q.value(1).toString().toStdString();
+    d.authorOrCreator = q.value(2).toString().toStdString();
+    d.format = formatFromString(q.value(3).toString());
+    d.status = statusFromString(q.value(4).toString());
+    if (!q.value(5).isNull()) d.publicationYear = q.value(5).toInt();
+    if (!q.value(6).isNull()) d.isbn = q.value(6).toString().toStdString();
+    if (!q.value(7).isNull()) d.deweyDecimal = q.value(7).toString().toStdString();
+    if (!q.value(8).isNull()) d.genre = q.value(8).toString().toStdString();
+    if (!q.value(9).isNull()) d.rating = q.value(9).toString().toStdString();
+    if (!q.value(10).isNull()) d.issueNumber = q.value(10).toString().toStdString();
+    if (!q.value(11).isNull()) d.publicationDate = fromIso(q.value(11).toString());
+    return d;
+}
+
 std::vector<Item> Database::GetCatalogueItems() const {
     std::vector<Item> out;
-    QSqlQuery q("SELECT id FROM items ORDER BY title ASC", db_);
+    const std::uint64_t generation = catalogueGeneration_;
+    QSqlQuery q(db_);
+    q.setForwardOnly(true);
+    q.prepare(QString("SELECT %1 FROM items ORDER BY title ASC").arg(kItemDetailColumns));
+    exec(q);
     while (q.next()) {
-        out.emplace_back(std::shared_ptr<Database>(const_cast<Database*>(this), [](Database*){}),
-                         q.value(0).toString().toStdString());
+        ItemDetails d = itemDetailsFromRow(q);
+        out.emplace_back(this, d.id);
+        out.back().hydrate(std::move(d), generation);
     }
     return out;
 }
 
+void Database::HydrateItems(const std::vector<Item>& items) const {
+    const std::uint64_t generation = catalogueGeneration_;
+
+    std::vector<const Item*> stale;
+    for (const Item& it : items) {
+        if (it.db_ == this && !it.isHydrated()) stale.push_back(&it);
+    }
+
+    for (std::size_t first = 0; first < stale.size(); first += kInBatch) {
+        const std::size_t n = std::min(kInBatch, stale.size() - first);
+        const QString marks = placeholders(n);
+
+        QSqlQuery q(db_);
+        q.setForwardOnly(true);
+        q.prepare(QString("SELECT %1 FROM items WHERE id IN (%2)")
+                      .arg(kItemDetailColumns, marks));
+        for (std::size_t i = 0; i < n; ++i) q.addBindValue(QString::fromStdString(stale[first + i]->id()));
+        if (!exec(q)) return;
+
+        // The same id may appear in several handles
+        std::unordered_map<std::string, ItemDetails> byId;
+        while (q.next()) {
+            ItemDetails d = itemDetailsFromRow(q);
+            byId.emplace(d.id, std::move(d));
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            const Item* it = stale[first + i];
+            auto found = byId.find(it->id());
+            if (found != byId.end()) it->hydrate(found->second, generation);
+        }
+    }
+}
+
 std::vector<ItemSummary> Database::GetCatalogueSummaries() const {
     std::vector<ItemSummary> out;
-    QSqlQuery q("SELECT id, title, authorOrCreator, format, status FROM items ORDER BY title ASC", db_);
+    QSqlQuery q(db_);
+    q.prepare("SELECT id, title, authorOrCreator, format, status FROM items ORDER BY title ASC");
+    exec(q);
     while (q.next()) {
         ItemSummary s;
         s.id = q.value(0).toString().toStdString();
@@ -111,7 +554,9 @@ std::vector<ItemSummary> Database::GetCatalogueSummaries() const {
 
 std::vector<ItemSummary> Database::GetAvailableCatalogue() const {
     std::vector<ItemSummary> out;
-    QSqlQuery q("SELECT id, title, authorOrCreator, format, status FROM items WHERE status='Available' ORDER BY title ASC", db_);
+    QSqlQuery q(db_);
+    q.prepare("SELECT id, title, authorOrCreator, format, status FROM items WHERE status='Available' ORDER BY title ASC");
+    exec(q);
     while (q.next()) {
         ItemSummary s;
         s.id = q.value(0).toString().toStdString();
@@ -124,32 +569,36 @@ std::vector<ItemSummary> Database::GetAvailableCatalogue() const {
     return out;
 }
 
+std::uint32_t Database::CatalogueStamp() const {
+    QSqlQuery q(db_);
+    q.prepare("SELECT generation FROM catalogueChanges");
+    if (!exec(q) || !q.next()) return 0;
+    return static_cast<std::uint32_t>(q.value(0).toLongLong());
+}
+
+void Database::AttachCatalogueSnapshot(std::shared_ptr<const CatalogueSnapshot> snapshot) {
+    snapshot_ = std::move(snapshot);
+    snapshotGeneration_ = catalogueGeneration_;
+}
+
+std::optional<std::vector<ItemSummary>> Database::GetSnapshotCatalogue(bool availableOnly) const {
+    if (!snapshot_ || snapshotGeneration_ != catalogueGeneration_) return std::nullopt;
+    return snapshot_->summaries(availableOnly);
+}
+
 std::optional<ItemDetails> Database::GetItemDetails(const ItemId& itemId) const {
     QSqlQuery q(db_);
-    q.prepare("SELECT id, title, authorOrCreator, format, status, publicationYear, isbn, deweyDecimal, genre, rating, issueNumber, publicationDate FROM items WHERE id=?");
+    q.prepare(QString("SELECT %1 FROM items WHERE id=?").arg(kItemDetailColumns));
     q.addBindValue(QString::fromStdString(itemId));
-    if (!q.exec() || !q.next()) return std::nullopt;
-    ItemDetails d;
-    d.id = q.value(0).toString().toStdString();
-    d.title = q.value(1).toString().toStdString();
-    d.authorOrCreator = q.value(2).toString().toStdString();
-    d.format = formatFromString(q.value(3).toString());
-    d.status = statusFromString(q.value(4).toString());
-    if (!q.value(5).isNull()) d.publicationYear = q.value(5).toInt();
-    if (!q.value(6).isNull()) d.isbn = q.value(6).toString().toStdString();
-    if (!q.value(7).isNull()) d.deweyDecimal = q.value(7).toString().toStdString();
-    if (!q.value(8).isNull()) d.genre = q.value(8).toString().toStdString();
-    if (!q.value(9).isNull()) d.rating = q.value(9).toString().toStdString();
-    if (!q.value(10).isNull()) d.issueNumber = q.value(10).toString().toStdString();
-    if (!q.value(11).isNull()) d.publicationDate = fromIso(q.value(11).toString());
-    return d;
+    if (!exec(q) || !q.next()) return std::nullopt;
+    return itemDetailsFromRow(q);
 }
 
 std::optional<ItemSummary> Database::GetItemSummary(const ItemId& itemId) const {
     QSqlQuery q(db_);
     q.prepare("SELECT id, title, authorOrCreator, format, status FROM items WHERE id=?");
     q.addBindValue(QString::fromStdString(itemId));
-    if (!q.exec() || !q.next()) return std::nullopt;
+    if (!exec(q) || !q.next()) return std::nullopt;
     ItemSummary s;
     s.id = q.value(0).toString().toStdString();
     s.title = q.value(1).toString().toStdString();
@@ -164,81 +613,308 @@ std::size_t Database::GetActiveLoanCount(const PatronId& patronId) const {
     QSqlQuery q(db_);
     q.prepare("SELECT COUNT(*) FROM loans WHERE patronId=?");
     q.addBindValue(QString::fromStdString(patronId));
-    if (!q.exec() || !q.next()) return 0;
+    if (!exec(q) || !q.next()) return 0;
     return q.value(0).toInt();
 }
 
+// Fine accrued by loan l (joined to its item i and fineRates r) as of the
+// bound time: whole days past due times the format's daily rate, capped
+// per loan. Computed when read, so nothing has to tick every loan daily.
+static const char* const kAccruedFine =
+    "MIN(r.maxCentsPerLoan, r.centsPerDay * MAX(0, CAST(julianday(?) - julianday(l.dueDate) AS INTEGER)))";
+
+std::int64_t Database::GetFinesOwed(const PatronId& patronId) const {
+    QSqlQuery q(db_);
+    q.prepare(QString(R"(
+        SELECT IFNULL((SELECT fineBalanceCents FROM users WHERE id = ?), 0)
+                 + (SELECT IFNULL(SUM(cents), 0) FROM pendingFines WHERE patronId = ?)
+                 + (SELECT IFNULL(SUM(%1), 0) FROM loans l
+                      JOIN items i ON i.id = l.itemId
+                      JOIN fineRates r ON r.format = i.format
+                     WHERE l.patronId = ? AND l.dueDate < ?)
+    )").arg(kAccruedFine));
+    const QString nowIso = toIso(clock_->now());
+    q.addBindValue(QString::fromStdString(patronId));
+    q.addBindValue(QString::fromStdString(patronId));
+    q.addBindValue(nowIso);
+    q.addBindValue(QString::fromStdString(patronId));
+    q.addBindValue(nowIso);
+    if (!exec(q) || !q.next()) return 0;
+    return q.value(0).toLongLong();
+}
+
 bool Database::IsItemAvailable(const ItemId& itemId) const {
     QSqlQuery q(db_);
     q.prepare("SELECT status FROM items WHERE id=?");
     q.addBindValue(QString::fromStdString(itemId));
-    if (!q.exec() || !q.next()) return false;
+    if (!exec(q) || !q.next()) return false;
     return q.value(0).toString() == "Available";
 }
 
+// Loan/hold ids: millisecond timestamp plus a random suffix, so two
+// circulation actions in the same second (or from two desks) don't collide.
+static QString newRowId(const char* prefix) {
+    return QString("%1%2-%3")
+        .arg(prefix)
+        .arg(QDateTime::currentMSecsSinceEpoch())
+        .arg(QRandomGenerator::global()->bounded(0x10000), 4, 16, QLatin1Char('0'));
+}
+
 // ----- Borrow Item -----
-ValueResult<LoanSnapshot> Database::CheckoutItem(const PatronId& patronId, const ItemId& itemId) {
+ValueResult<LoanSnapshot> Database::CheckoutItem(const PatronId& patronId, const ItemId& itemId,
+                                                 std::size_t loansElsewhere, std::int64_t finesElsewhere) {
     ValueResult<LoanSnapshot> res;
-
-    if (GetActiveLoanCount(patronId) >= MaxActiveLoansPerPatron()) {
-        res.ok = false; res.message = "Loan limit reached"; return res;
-    }
-    if (!IsItemAvailable(itemId)) {
-        res.ok = false; res.message = "Item not available"; return res;
-    }
-
-    db_.transaction();
-    auto now = std::chrono::system_clock::now();
-    auto due = now + std::chrono::hours(24 * LoanPeriodDays());
-    QString loanId = QString("L%1").arg(QDateTime::currentSecsSinceEpoch());
+    auto fail = [&](CirculationError error, const char* message) {
+        res.ok = false; res.error = error; res.message = message;
+        return res;
+    };
+
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) return fail(storageError(), "Could not start transaction");
+
+    const auto now = clock_->now();
+    const QString nowIso = toIso(now);
+
+    // All preconditions in one round trip, fines owed included: the settled
+    // balance plus what the patron's overdue loans have accrued.
+    QSqlQuery pre(db_);
+    pre.prepare(QString(R"(
+        SELECT (SELECT status FROM items WHERE id = ?),
+               (SELECT COUNT(*) FROM loans WHERE patronId = ?) + ?,
+               IFNULL((SELECT maxActiveLoansPerPatron FROM policy), 3),
+               IFNULL((SELECT loanPeriodDays FROM policy), 14),
+               IFNULL((SELECT fineBalanceCents FROM users WHERE id = ?), 0) + ?
+                 + (SELECT IFNULL(SUM(cents), 0) FROM pendingFines WHERE patronId = ?)
+                 + (SELECT IFNULL(SUM(%1), 0) FROM loans l
+                      JOIN items i ON i.id = l.itemId
+                      JOIN fineRates r ON r.format = i.format
+                     WHERE l.patronId = ? AND l.dueDate < ?),
+               (SELECT fineThresholdCents FROM policy)
+    )").arg(kAccruedFine));
+    const QString patron = QString::fromStdString(patronId);
+    pre.addBindValue(QString::fromStdString(itemId));
+    pre.addBindValue(patron);
+    pre.addBindValue(static_cast<qulonglong>(loansElsewhere));
+    pre.addBindValue(patron);
+    pre.addBindValue(static_cast<qlonglong>(finesElsewhere));
+    pre.addBindValue(patron);
+    pre.addBindValue(nowIso);
+    pre.addBindValue(patron);
+    pre.addBindValue(nowIso);
+    if (!exec(pre) || !pre.next()) return fail(storageError(), "Checkout check failed");
+
+    const QVariant status = pre.value(0);
+    const auto activeLoans = static_cast<std::size_t>(pre.value(1).toInt());
+    const auto maxLoans = static_cast<std::size_t>(pre.value(2).toInt());
+    const int loanDays = pre.value(3).toInt();
+    const qint64 finesOwed = pre.value(4).toLongLong();
+    const QVariant fineLimit = pre.value(5);
+    pre.finish();
+
+    if (activeLoans >= maxLoans) return fail(CirculationError::LoanLimitReached, "Loan limit reached");
+    if (!fineLimit.isNull() && finesOwed > fineLimit.toLongLong())
+        return fail(CirculationError::FinesOwed, "Outstanding fines are over the limit");
+    if (status.isNull()) return fail(CirculationError::ItemNotFound, "Item not found");
+    if (statusFromString(status.toString()) != ItemStatus::Available)
+        return fail(CirculationError::ItemNotAvailable, "Item is not available");
+
+    auto due = now + std::chrono::hours(24 * loanDays);
+    QString loanId = newRowId("L");
 
     QSqlQuery ins(db_);
     ins.prepare("INSERT INTO loans (id, patronId, itemId, checkoutDate, dueDate) VALUES (?, ?, ?, ?, ?)");
     ins.addBindValue(loanId);
     ins.addBindValue(QString::fromStdString(patronId));
     ins.addBindValue(QString::fromStdString(itemId));
-    ins.addBindValue(toIso(now));
+    ins.addBindValue(nowIso);
     ins.addBindValue(toIso(due));
-    if (!ins.exec()) { db_.rollback(); res.ok=false; res.message="Insert failed"; return res; }
+    if (!exec(ins)) return fail(storageError(), "Insert failed");
 
     QSqlQuery upd(db_);
     upd.prepare("UPDATE items SET status='CheckedOut' WHERE id=?");
     upd.addBindValue(QString::fromStdString(itemId));
-    if (!upd.exec()) { db_.rollback(); res.ok=false; res.message="Update failed"; return res; }
-
-    db_.commit();
+    if (!exec(upd)) return fail(storageError(), "Update failed");
+
+    if (!txn.commit()) return fail(storageError(), "Commit failed");
+    MarkCatalogueChanged();
+    logOp(OpKind::Checkout, patronId, itemId, loanId.toStdString(),
+          std::chrono::duration_cast<std::chrono::milliseconds>(due.time_since_epoch()).count());
+    publish({ ChangeKind::LoanCreated, itemId, patronId });
+    publish({ ChangeKind::ItemStatusChanged, itemId, {}, ItemStatus::CheckedOut });
     res.ok = true;
     res.value = LoanSnapshot{ loanId.toStdString(), patronId, itemId, now, due };
     return res;
 }
 
 // ----- Return Item -----
-OperationResult Database::ReturnItem(const PatronId& patronId, const ItemId& itemId) {
+OperationResult Database::ReturnItem(const PatronId& patronId, const ItemId& itemId, std::int64_t* fineCentsOut) {
     OperationResult r;
-    db_.transaction();
+    auto fail = [&](CirculationError error, const char* message) {
+        r.ok = false; r.error = error; r.message = message;
+        return r;
+    };
+
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) return fail(storageError(), "Could not start transaction");
+
+    // Settle the fine an overdue loan has accrued; on-time returns write nothing.
+    QSqlQuery fine(db_);
+    fine.prepare(QString(R"(
+        SELECT %1 FROM loans l
+          JOIN items i ON i.id = l.itemId
+          JOIN fineRates r ON r.format = i.format
+         WHERE l.patronId = ? AND l.itemId = ? AND l.dueDate < ?
+    )").arg(kAccruedFine));
+    const QString nowIso = toIso(clock_->now());
+    fine.addBindValue(nowIso);
+    fine.addBindValue(QString::fromStdString(patronId));
+    fine.addBindValue(QString::fromStdString(itemId));
+    fine.addBindValue(nowIso);
+    if (!exec(fine)) return fail(storageError(), "Fine check failed");
+    const qint64 fineCents = fine.next() ? fine.value(0).toLongLong() : 0;
+    fine.finish();
+    if (fineCents > 0) {
+        QSqlQuery charge(db_);
+        charge.prepare("UPDATE users SET fineBalanceCents = fineBalanceCents + ? WHERE id = ?");
+        charge.addBindValue(fineCents);
+        charge.addBindValue(QString::fromStdString(patronId));
+        if (!exec(charge)) return fail(storageError(), "Fine update failed");
+        if (charge.numRowsAffected() <= 0) {
+            // No record of the patron here (a branch shard): keep the fine
+            // with the return until the home database takes it.
+            QSqlQuery pending(db_);
+            pending.prepare("INSERT INTO pendingFines (patronId, cents) VALUES (?, ?)");
+            pending.addBindValue(QString::fromStdString(patronId));
+            pending.addBindValue(fineCents);
+            if (!exec(pending)) return fail(storageError(), "Fine update failed");
+        }
+    }
 
+    // The DELETE doubles as the ownership check.
     QSqlQuery del(db_);
     del.prepare("DELETE FROM loans WHERE patronId=? AND itemId=?");
     del.addBindValue(QString::fromStdString(patronId));
     del.addBindValue(QString::fromStdString(itemId));
-    if (!del.exec()) { db_.rollback(); r.ok=false; r.message="Delete failed"; return r; }
+    if (!exec(del)) return fail(storageError(), "Delete failed");
+    if (del.numRowsAffected() <= 0)
+        return fail(CirculationError::LoanNotFound, "No active loan for this item by this patron");
 
     QSqlQuery upd(db_);
     upd.prepare("UPDATE items SET status='Available' WHERE id=?");
     upd.addBindValue(QString::fromStdString(itemId));
-    if (!upd.exec()) { db_.rollback(); r.ok=false; r.message="Update failed"; return r; }
+    if (!exec(upd)) return fail(storageError(), "Update failed");
+
+    if (!txn.commit()) return fail(storageError(), "Commit failed");
+    MarkCatalogueChanged();
+    logOp(OpKind::Return, patronId, itemId, std::string(), fineCents);
+    publish({ ChangeKind::LoanClosed, itemId, patronId });
+    publish({ ChangeKind::ItemStatusChanged, itemId, {}, ItemStatus::Available });
+    if (fineCentsOut) *fineCentsOut = fineCents;
+    r.ok = true;
+    return r;
+}
 
-    db_.commit();
+// ----- Fines -----
+OperationResult Database::ChargeFine(const PatronId& patronId, std::int64_t cents, const std::string& reference) {
+    OperationResult r;
+    auto fail = [&](CirculationError error, const char* message) {
+        r.ok = false; r.error = error; r.message = message;
+        return r;
+    };
+    if (cents <= 0) return fail(CirculationError::BadRequest, "Amount must be positive");
+
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) return fail(storageError(), "Could not start transaction");
+
+    if (!reference.empty()) {
+        QSqlQuery seen(db_);
+        seen.prepare("INSERT OR IGNORE INTO chargedFines (reference) VALUES (?)");
+        seen.addBindValue(QString::fromStdString(reference));
+        if (!exec(seen)) return fail(storageError(), "Fine update failed");
+        if (seen.numRowsAffected() <= 0) {
+            r.ok = true; r.message = "Already charged";
+            return r;
+        }
+    }
+
+    QSqlQuery q(db_);
+    q.prepare("UPDATE users SET fineBalanceCents = fineBalanceCents + ? WHERE id = ?");
+    q.addBindValue(static_cast<qlonglong>(cents));
+    q.addBindValue(QString::fromStdString(patronId));
+    if (!exec(q)) return fail(storageError(), "Fine update failed");
+    if (q.numRowsAffected() <= 0) return fail(CirculationError::UserNotFound, "User not found");
+    if (!txn.commit()) return fail(storageError(), "Commit failed");
+
+    logOp(OpKind::FineCharged, patronId, {}, reference, cents);
     r.ok = true;
     return r;
 }
 
+std::vector<PendingFine> Database::GetPendingFines() const {
+    std::vector<PendingFine> out;
+    QSqlQuery q(db_);
+    q.prepare("SELECT id, patronId, cents FROM pendingFines ORDER BY id");
+    if (!exec(q)) return out;
+    while (q.next()) {
+        out.push_back({ q.value(0).toLongLong(), q.value(1).toString().toStdString(), q.value(2).toLongLong() });
+    }
+    return out;
+}
+
+bool Database::ClearPendingFine(std::int64_t id) {
+    QSqlQuery q(db_);
+    q.prepare("DELETE FROM pendingFines WHERE id = ?");
+    q.addBindValue(static_cast<qlonglong>(id));
+    return exec(q);
+}
+
+ValueResult<std::int64_t> Database::SettleFine(const PatronId& patronId, std::int64_t cents, FineSettlement how) {
+    ValueResult<std::int64_t> res;
+    auto fail = [&](CirculationError error, const char* message) {
+        res.ok = false; res.error = error; res.message = message;
+        return res;
+    };
+    if (cents <= 0) return fail(CirculationError::BadRequest, "Amount must be positive");
+
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) return fail(storageError(), "Could not start transaction");
+
+    QSqlQuery bal(db_);
+    bal.prepare("SELECT fineBalanceCents FROM users WHERE id = ?");
+    bal.addBindValue(QString::fromStdString(patronId));
+    if (!exec(bal)) return fail(storageError(), "Balance check failed");
+    if (!bal.next()) return fail(CirculationError::UserNotFound, "User not found");
+    const qint64 balance = bal.value(0).toLongLong();
+    bal.finish();
+
+    // Never below zero: an overpayment settles the balance and no more
+    const qint64 settled = std::min<qint64>(cents, balance);
+    if (settled > 0) {
+        QSqlQuery upd(db_);
+        upd.prepare("UPDATE users SET fineBalanceCents = fineBalanceCents - ? WHERE id = ?");
+        upd.addBindValue(settled);
+        upd.addBindValue(QString::fromStdString(patronId));
+        if (!exec(upd)) return fail(storageError(), "Update failed");
+    }
+    if (!txn.commit()) return fail(storageError(), "Commit failed");
+
+    if (settled > 0) {
+        logOp(how == FineSettlement::Waiver ? OpKind::FineWaived : OpKind::FinePaid, patronId, {}, std::string(), settled);
+    } else {
+        res.message = "Nothing owed";
+    }
+    res.ok = true;
+    res.value = balance - settled;
+    return res;
+}
+
 // NEW: generate next ID like "I021" based on existing item IDs in the DB
-static ItemId generateNewItemId(const QSqlDatabase& db) {
-    QSqlQuery q(db);
+ItemId Database::generateNewItemId() const {
+    QSqlQuery q(db_);
 
     // Find the maximum numeric part of IDs that look like 'I###'
-    if (!q.exec("SELECT MAX(CAST(SUBSTR(id, 2) AS INTEGER)) FROM items WHERE id LIKE 'I%'")) {
+    q.prepare("SELECT MAX(CAST(SUBSTR(id, 2) AS INTEGER)) FROM items WHERE id LIKE 'I%'");
+    if (!exec(q)) {
         qDebug() << "generateNewItemId: query failed:" << q.lastError().text();
         // Fallback: start at I001
         return "I001";
@@ -263,9 +939,19 @@ ValueResult<ItemId> Database::AddItem(const ItemDetails& detailsWithoutId) {
         return res;
     }
 
+    // The id is read and used in one transaction, so two writers cannot
+    // both take the same next number.
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) {
+        res.ok = false;
+        res.error = storageError();
+        res.message = "Could not start transaction";
+        return res;
+    }
+
     // 1) Generate new ID
     ItemDetails d = detailsWithoutId;
-    d.id = generateNewItemId(db_);
+    d.id = generateNewItemId();
 
     // 2) Normalize status: default to Available unless explicitly Available/CheckedOut
     if (d.status != ItemStatus::Available && d.status != ItemStatus::CheckedOut) {
@@ -323,13 +1009,23 @@ ValueResult<ItemId> Database::AddItem(const ItemDetails& detailsWithoutId) {
     else
         q.addBindValue(QVariant(QVariant::String));
 
-    if (!q.exec()) {
+    if (!exec(q)) {
         qDebug() << "AddItem INSERT failed:" << q.lastError().text();
         res.ok = false;
+        res.error = storageError();
         res.message = "Insert failed";
         return res;
     }
+    if (!txn.commit()) {
+        res.ok = false;
+        res.error = storageError();
+        res.message = "Commit failed";
+        return res;
+    }
 
+    MarkCatalogueChanged();
+    logOp(OpKind::ItemAdded, {}, d.id);
+    publish({ ChangeKind::ItemAdded, d.id, {} });
     res.ok = true;
     res.value = d.id;
     res.message.clear();
@@ -345,13 +1041,23 @@ OperationResult Database::RemoveItem(const ItemId& itemId) {
         return r;
     }
 
+    // The checks and the delete see the same state: nothing can lend the
+    // item or place a hold between them.
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) {
+        r.ok = false;
+        r.error = storageError();
+        r.message = "Could not start transaction";
+        return r;
+    }
+
     QString qItemId = QString::fromStdString(itemId);
 
     // 1) Check item exists and status
     QSqlQuery qItem(db_);
     qItem.prepare("SELECT status FROM items WHERE id=?");
     qItem.addBindValue(qItemId);
-    if (!qItem.exec() || !qItem.next()) {
+    if (!exec(qItem) || !qItem.next()) {
         r.ok = false;
         r.message = "Item not found";
         return r;
@@ -368,7 +1074,7 @@ OperationResult Database::RemoveItem(const ItemId& itemId) {
     QSqlQuery qHolds(db_);
     qHolds.prepare("SELECT COUNT(*) FROM holds WHERE itemId=?");
     qHolds.addBindValue(qItemId);
-    if (!qHolds.exec() || !qHolds.next()) {
+    if (!exec(qHolds) || !qHolds.next()) {
         r.ok = false;
         r.message = "Hold check failed";
         return r;
@@ -383,7 +1089,7 @@ OperationResult Database::RemoveItem(const ItemId& itemId) {
     QSqlQuery qLoans(db_);
     qLoans.prepare("SELECT COUNT(*) FROM loans WHERE itemId=?");
     qLoans.addBindValue(qItemId);
-    if (!qLoans.exec() || !qLoans.next()) {
+    if (!exec(qLoans) || !qLoans.next()) {
         r.ok = false;
         r.message = "Loan check failed";
         return r;
@@ -395,20 +1101,27 @@ OperationResult Database::RemoveItem(const ItemId& itemId) {
     }
 
     // 3) Safe to delete the item
-    db_.transaction();
     QSqlQuery del(db_);
     del.prepare("DELETE FROM items WHERE id=?");
     del.addBindValue(qItemId);
 
-    if (!del.exec()) {
+    if (!exec(del)) {
         qDebug() << "RemoveItem DELETE failed:" << del.lastError().text();
-        db_.rollback();
         r.ok = false;
+        r.error = storageError();
         r.message = "Delete failed";
         return r;
     }
 
-    db_.commit();
+    if (!txn.commit()) {
+        r.ok = false;
+        r.error = storageError();
+        r.message = "Commit failed";
+        return r;
+    }
+    MarkCatalogueChanged();
+    logOp(OpKind::ItemRemoved, {}, itemId);
+    publish({ ChangeKind::ItemRemoved, itemId, {} });
     r.ok = true;
     r.message.clear();
     return r;
@@ -418,32 +1131,55 @@ OperationResult Database::RemoveItem(const ItemId& itemId) {
 // ----- Holds -----
 ValueResult<std::size_t> Database::PlaceHold(const PatronId& patronId, const ItemId& itemId) {
     ValueResult<std::size_t> res;
-    if (IsItemAvailable(itemId)) {
-        res.ok=false; res.message="Cannot place hold on available item"; return res;
-    }
+    auto fail = [&](CirculationError error, const char* message) {
+        res.ok = false; res.error = error; res.message = message;
+        return res;
+    };
 
-    QSqlQuery dup(db_);
-    dup.prepare("SELECT COUNT(*) FROM holds WHERE patronId=? AND itemId=?");
-    dup.addBindValue(QString::fromStdString(patronId));
-    dup.addBindValue(QString::fromStdString(itemId));
-    if (!dup.exec() || !dup.next()) { res.ok=false; res.message="Hold check failed"; return res; }
-    if (dup.value(0).toInt() > 0) { res.ok=false; res.message="Hold already exists"; return res; }
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) return fail(storageError(), "Could not start transaction");
 
-    QSqlQuery posq(db_);
-    posq.prepare("SELECT IFNULL(MAX(queuePosition),0)+1 FROM holds WHERE itemId=?");
-    posq.addBindValue(QString::fromStdString(itemId));
-    if (!posq.exec() || !posq.next()) { res.ok=false; res.message="Queue calc failed"; return res; }
-    int pos = posq.value(0).toInt();
+    // Item status, any existing hold by this patron and the next queue slot.
+    QSqlQuery pre(db_);
+    pre.prepare(R"(
+        SELECT (SELECT status FROM items WHERE id = ?),
+               (SELECT queuePosition FROM holds WHERE patronId = ? AND itemId = ?),
+               (SELECT IFNULL(MAX(queuePosition), 0) + 1 FROM holds WHERE itemId = ?)
+    )");
+    pre.addBindValue(QString::fromStdString(itemId));
+    pre.addBindValue(QString::fromStdString(patronId));
+    pre.addBindValue(QString::fromStdString(itemId));
+    pre.addBindValue(QString::fromStdString(itemId));
+    if (!exec(pre) || !pre.next()) return fail(storageError(), "Hold check failed");
+
+    const QVariant status = pre.value(0);
+    const QVariant existing = pre.value(1);
+    const int pos = pre.value(2).toInt();
+    pre.finish();
+
+    if (status.isNull()) return fail(CirculationError::ItemNotFound, "Item not found");
+    if (statusFromString(status.toString()) == ItemStatus::Available)
+        return fail(CirculationError::ItemAvailable, "Cannot place a hold on an available item");
+    if (!existing.isNull()) {
+        // A repeat request changes nothing: report the position already held.
+        res.ok = true;
+        res.value = static_cast<std::size_t>(existing.toInt());
+        res.message = "Hold already exists";
+        return res;
+    }
 
-    QString holdId = QString("H%1").arg(QDateTime::currentSecsSinceEpoch());
+    QString holdId = newRowId("H");
     QSqlQuery ins(db_);
     ins.prepare("INSERT INTO holds (id, patronId, itemId, queuePosition) VALUES (?, ?, ?, ?)");
     ins.addBindValue(holdId);
     ins.addBindValue(QString::fromStdString(patronId));
     ins.addBindValue(QString::fromStdString(itemId));
     ins.addBindValue(pos);
-    if (!ins.exec()) { res.ok=false; res.message="Insert hold failed"; return res; }
+    if (!exec(ins)) return fail(storageError(), "Insert hold failed");
 
+    if (!txn.commit()) return fail(storageError(), "Commit failed");
+    logOp(OpKind::PlaceHold, patronId, itemId, holdId.toStdString(), pos);
+    publish({ ChangeKind::HoldQueueChanged, itemId, patronId });
     res.ok = true;
     res.value = static_cast<std::size_t>(pos);
     return res;
@@ -451,62 +1187,77 @@ ValueResult<std::size_t> Database::PlaceHold(const PatronId& patronId, const Ite
 
 OperationResult Database::CancelHold(const PatronId& patronId, const ItemId& itemId) {
     OperationResult r;
-    db_.transaction();
+    auto fail = [&](CirculationError error, const char* message) {
+        r.ok = false; r.error = error; r.message = message;
+        return r;
+    };
+
+    Transaction txn(*this, TransactionMode::Immediate);
+    if (!txn.active()) return fail(storageError(), "Could not start transaction");
 
     QSqlQuery sel(db_);
-    sel.prepare("SELECT id FROM holds WHERE patronId=? AND itemId=?");
+    sel.prepare("SELECT id, queuePosition FROM holds WHERE patronId=? AND itemId=?");
     sel.addBindValue(QString::fromStdString(patronId));
     sel.addBindValue(QString::fromStdString(itemId));
-    if (!sel.exec() || !sel.next()) { db_.rollback(); r.ok=false; r.message="Hold not found"; return r; }
-    QString holdId = sel.value(0).toString();
+    if (!exec(sel)) return fail(storageError(), "Hold lookup failed");
+    if (!sel.next()) return fail(CirculationError::HoldNotFound, "No hold for this item by this patron");
+    const QString holdId = sel.value(0).toString();
+    const int position = sel.value(1).toInt();
+    sel.finish();
 
     QSqlQuery del(db_);
     del.prepare("DELETE FROM holds WHERE id=?");
     del.addBindValue(holdId);
-    if (!del.exec()) { db_.rollback(); r.ok=false; r.message="Delete failed"; return r; }
-
-    // Re-number queue
-    QSqlQuery q(db_);
-    q.prepare("SELECT id FROM holds WHERE itemId=? ORDER BY queuePosition ASC");
-    q.addBindValue(QString::fromStdString(itemId));
-    if (!q.exec()) { db_.rollback(); r.ok=false; r.message="Queue select failed"; return r; }
-    int pos=1;
-    while (q.next()) {
-        QSqlQuery upd(db_);
-        upd.prepare("UPDATE holds SET queuePosition=? WHERE id=?");
-        upd.addBindValue(pos++);
-        upd.addBindValue(q.value(0));
-        if (!upd.exec()) { db_.rollback(); r.ok=false; r.message="Queue update failed"; return r; }
-    }
-
-    db_.commit();
+    if (!exec(del)) return fail(storageError(), "Delete failed");
+
+    // Close the gap in one statement instead of rewriting every row
+    QSqlQuery shift(db_);
+    shift.prepare("UPDATE holds SET queuePosition = queuePosition - 1 WHERE itemId=? AND queuePosition > ?");
+    shift.addBindValue(QString::fromStdString(itemId));
+    shift.addBindValue(position);
+    if (!exec(shift)) return fail(storageError(), "Queue update failed");
+
+    if (!txn.commit()) return fail(storageError(), "Commit failed");
+    logOp(OpKind::CancelHold, patronId, itemId, holdId.toStdString(), position);
+    publish({ ChangeKind::HoldQueueChanged, itemId, patronId });
     r.ok = true;
     return r;
 }
 
 // ----- Policy -----
 std::size_t Database::MaxActiveLoansPerPatron() const {
-    QSqlQuery q("SELECT maxActiveLoansPerPatron FROM policy", db_);
-    if (q.next()) return q.value(0).toInt();
+    QSqlQuery q(db_);
+    q.prepare("SELECT maxActiveLoansPerPatron FROM policy");
+    if (exec(q) && q.next()) return q.value(0).toInt();
     return 3;
 }
 
 int Database::LoanPeriodDays() const {
-    QSqlQuery q("SELECT loanPeriodDays FROM policy", db_);
-    if (q.next()) return q.value(0).toInt();
+    QSqlQuery q(db_);
+    q.prepare("SELECT loanPeriodDays FROM policy");
+    if (exec(q) && q.next()) return q.value(0).toInt();
     return 14; // default
 }
 
+std::optional<std::int64_t> Database::FineThresholdCents() const {
+    QSqlQuery q(db_);
+    q.prepare("SELECT fineThresholdCents FROM policy");
+    if (exec(q) && q.next() && !q.value(0).isNull()) return q.value(0).toLongLong();
+    return std::nullopt;
+}
+
 // ----- Account Status -----
 AccountStatusView Database::GetPatronAccountStatus(const PatronId& patronId) const {
     AccountStatusView view;
-    auto now = std::chrono::system_clock::now();
+    auto now = clock_->now();
 
-    // Loans
+    // Loans, with the fine each has accrued so far
     QSqlQuery q1(db_);
-    q1.prepare("SELECT i.title, l.dueDate FROM loans l JOIN items i ON l.itemId=i.id WHERE l.patronId=?");
+    q1.prepare(QString("SELECT i.title, l.dueDate, IFNULL(%1, 0) FROM loans l JOIN items i ON l.itemId=i.id "
+                       "LEFT JOIN fineRates r ON r.format=i.format WHERE l.patronId=?").arg(kAccruedFine));
+    q1.addBindValue(toIso(now));
     q1.addBindValue(QString::fromStdString(patronId));
-    if (q1.exec()) {
+    if (exec(q1)) {
         while (q1.next()) {
             LoanStatusView lv;
             lv.itemTitle = q1.value(0).toString().toStdString();
@@ -515,6 +1266,8 @@ AccountStatusView Database::GetPatronAccountStatus(const PatronId& patronId) con
             lv.daysRemaining = static_cast<int>(
                 std::chrono::duration_cast<std::chrono::hours>(due - now).count() / 24
             );
+            lv.fineCents = q1.value(2).toLongLong();
+            view.fineBalanceCents += lv.fineCents;
             view.loans.push_back(lv);
         }
     }
@@ -523,7 +1276,7 @@ AccountStatusView Database::GetPatronAccountStatus(const PatronId& patronId) con
     QSqlQuery q2(db_);
     q2.prepare("SELECT i.title, h.queuePosition FROM holds h JOIN items i ON h.itemId=i.id WHERE h.patronId=? ORDER BY h.queuePosition ASC");
     q2.addBindValue(QString::fromStdString(patronId));
-    if (q2.exec()) {
+    if (exec(q2)) {
         while (q2.next()) {
             HoldStatusView hv;
             hv.itemTitle = q2.value(0).toString().toStdString();
@@ -532,16 +1285,73 @@ AccountStatusView Database::GetPatronAccountStatus(const PatronId& patronId) con
         }
     }
 
+    // Fines settled at return, and the checkout limit
+    QSqlQuery q3(db_);
+    q3.prepare("SELECT (SELECT fineBalanceCents FROM users WHERE id=?), (SELECT fineThresholdCents FROM policy)");
+    q3.addBindValue(QString::fromStdString(patronId));
+    if (exec(q3) && q3.next()) {
+        view.fineBalanceCents += q3.value(0).toLongLong();
+        if (!q3.value(1).isNull()) view.fineLimitCents = q3.value(1).toLongLong();
+    }
+
     return view;
 }
 
+PatronDashboard Database::GetPatronDashboard(const PatronId& patronId) const {
+    PatronDashboard dash;
+
+    // One read transaction so loans and holds come from the same snapshot.
+    Transaction txn(*this);
+
+    QSqlQuery q(db_);
+    q.prepare(R"(
+        SELECT 'L', l.id, l.itemId, i.title, l.checkoutDate, l.dueDate, 0
+          FROM loans l JOIN items i ON l.itemId = i.id
+         WHERE l.patronId = ?
+        UNION ALL
+        SELECT 'H', h.id, h.itemId, i.title, NULL, NULL, h.queuePosition
+          FROM holds h JOIN items i ON h.itemId = i.id
+         WHERE h.patronId = ?
+        ORDER BY 1 DESC, 7 ASC
+    )");
+    const QString pid = QString::fromStdString(patronId);
+    q.addBindValue(pid);
+    q.addBindValue(pid);
+    if (exec(q)) {
+        while (q.next()) {
+            if (q.value(0).toString() == "L") {
+                DashboardLoan dl;
+                dl.loan.id = q.value(1).toString().toStdString();
+                dl.loan.patronId = patronId;
+                dl.loan.itemId = q.value(2).toString().toStdString();
+                dl.loan.checkoutDate = fromIso(q.value(4).toString());
+                dl.loan.dueDate = fromIso(q.value(5).toString());
+                dl.itemTitle = q.value(3).toString().toStdString();
+                dash.loans.push_back(std::move(dl));
+            } else {
+                DashboardHold dh;
+                dh.hold.id = q.value(1).toString().toStdString();
+                dh.hold.patronId = patronId;
+                dh.hold.itemId = q.value(2).toString().toStdString();
+                dh.hold.queuePosition = static_cast<std::size_t>(q.value(6).toInt());
+                dh.itemTitle = q.value(3).toString().toStdString();
+                dash.holds.push_back(std::move(dh));
+            }
+        }
+    }
+
+    q.finish();
+    txn.commit();
+    return dash;
+}
+
 // ----- Fine-grained APIs -----
 std::vector<LoanSnapshot> Database::GetPatronActiveLoans(const PatronId& patronId) const {
     std::vector<LoanSnapshot> out;
     QSqlQuery q(db_);
     q.prepare("SELECT id, itemId, checkoutDate, dueDate FROM loans WHERE patronId=?");
     q.addBindValue(QString::fromStdString(patronId));
-    if (q.exec()) {
+    if (exec(q)) {
         while (q.next()) {
             LoanSnapshot snap;
             snap.id = q.value(0).toString().toStdString();
@@ -555,12 +1365,39 @@ std::vector<LoanSnapshot> Database::GetPatronActiveLoans(const PatronId& patronI
     return out;
 }
 
+std::vector<LoanSnapshotWithItem> Database::GetPatronLoansWithItems(const PatronId& patronId) const {
+    std::vector<LoanSnapshotWithItem> out;
+    QSqlQuery q(db_);
+    q.setForwardOnly(true);
+    q.prepare(R"(
+        SELECT l.id, l.itemId, l.checkoutDate, l.dueDate, i.title, i.format
+          FROM loans l JOIN items i ON l.itemId = i.id
+         WHERE l.patronId = ?
+         ORDER BY l.dueDate ASC, i.title ASC
+    )");
+    q.addBindValue(QString::fromStdString(patronId));
+    if (exec(q)) {
+        while (q.next()) {
+            LoanSnapshotWithItem row;
+            row.id = q.value(0).toString().toStdString();
+            row.patronId = patronId;
+            row.itemId = q.value(1).toString().toStdString();
+            row.checkoutDate = fromIso(q.value(2).toString());
+            row.dueDate = fromIso(q.value(3).toString());
+            row.itemTitle = q.value(4).toString().toStdString();
+            row.itemFormat = formatFromString(q.value(5).toString());
+            out.push_back(std::move(row));
+        }
+    }
+    return out;
+}
+
 std::vector<HoldSnapshot> Database::GetPatronActiveHolds(const PatronId& patronId) const {
     std::vector<HoldSnapshot> out;
     QSqlQuery q(db_);
     q.prepare("SELECT id, itemId, queuePosition FROM holds WHERE patronId=? ORDER BY queuePosition ASC");
     q.addBindValue(QString::fromStdString(patronId));
-    if (q.exec()) {
+    if (exec(q)) {
         while (q.next()) {
             HoldSnapshot snap;
             snap.id = q.value(0).toString().toStdString();
@@ -578,7 +1415,7 @@ std::vector<HoldSnapshot> Database::GetHoldQueueForItem(const ItemId& itemId) co
     QSqlQuery q(db_);
     q.prepare("SELECT id, patronId, queuePosition FROM holds WHERE itemId=? ORDER BY queuePosition ASC");
     q.addBindValue(QString::fromStdString(itemId));
-    if (q.exec()) {
+    if (exec(q)) {
         while (q.next()) {
             HoldSnapshot snap;
             snap.id = q.value(0).toString().toStdString();
@@ -595,7 +1432,7 @@ std::optional<LoanSnapshot> Database::GetLoanById(const LoanId& loanId) const {
     QSqlQuery q(db_);
     q.prepare("SELECT patronId, itemId, checkoutDate, dueDate FROM loans WHERE id=?");
     q.addBindValue(QString::fromStdString(loanId));
-    if (!q.exec() || !q.next()) return std::nullopt;
+    if (!exec(q) || !q.next()) return std::nullopt;
     LoanSnapshot snap;
     snap.id = loanId;
     snap.patronId = q.value(0).toString().toStdString();
@@ -609,7 +1446,7 @@ std::optional<HoldSnapshot> Database::GetHoldById(const HoldId& holdId) const {
     QSqlQuery q(db_);
     q.prepare("SELECT patronId, itemId, queuePosition FROM holds WHERE id=?");
     q.addBindValue(QString::fromStdString(holdId));
-    if (!q.exec() || !q.next()) return std::nullopt;
+    if (!exec(q) || !q.next()) return std::nullopt;
     HoldSnapshot snap;
     snap.id = holdId;
     snap.patronId = q.value(0).toString().toStdString();
@@ -2,25 +2,78 @@
 
 #include "types.h"
 #include "item.h"
+#include "lrucache.h"
+#include "querystats.h"
+#include "changenotifier.h"
+#include "clock.h"
+#include "usernameindex.h"
+#include "oplog.h"
+#include <functional>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <optional>
+#include <cstdint>
 #include <QSqlDatabase>
 
+class QSqlQuery;
+
 namespace hinlibs {
 
+class CatalogueSnapshot;
+
 class Database {
 public:
     // ----- construction -----
     Database() = default;
     explicit Database(QSqlDatabase db);
 
+    // ----- Transactions -----
+    enum class TransactionMode {
+        Deferred,   // takes the write lock at the first write
+        Immediate   // takes it at BEGIN, so a read-then-write never hits BUSY halfway
+    };
+
+    // Scoped transaction. The outermost one issues BEGIN; one opened while
+    // another is active takes a SAVEPOINT instead (the mode then does not
+    // apply). Leaving scope without commit() rolls back to where this one
+    // began. Every circulation call below opens one, so wrapping several of
+    // them in an outer Transaction makes the whole workflow one commit.
+    class Transaction {
+    public:
+        explicit Transaction(const Database& db, TransactionMode mode = TransactionMode::Deferred);
+        ~Transaction();
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+
+        // False when BEGIN / SAVEPOINT failed; see Database::storageError.
+        bool active() const { return active_; }
+        // False on failure, after which everything since this one began has
+        // been rolled back. Nested commits only release their savepoint.
+        bool commit();
+        void rollback();
+
+    private:
+        const Database& db_;
+        bool active_ = false;
+    };
+
     // ----- Session / Identification -----
     std::optional<UserRecord> FindUserByName(const std::string& username) const;
     std::optional<UserRecord> GetUserById(const UserId& id) const;
+    // Usernames starting with prefix (case-insensitive), for autocomplete.
+    // Served from an in-memory index that is rebuilt with one scan of users
+    // the first time it is needed and whenever the user generation has moved
+    // (see UserGeneration), so new, renamed and deleted users show up.
+    std::vector<UserRecord> CompleteUsernames(const std::string& prefix, std::size_t limit,
+                                              std::optional<Role> role = std::nullopt) const;
 
     // ----- Catalogue -----
+    // Handles come back hydrated: the whole catalogue is read in one query.
     std::vector<Item> GetCatalogueItems() const;
+    // Fills the detail cache of every stale handle with batched IN queries.
+    // Handles whose item no longer exists are left unhydrated.
+    void HydrateItems(const std::vector<Item>& items) const;
     std::vector<ItemSummary> GetCatalogueSummaries() const;
     std::vector<ItemSummary> GetAvailableCatalogue() const;
     std::optional<ItemDetails> GetItemDetails(const ItemId& itemId) const;
@@ -32,25 +85,64 @@ public:
 
     // ----- Borrowing pre-checks (read-only) -----
     std::size_t GetActiveLoanCount(const PatronId& patronId) const;
+    // Settled balance, fines waiting in pendingFines, and what the patron's
+    // overdue loans here have accrued.
+    std::int64_t GetFinesOwed(const PatronId& patronId) const;
     bool IsItemAvailable(const ItemId& itemId) const;
 
-    // ----- Borrow Item (atomic) -----
+    // ----- Circulation (atomic) -----
+    // Each call checks its own preconditions and mutates inside one
+    // transaction; failures carry a CirculationError in addition to the message.
+
+    // Loan limit, outstanding fines, item existence and availability are read
+    // in one statement.
+    // loansElsewhere and finesElsewhere count the patron's loans and fines
+    // owed in other databases (branch shards, see BranchRouter) towards the
+    // limits.
     ValueResult<LoanSnapshot> CheckoutItem(const PatronId& patronId,
-                                           const ItemId& itemId);
+                                           const ItemId& itemId,
+                                           std::size_t loansElsewhere = 0,
+                                           std::int64_t finesElsewhere = 0);
 
-    // ----- Return Item (atomic) -----
+    // Fails with LoanNotFound when the patron has no loan for the item. An
+    // overdue loan's fine is added to the patron's balance or, when this
+    // database has no record of the patron (a branch shard), to pendingFines,
+    // in the same transaction. *fineCents gets the fine either way.
     OperationResult ReturnItem(const PatronId& patronId,
-                               const ItemId& itemId);
+                               const ItemId& itemId,
+                               std::int64_t* fineCents = nullptr);
+
+    // Adds a fine held elsewhere (a branch's pendingFines row) to the
+    // patron's balance. A non-empty reference is recorded with the charge,
+    // and a second charge with the same reference changes nothing, so a
+    // move interrupted before the pending row was cleared can be retried.
+    OperationResult ChargeFine(const PatronId& patronId, std::int64_t cents, const std::string& reference = std::string());
+    // The fines ReturnItem left in pendingFines, oldest first, and removal
+    // of one once its home database has charged it.
+    std::vector<PendingFine> GetPendingFines() const;
+    bool ClearPendingFine(std::int64_t id);
+
+    // Takes up to cents off the patron's settled fine balance, as a payment
+    // or a waiver; value is the balance left. Paying more than is owed
+    // settles the balance ("Nothing owed" when it was already zero).
+    ValueResult<std::int64_t> SettleFine(const PatronId& patronId, std::int64_t cents, FineSettlement how);
 
-    // ----- Holds (atomic) -----
+    // Value is the patron's queue position. A patron who already holds the
+    // item gets their current position back, with message "Hold already exists".
     ValueResult<std::size_t> PlaceHold(const PatronId& patronId,
                                        const ItemId& itemId);
     OperationResult CancelHold(const PatronId& patronId, const ItemId& itemId);
 
     // ----- Account Status & queries -----
+    // Loans with days remaining and fines accrued, holds, and the fine balance.
     AccountStatusView GetPatronAccountStatus(const PatronId& patronId) const;
 
+    // Loans and holds with titles, due dates and queue positions in one joined read
+    PatronDashboard GetPatronDashboard(const PatronId& patronId) const;
+
     std::vector<LoanSnapshot> GetPatronActiveLoans(const PatronId& patronId) const;
+    // Loans with their item's title and format from one joined read, soonest due first
+    std::vector<LoanSnapshotWithItem> GetPatronLoansWithItems(const PatronId& patronId) const;
     std::vector<HoldSnapshot> GetPatronActiveHolds(const PatronId& patronId) const;
     std::vector<HoldSnapshot> GetHoldQueueForItem(const ItemId& itemId) const;
 
@@ -60,9 +152,125 @@ public:
     // ----- Policy -----
     std::size_t MaxActiveLoansPerPatron() const;
     int LoanPeriodDays() const;
+    // Fines owed above which checkout is refused; nullopt for no limit.
+    std::optional<std::int64_t> FineThresholdCents() const;
+
+    // ----- Identity generation -----
+    // Bumped whenever a user record changes; IdentityTokens stamped with an
+    // older generation must be re-resolved through GetUserById. Writes made
+    // through this Database call MarkUserRecordsChanged(); inserts, deletes
+    // and username/role updates from other connections are picked up from
+    // the userChanges counter (kept by triggers on users), polled at most
+    // once per kUserChangePollInterval.
+    std::uint64_t UserGeneration() const;
+    void MarkUserRecordsChanged();
+
+    // ----- Catalogue generation & snapshot -----
+    // Bumped whenever this Database adds, removes, lends or returns an item.
+    std::uint64_t CatalogueGeneration() const { return catalogueGeneration_; }
+    void MarkCatalogueChanged() { ++catalogueGeneration_; }
+
+    // The catalogueChanges counter, bumped by triggers whenever any
+    // connection changes an item's summary columns; a CatalogueSnapshot is
+    // current only while its sourceStamp equals this. 0 if it can't be read.
+    std::uint32_t CatalogueStamp() const;
+
+    // A snapshot loaded at startup (see CatalogueSnapshot). Its summaries are
+    // served until the catalogue changes through this Database; after that
+    // GetSnapshotCatalogue returns nullopt and callers go to SQLite.
+    void AttachCatalogueSnapshot(std::shared_ptr<const CatalogueSnapshot> snapshot);
+    std::optional<std::vector<ItemSummary>> GetSnapshotCatalogue(bool availableOnly) const;
+
+    // ----- Group commit -----
+    // Between BeginGroup and EndGroup every mutation joins one shared
+    // transaction (BEGIN IMMEDIATE), each in a SAVEPOINT of its own: a call
+    // that fails rolls back only its own changes. Nothing is durable, and no
+    // ChangeEvent is published, until EndGroup commits; when that fails the
+    // whole group is rolled back and EndGroup returns false. A successful
+    // EndGroup also syncs the operation log, once for the whole group.
+    bool BeginGroup();
+    bool EndGroup();
+    bool InGroup() const { return inGroup_; }
+
+    // ----- Clock -----
+    // Checkout and due dates, days remaining and log stamps are taken from
+    // this clock (SystemClock unless set). Set it before use; a
+    // SimulatedClock lets tests and simulations move time forward.
+    void SetClock(std::shared_ptr<const Clock> clock) { clock_ = clock ? std::move(clock) : SystemClock::instance(); }
+    const Clock& GetClock() const { return *clock_; }
+    std::shared_ptr<const Clock> SharedClock() const { return clock_; }
+
+    // ----- Change notification -----
+    // Emits batched ChangeEvents after each committed mutation made through
+    // this Database. Changes made by other connections are not seen.
+    ChangeNotifier& Notifier() const { return *notifier_; }
+
+    // ----- Operation log -----
+    // Every committed checkout, return, hold, cancel, add and remove made
+    // through this Database is appended to log (see oplog.h), after the
+    // outermost commit. Pass nullptr to stop logging.
+    void AttachOpLog(std::shared_ptr<OpLogWriter> log) { opLog_ = std::move(log); }
+
+    // ----- Diagnostics -----
+    // File the connection was opened on; tools that need their own
+    // connection (e.g. MaintenanceService) open it again.
+    QString DatabaseName() const { return db_.databaseName(); }
+
+    // Number of SQL statements executed through this Database so far.
+    std::size_t StatementCount() const { return stats_->statementCount(); }
+    // Per-statement counts, latency histograms, lock waits and slow-query log.
+    QueryStats& Stats() const { return *stats_; }
 
 private:
+    bool exec(QSqlQuery& q) const;
+    // Nest: inside an open transaction they become SAVEPOINT / RELEASE /
+    // ROLLBACK TO, so a call can run on its own or as part of a group.
+    bool begin(bool immediate = false) const;
+    bool commit() const;
+    void rollback() const;
+    bool savepoint(const char* verb, int depth) const;
+    // Run at once, or held until the outermost transaction commits.
+    void afterCommit(std::function<void()> effect) const;
+    void publish(const ChangeEvent& event) const;
+    void logOp(OpKind kind, const PatronId& patronId, const ItemId& itemId,
+               const std::string& recordId = std::string(), std::int64_t value = 0) const;
+    CirculationError storageError() const;
+    void ensureIndexes();
+    void ensureFinesSchema();
+    void ensureUserChangeTracking();
+    void ensureCatalogueChangeTracking();
+    // Bumps the user generation if another connection changed users.
+    void pollUserChanges() const;
+    void invalidateUserRecords() const;
+    ItemId generateNewItemId() const;
+
     QSqlDatabase db_;
+    std::unique_ptr<QueryStats> stats_ = std::make_unique<QueryStats>();
+    std::unique_ptr<ChangeNotifier> notifier_ = std::make_unique<ChangeNotifier>();
+    mutable bool lastFailureBusy_ = false;
+    mutable int txnDepth_ = 0;
+    // Held until the outermost commit, tagged with the depth they were
+    // raised at so rolling back a savepoint drops only its own.
+    mutable std::vector<std::pair<int, std::function<void()>>> pendingEffects_;
+    std::shared_ptr<OpLogWriter> opLog_;
+    std::shared_ptr<const Clock> clock_ = SystemClock::instance();
+    bool inGroup_ = false;
+    mutable std::uint64_t userGeneration_ = 1;
+    static constexpr std::chrono::milliseconds kUserChangePollInterval{500};
+    mutable std::chrono::steady_clock::time_point userChangesPolledAt_{};
+    mutable qint64 dataVersion_ = -1;       // PRAGMA data_version at the last poll
+    mutable qint64 userChangesSeen_ = -1;   // userChanges.generation at the last poll
+    std::uint64_t catalogueGeneration_ = 1;
+    std::shared_ptr<const CatalogueSnapshot> snapshot_;
+    std::uint64_t snapshotGeneration_ = 0;
+
+    // Case-folded username -> record; cleared whenever user records change,
+    // here or (seen by pollUserChanges) on another connection.
+    static constexpr std::size_t kUserCacheCapacity = 4096;
+    mutable LruCache<std::string, UserRecord> userCache_{kUserCacheCapacity};
+
+    mutable UsernameIndex usernameIndex_;
+    mutable std::uint64_t usernameIndexGeneration_ = 0;   // 0: not built
 };
 
 } // namespace hinlibs
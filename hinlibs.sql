@@ -1,17 +1,29 @@
+-- hinlibs-bench splits this file on ';' (bench/datagen.cpp), so no comment
+-- at the end of a line may contain one.
+
+-- Free pages can be returned a few at a time (SysAdmin > Maintenance).
+-- Must be set before the first table is created.
+PRAGMA auto_vacuum = INCREMENTAL;
+
 -- Reset existing tables
 DROP TABLE IF EXISTS users;
 DROP TABLE IF EXISTS items;
 DROP TABLE IF EXISTS loans;
 DROP TABLE IF EXISTS holds;
 DROP TABLE IF EXISTS policy;
+DROP TABLE IF EXISTS fineRates;
 
 -- Users
 CREATE TABLE users (
     id TEXT PRIMARY KEY,
     username TEXT UNIQUE NOT NULL,
-    role TEXT NOT NULL
+    role TEXT NOT NULL,
+    fineBalanceCents INTEGER NOT NULL DEFAULT 0  -- fines settled at return
 );
 
+-- Case-insensitive login lookups (FindUserByName) go through this index
+CREATE INDEX idx_users_username_nocase ON users(username COLLATE NOCASE);
+
 -- Items (Catalogue)
 CREATE TABLE items (
     id TEXT PRIMARY KEY,
@@ -28,6 +40,9 @@ CREATE TABLE items (
     publicationDate TEXT
 );
 
+-- Catalogue listings are by title; a catalogue import drops and rebuilds this
+CREATE INDEX idx_items_title ON items(title);
+
 -- Loans (active borrowing records)
 CREATE TABLE loans (
     id TEXT PRIMARY KEY,
@@ -39,6 +54,9 @@ CREATE TABLE loans (
     FOREIGN KEY(itemId) REFERENCES items(id)
 );
 
+-- A patron's loans: the checkout limit and fine checks, and the patron views
+CREATE INDEX idx_loans_patron ON loans(patronId);
+
 -- Holds (FIFO queue records)
 CREATE TABLE holds (
     id TEXT PRIMARY KEY,
@@ -49,20 +67,45 @@ CREATE TABLE holds (
     FOREIGN KEY(itemId) REFERENCES items(id)
 );
 
+-- An item's queue in order, and one patron's hold on one item
+CREATE INDEX idx_holds_item ON holds(itemId, queuePosition);
+CREATE INDEX idx_holds_patron_item ON holds(patronId, itemId);
+
 -- Policy (system-wide settings)
 CREATE TABLE policy (
     maxActiveLoansPerPatron INTEGER,
-    loanPeriodDays INTEGER
+    loanPeriodDays INTEGER,
+    fineThresholdCents INTEGER  -- checkout refused above this, NULL for no limit
+);
+
+-- Overdue fines per item format: per whole day past due, capped per loan
+CREATE TABLE fineRates (
+    format TEXT PRIMARY KEY,
+    centsPerDay INTEGER NOT NULL,
+    maxCentsPerLoan INTEGER NOT NULL
+);
+
+-- Fines from returns in a branch file, which has no user records, until
+-- the home database has charged them
+CREATE TABLE pendingFines (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    patronId TEXT NOT NULL,
+    cents INTEGER NOT NULL
+);
+
+-- Branch fines already charged here, by "<branch>:<pendingFines id>"
+CREATE TABLE chargedFines (
+    reference TEXT PRIMARY KEY
 );
 
 -- Seed Users
-INSERT INTO users VALUES ('U001','ahmed','Patron');
-INSERT INTO users VALUES ('U002','sarah','Patron');
-INSERT INTO users VALUES ('U003','michael','Patron');
-INSERT INTO users VALUES ('U004','abdulrahman','Patron');
-INSERT INTO users VALUES ('U005','aisha','Patron');
-INSERT INTO users VALUES ('U006','lib','Librarian');
-INSERT INTO users VALUES ('U007','admin','SysAdmin');
+INSERT INTO users VALUES ('U001','ahmed','Patron',0);
+INSERT INTO users VALUES ('U002','sarah','Patron',0);
+INSERT INTO users VALUES ('U003','michael','Patron',0);
+INSERT INTO users VALUES ('U004','abdulrahman','Patron',0);
+INSERT INTO users VALUES ('U005','aisha','Patron',0);
+INSERT INTO users VALUES ('U006','lib','Librarian',0);
+INSERT INTO users VALUES ('U007','admin','SysAdmin',0);
 
 -- Seed Items (20 total)
 -- Fiction
@@ -96,4 +139,10 @@ INSERT INTO items VALUES ('I019','Plants vs. Zombies','PopCap Games','VideoGame'
 INSERT INTO items VALUES ('I020','Head Soccer','D&D Dream Corp','VideoGame','Available',2017,NULL,NULL,'Sports','E10+',NULL,NULL);
 
 -- Policy
-INSERT INTO policy VALUES (3,14);
+INSERT INTO policy VALUES (3,14,1000);
+
+-- Fine rates
+INSERT INTO fineRates VALUES ('Book',25,1000);
+INSERT INTO fineRates VALUES ('Magazine',10,500);
+INSERT INTO fineRates VALUES ('Movie',100,2500);
+INSERT INTO fineRates VALUES ('VideoGame',100,3000);
@@ -0,0 +1,12 @@
+# Link against libhinlibscore (core/core.pro). Included by the desktop app
+# and the headless tools; each of them builds one directory below the
+# top-level build dir, next to core/.
+
+QT += core sql
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+LIBS += -L$$OUT_PWD/../core -lhinlibscore
+PRE_TARGETDEPS += $$OUT_PWD/../core/libhinlibscore.a
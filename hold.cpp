@@ -7,19 +7,18 @@ namespace hinlibs {
 
 std::optional<HoldSnapshot> Hold::snapshot() const {
     if (!db_) return std::nullopt;
-    return db_->GetHoldById(id_);
+    if (!snapshot_) snapshot_ = db_->GetHoldById(id_);
+    return snapshot_;
 }
 
 std::optional<HoldOverview> Hold::overview() const {
-    if (!db_) return std::nullopt;
-
-    auto snap = db_->GetHoldById(id_);
+    auto snap = snapshot();
     if (!snap) return std::nullopt;
 
-    auto p = std::make_shared<Patron>(db_, snap->patronId);
-    auto it = std::make_shared<Item>(db_, snap->itemId);
+    if (!patron_) patron_ = std::make_shared<Patron>(db_, snap->patronId);
+    if (!item_) item_ = std::make_shared<Item>(db_, snap->itemId);
 
-    return HoldOverview{ std::move(p), std::move(it), snap->queuePosition };
+    return HoldOverview{ patron_, item_, snap->queuePosition };
 }
 
 } // namespace hinlibs
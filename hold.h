@@ -12,6 +12,7 @@ class Item;
 class Hold {
 public:
     // Constructor
+    // From an id: the snapshot is read once, on first use.
     Hold(std::shared_ptr<Database> db, HoldId id) : db_(std::move(db)), id_(std::move(id)) {}
     ~Hold() = default;
 
@@ -23,6 +24,9 @@ public:
 private:
     std::shared_ptr<Database> db_;
     HoldId id_;
+    mutable std::optional<HoldSnapshot> snapshot_;
+    mutable std::shared_ptr<Patron> patron_;
+    mutable std::shared_ptr<Item> item_;
 };
 
 }
@@ -3,8 +3,12 @@
 #include <QString>
 #include <QPushButton>
 #include <QGridLayout>
+#include <QTimer>
+#include <QToolButton>
+#include <algorithm>
 #include <string>
 #include "types.h"
+#include "database.h"
 #include <QRandomGenerator>
 #include <QStringList>
 #include <QDateTime>
@@ -57,6 +61,9 @@ HomeWindow::HomeWindow(std::shared_ptr<hinlibs::Patron> patron, std::shared_ptr<
     connect(ui->borrowItemButtonHold, &QPushButton::clicked, this, &HomeWindow::borrowItemFromHoldHandler);
     connect(ui->cancelHoldButton, &QPushButton::clicked, this, &HomeWindow::cancelHoldHandler);
 
+    // Patch the grid and profile in place when the database changes
+    connect(&session_->db()->Notifier(), &hinlibs::ChangeNotifier::changed,
+            this, &HomeWindow::onDatabaseChanged);
 }
 
 void HomeWindow::goToProfile()
@@ -96,9 +103,12 @@ void HomeWindow::populateProfileGrid()
 
     layout->setSpacing(0);
 
-    auto holds = patron_->activeHolds();
-    auto loans = patron_->activeLoans();
-    auto loan_number = patron_->activeLoanCount();
+    // Loans, holds and their titles come back from a single joined read.
+    const auto dashboard = patron_->dashboard();
+
+    const auto &holds = dashboard.holds;
+    const auto &loans = dashboard.loans;
+    auto loan_number = loans.size();
 
     const int columns = 2;
     int row = 0;
@@ -140,18 +150,18 @@ void HomeWindow::populateProfileGrid()
 
 
 
-    for (const auto &loan : loans) {
-        auto itemDetails = patron_->getItemDetails(loan.itemId);
+    for (const auto &entry : loans) {
+        const auto &loan = entry.loan;
         using namespace std::chrono;
         auto tp = loan.dueDate;
         auto secs = time_point_cast<seconds>(tp).time_since_epoch().count();
         QDateTime dt = QDateTime::fromSecsSinceEpoch(secs, Qt::LocalTime);
         QString dueStr = dt.toString("yyyy-MM-dd");
-        auto now = system_clock::now();
+        auto now = session_->clock().now();
         auto diff = duration_cast<days>(floor<days>(loan.dueDate - now));
         auto days = (int)diff.count();
         QString text =
-            QString::fromStdString(itemDetails->title + "\n") +tr("Due date: %1 \n").arg(dueStr) + tr("Days left: %1").arg(QString::number(days));
+            QString::fromStdString(entry.itemTitle + "\n") +tr("Due date: %1 \n").arg(dueStr) + tr("Days left: %1").arg(QString::number(days));
 
         QToolButton *btn = new QToolButton(content);
         btn->setText(text);
@@ -200,12 +210,11 @@ void HomeWindow::populateProfileGrid()
     row++;
 
 
-    for (const auto &hold : holds) {
-        auto itemDetails = patron_->getItemDetails(hold.itemId);
-        using namespace std::chrono;
+    for (const auto &entry : holds) {
+        const auto &hold = entry.hold;
         auto place_in_line = hold.queuePosition;
         QString text =
-            QString::fromStdString(itemDetails->title + "\n") +tr("Your position in line: %1 \n").arg(place_in_line);
+            QString::fromStdString(entry.itemTitle + "\n") +tr("Your position in line: %1 \n").arg(place_in_line);
 
         QToolButton *btn = new QToolButton(content);
         btn->setText(text);
@@ -247,7 +256,7 @@ void HomeWindow::populateBorrowedItem(hinlibs::LoanSnapshot loan) {
 
     ui->returnItemWhenBorrowed->setText(tr("Item is due on %1").arg(dueStr));
 
-    auto now = system_clock::now();
+    auto now = session_->clock().now();
     auto diff = duration_cast<days>(floor<days>(loan.dueDate - now));
     auto days = (int)diff.count();
     ui->returnItemDaysLeft->setText(tr("You have %1 days to return this item").arg(QString::number(days)));
@@ -344,7 +353,9 @@ void HomeWindow::goToHome()
     int index = ui->NavigationWidget->indexOf(ui->home);
     ui->NavigationWidget->setCurrentIndex(index);
 
-    renderItems(ui->showCheckedOutItems->isChecked());
+    // Change events keep an existing grid current; build it only once
+    const bool all = ui->showCheckedOutItems->isChecked();
+    if (homeEntries_.isEmpty() || homeShowsAll_ != all) renderItems(all);
 }
 
 void HomeWindow::renderItems(bool all)
@@ -360,6 +371,8 @@ void HomeWindow::renderItems(bool all)
         // Reuse existing layout: clear child widgets only.
         clearLayout(layout);
     }
+    homeEntries_.clear();
+    homeShowsAll_ = all;
 
     ui->scrollAreaHome->setWidgetResizable(true);
 
@@ -393,35 +406,39 @@ void HomeWindow::populateHomeGrid(bool all)
     QGridLayout *layout = qobject_cast<QGridLayout *>(content->layout());
     if (!layout) return;
 
+    // First render: draw from the mapped catalogue snapshot, then replace it
+    // with the SQLite results once the window is on screen.
+    if (!snapshotRendered_) {
+        snapshotRendered_ = true;
+        if (auto summaries = patron_->browseCatalogueSnapshot(all)) {
+            std::vector<hinlibs::ItemDetails> items;
+            items.reserve(summaries->size());
+            for (auto &s : *summaries) {
+                hinlibs::ItemDetails d;
+                static_cast<hinlibs::ItemSummary &>(d) = std::move(s);
+                items.push_back(std::move(d));
+            }
+            addItemButtons(layout, items, false);
+            QTimer::singleShot(0, this, [this]() {
+                renderItems(ui->showCheckedOutItems->isChecked());
+            });
+            return;
+        }
+    }
+
     auto items = all ? patron_->browseCatalogueAll() : patron_->browseCatalogue();
+    addItemButtons(layout, items, true);
+}
 
+void HomeWindow::addItemButtons(QGridLayout *layout, const std::vector<hinlibs::ItemDetails> &items, bool detailsLoaded)
+{
     const int columns = 2;
     int row = 0;
     int col = 0;
 
     for (const auto &item : items) {
-        QString text =
-            QString::fromStdString(item.title + "\nBy " + item.authorOrCreator)
-            + "\nFormat: " + formatToString(item.format)
-            + "\nAvailability: " + statusToString(item.status)
-            // 👇 NEW LINE: show Item ID for librarian to use
-            + "\nID: " + QString::fromStdString(item.id);
-
-        QToolButton *btn = new QToolButton(content);
-        btn->setText(text);
-        btn->setToolButtonStyle(Qt::ToolButtonTextOnly);
-        btn->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Minimum);
-        btn->setMinimumWidth(280);
-        btn->setMaximumWidth(280);
-        btn->setMinimumHeight(80);
-        btn->setMaximumHeight(80);
-        btn->setCursor(Qt::PointingHandCursor);
-
-        btn->setStyleSheet("QToolButton { text-align: left; white-space: normal;}");
-
-        connect(btn, &QToolButton::clicked, this, [this, item]() {
-            onItemClickedHome(item);
-        });
+        QToolButton *btn = makeItemButton(item);
+        homeEntries_.insert(QString::fromStdString(item.id), HomeEntry{ item, detailsLoaded, btn });
 
         layout->addWidget(btn, row, col);
 
@@ -432,6 +449,131 @@ void HomeWindow::populateHomeGrid(bool all)
     }
 }
 
+QString HomeWindow::itemButtonText(const hinlibs::ItemDetails &item) const
+{
+    return QString::fromStdString(item.title + "\nBy " + item.authorOrCreator)
+        + "\nFormat: " + formatToString(item.format)
+        + "\nAvailability: " + statusToString(item.status)
+        // 👇 NEW LINE: show Item ID for librarian to use
+        + "\nID: " + QString::fromStdString(item.id);
+}
+
+QToolButton *HomeWindow::makeItemButton(const hinlibs::ItemDetails &item)
+{
+    QToolButton *btn = new QToolButton(ui->itemsGridContainer);
+    btn->setText(itemButtonText(item));
+    btn->setToolButtonStyle(Qt::ToolButtonTextOnly);
+    btn->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Minimum);
+    btn->setMinimumWidth(280);
+    btn->setMaximumWidth(280);
+    btn->setMinimumHeight(80);
+    btn->setMaximumHeight(80);
+    btn->setCursor(Qt::PointingHandCursor);
+
+    btn->setStyleSheet("QToolButton { text-align: left; white-space: normal;}");
+
+    const QString id = QString::fromStdString(item.id);
+    connect(btn, &QToolButton::clicked, this, [this, id]() {
+        auto it = homeEntries_.find(id);
+        if (it == homeEntries_.end()) return;
+        // Snapshot entries carry only the summary; fetch the rest on demand
+        if (!it->detailsLoaded) {
+            if (auto details = patron_->getItemDetails(it->item.id)) {
+                it->item = *details;
+                it->detailsLoaded = true;
+            }
+        }
+        onItemClickedHome(it->item);
+    });
+    return btn;
+}
+
+// Adds one item that has become visible under the current filter.
+void HomeWindow::insertHomeItem(const hinlibs::ItemId &id)
+{
+    if (!patron_ || homeEntries_.contains(QString::fromStdString(id))) return;
+    auto details = patron_->getItemDetails(id);
+    if (!details) return;
+    if (!homeShowsAll_ && details->status != hinlibs::ItemStatus::Available) return;
+
+    homeEntries_.insert(QString::fromStdString(id), HomeEntry{ *details, true, makeItemButton(*details) });
+}
+
+void HomeWindow::removeHomeItem(const hinlibs::ItemId &id)
+{
+    auto it = homeEntries_.find(QString::fromStdString(id));
+    if (it == homeEntries_.end()) return;
+    delete it->button;   // also takes it out of the layout
+    homeEntries_.erase(it);
+}
+
+// Re-places the existing buttons in title order, as the catalogue query
+// returns them. No widgets are created and nothing is queried.
+void HomeWindow::relayoutHomeGrid()
+{
+    QGridLayout *layout = qobject_cast<QGridLayout *>(ui->itemsGridContainer->layout());
+    if (!layout) return;
+
+    std::vector<const HomeEntry *> entries;
+    entries.reserve(homeEntries_.size());
+    for (const auto &e : homeEntries_) entries.push_back(&e);
+    std::sort(entries.begin(), entries.end(), [](const HomeEntry *a, const HomeEntry *b) {
+        return a->item.title < b->item.title;
+    });
+
+    for (const HomeEntry *e : entries) layout->removeWidget(e->button);
+
+    const int columns = 2;
+    int n = 0;
+    for (const HomeEntry *e : entries) {
+        layout->addWidget(e->button, n / columns, n % columns);
+        ++n;
+    }
+}
+
+void HomeWindow::onDatabaseChanged(const QVector<hinlibs::ChangeEvent> &events)
+{
+    if (!patron_) return;
+
+    bool regrid = false;
+    bool profileChanged = false;
+    for (const auto &e : events) {
+        switch (e.kind) {
+        case hinlibs::ChangeKind::ItemAdded:
+            insertHomeItem(e.itemId);
+            regrid = true;
+            break;
+        case hinlibs::ChangeKind::ItemRemoved:
+            removeHomeItem(e.itemId);
+            regrid = true;
+            break;
+        case hinlibs::ChangeKind::ItemStatusChanged: {
+            auto it = homeEntries_.find(QString::fromStdString(e.itemId));
+            if (it == homeEntries_.end()) {
+                insertHomeItem(e.itemId);
+                regrid = true;
+            } else if (!homeShowsAll_ && e.status != hinlibs::ItemStatus::Available) {
+                removeHomeItem(e.itemId);
+                regrid = true;
+            } else {
+                it->item.status = e.status;
+                it->button->setText(itemButtonText(it->item));
+            }
+            break;
+        }
+        case hinlibs::ChangeKind::LoanCreated:
+        case hinlibs::ChangeKind::LoanClosed:
+        case hinlibs::ChangeKind::HoldQueueChanged:
+            // Queue positions of everyone behind a cancelled hold move too
+            if (e.patronId == patron_->id() || e.kind == hinlibs::ChangeKind::HoldQueueChanged)
+                profileChanged = true;
+            break;
+        }
+    }
+
+    if (regrid) relayoutHomeGrid();
+    if (profileChanged && ui->NavigationWidget->currentWidget() == ui->profile) renderProfile();
+}
 
 void HomeWindow::onItemClickedHome(hinlibs::ItemDetails itemDetails)
 {
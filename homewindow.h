@@ -5,6 +5,12 @@
 #include "patron.h"
 #include "session.h"
 #include <QMainWindow>
+#include <QHash>
+#include <vector>
+#include "changenotifier.h"
+
+class QGridLayout;
+class QToolButton;
 
 namespace Ui {
 class HomeWindow;
@@ -29,6 +35,12 @@ private:
     void renderProfile();
 
     void populateHomeGrid(bool all);
+    void addItemButtons(QGridLayout *layout, const std::vector<hinlibs::ItemDetails> &items, bool detailsLoaded);
+    QToolButton *makeItemButton(const hinlibs::ItemDetails &item);
+    QString itemButtonText(const hinlibs::ItemDetails &item) const;
+    void insertHomeItem(const hinlibs::ItemId &id);
+    void removeHomeItem(const hinlibs::ItemId &id);
+    void relayoutHomeGrid();
     void populateBorrowedItem(hinlibs::LoanSnapshot loan);
     void populateHoldItem(hinlibs::HoldSnapshot hold);
     void clearLayout(QLayout* layout);
@@ -38,12 +50,23 @@ private:
     QString formatExtraDetails(const hinlibs::ItemDetails& details) const;
 
     hinlibs::ItemId itemOnFocus;
+    bool snapshotRendered_ = false;
+
+    // Buttons on the home grid by item id, so change events can patch them
+    struct HomeEntry {
+        hinlibs::ItemDetails item;
+        bool detailsLoaded = false;
+        QToolButton *button = nullptr;
+    };
+    QHash<QString, HomeEntry> homeEntries_;
+    bool homeShowsAll_ = false;
 
 private slots:
     void goToProfile();
     void goToHome();
     void onItemClickedHome(hinlibs::ItemDetails itemDetails);
     void onReloadClickedHome();
+    void onDatabaseChanged(const QVector<hinlibs::ChangeEvent> &events);
 
     void onLoanClickedProfile(hinlibs::LoanSnapshot loanDetails);
     void onHoldClickedProfile(hinlibs::HoldSnapshot holdDetails);
@@ -10,14 +10,29 @@ namespace hinlibs {
 
 std::optional<ItemDetails> Item::details() const {
     if (!db_) return std::nullopt;
-    return db_->GetItemDetails(id_);
+    if (!isHydrated()) {
+        auto det = db_->GetItemDetails(id_);
+        if (!det) return std::nullopt;   // not cached: the item may yet appear
+        hydrate(std::move(*det), db_->CatalogueGeneration());
+    }
+    return details_;
 }
 
 std::optional<ItemSummary> Item::summary() const {
     if (!db_) return std::nullopt;
+    if (isHydrated()) return static_cast<const ItemSummary&>(*details_);
     return db_->GetItemSummary(id_);
 }
 
+bool Item::isHydrated() const {
+    return db_ && details_ && generation_ == db_->CatalogueGeneration();
+}
+
+void Item::hydrate(ItemDetails details, std::uint64_t generation) const {
+    details_ = std::move(details);
+    generation_ = generation;
+}
+
 // ---------- Book (no extra behavior yet) ----------
 // using Item::Item;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.h"
+#include <cstdint>
 #include <memory>
 
 namespace hinlibs {
@@ -8,10 +9,15 @@ namespace hinlibs {
 class Database;
 
 
+// Lightweight, copyable handle to an item row. The Database is not owned
+// and must outlive the handle. Details are fetched on first use (or filled
+// in bulk by Database::GetCatalogueItems / HydrateItems) and cached until the
+// Database's catalogue generation moves on.
 class Item {
 public:
     // Constructor
-    Item(std::shared_ptr<Database> db, ItemId id) : db_(std::move(db)), id_(std::move(id)) {}
+    Item(const Database* db, ItemId id) : db_(db), id_(std::move(id)) {}
+    Item(const std::shared_ptr<Database>& db, ItemId id) : Item(db.get(), std::move(id)) {}
     virtual ~Item() = default;
 
     // Functions
@@ -19,9 +25,20 @@ public:
     std::optional<ItemDetails> details() const;
     std::optional<ItemSummary> summary() const; // equivalent to details() projected
 
+    // True when details() will be answered from the cache.
+    bool isHydrated() const;
+
 protected:
-    std::shared_ptr<Database> db_;
+    const Database* db_ = nullptr;
     ItemId id_;
+
+private:
+    friend class Database;
+    void hydrate(ItemDetails details, std::uint64_t generation) const;
+
+    // Not thread-safe: a handle belongs to the thread that uses its Database.
+    mutable std::optional<ItemDetails> details_;
+    mutable std::uint64_t generation_ = 0;   // 0: never fetched
 };
 
 class Book : public Item {
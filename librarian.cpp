@@ -3,7 +3,8 @@
 
 namespace hinlibs {
 std::string Librarian::getUsername() const {
-    return db_->GetUserById(id_)->username;
+    auto ident = identity();
+    return ident ? ident->user.username : std::string{};
 }
 // Nothing to do yet; anchor the vtable with an out-of-line dtor (optional).
 
@@ -8,6 +8,7 @@ class Librarian : public User {
 public:
     // Constructor
     Librarian(std::shared_ptr<Database> db, LibrarianId id) : User(std::move(db), std::move(id)) {}
+    Librarian(std::shared_ptr<Database> db, IdentityToken identity) : User(std::move(db), std::move(identity)) {}
     Role role() const override { return Role::Librarian; }
     virtual ~Librarian() = default;
     std::string getUsername() const;
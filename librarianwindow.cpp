@@ -1,13 +1,16 @@
 #include "librarianwindow.h"
 #include "ui_librarianwindow.h"
+#include <QCompleter>
 #include <QDateTime>
-#include <QTableWidgetItem>
+#include <QHeaderView>
+#include <QStringListModel>
 #include <chrono>
 
 
 #include "database.h"
 #include "types.h"
 #include "item.h"
+#include "returnloansmodel.h"
 
 #include <QMessageBox>
 #include <QString>
@@ -21,6 +24,21 @@ librarianWindow::librarianWindow(const std::string &username_display,
 {
     ui->setupUi(this);
 
+    returnModel_ = new ReturnLoansModel(this);
+    ui->returnLoansTable->setModel(returnModel_);
+    ui->returnLoansTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    // ---- Patron username autocomplete on the return page ----
+    usernameSuggestions_ = new QStringListModel(this);
+    usernameCompleter_ = new QCompleter(usernameSuggestions_, this);
+    usernameCompleter_->setCaseSensitivity(Qt::CaseInsensitive);
+    usernameCompleter_->setCompletionMode(QCompleter::UnfilteredPopupCompletion);   // list is already filtered
+    ui->returnPatronUsernameEdit->setCompleter(usernameCompleter_);
+    connect(ui->returnPatronUsernameEdit, &QLineEdit::textEdited,
+            this, &librarianWindow::onReturnUsernameEdited);
+    connect(usernameCompleter_, QOverload<const QString &>::of(&QCompleter::activated),
+            this, &librarianWindow::on_findPatronButton_clicked);
+
     // ---- Header: welcome text ----
     ui->welcomeUserLabelLibrarian->setText(
         tr("Welcome, %1").arg(QString::fromStdString(username_display)));
@@ -213,6 +231,42 @@ void librarianWindow::on_removeItemConfirmButton_clicked()
     ui->removeItemIdEdit->clear();
 }
 
+void librarianWindow::setDatabase(hinlibs::Database* db)
+{
+    if (db_) disconnect(&db_->Notifier(), nullptr, this, nullptr);
+    db_ = db;
+    if (db_) {
+        connect(&db_->Notifier(), &hinlibs::ChangeNotifier::changed,
+                this, &librarianWindow::onDatabaseChanged);
+        // Build the username index now rather than on the first keystroke
+        db_->CompleteUsernames(std::string(), 0);
+    }
+}
+
+void librarianWindow::onReturnUsernameEdited(const QString& text)
+{
+    QStringList names;
+    const QString prefix = text.trimmed();
+    if (db_ && !prefix.isEmpty()) {
+        for (const auto& u : db_->CompleteUsernames(prefix.toStdString(), kUsernameSuggestions,
+                                                    hinlibs::Role::Patron)) {
+            names << QString::fromStdString(u.username);
+        }
+    }
+    usernameSuggestions_->setStringList(names);
+    if (!names.isEmpty()) usernameCompleter_->complete();
+}
+
+// Keeps the return table in step with returns made anywhere in the app
+void librarianWindow::onDatabaseChanged(const QVector<hinlibs::ChangeEvent>& events)
+{
+    if (currentReturnPatronId.empty()) return;
+    for (const auto& e : events) {
+        if (e.kind == hinlibs::ChangeKind::LoanClosed && e.patronId == currentReturnPatronId)
+            returnModel_->removeItem(e.itemId);
+    }
+}
+
 void librarianWindow::on_findPatronButton_clicked()
 {
     // Clear previous messages
@@ -245,8 +299,8 @@ void librarianWindow::on_findPatronButton_clicked()
     const auto &rec = *recOpt;
     currentReturnPatronId = rec.id;   // remember which patron we’re working with
 
-    // Get their active loans
-    auto loans = db_->GetPatronActiveLoans(rec.id);
+    // Their loans with titles and formats, in one joined read
+    auto loans = db_->GetPatronLoansWithItems(rec.id);
 
     if (loans.empty()) {
         ui->returnPatronStatusLabel->setText("This patron has no active loans.");
@@ -255,7 +309,7 @@ void librarianWindow::on_findPatronButton_clicked()
     }
 
     ui->returnPatronStatusLabel->setText("Active loans loaded.");
-    fillReturnTable(loans);
+    returnModel_->setLoans(std::move(loans));
 }
 
 void librarianWindow::on_returnSelectedItemButton_clicked()
@@ -274,36 +328,24 @@ void librarianWindow::on_returnSelectedItemButton_clicked()
         return;
     }
 
-    QTableWidget *table = ui->returnLoansTable;
-    int row = table->currentRow();
-    if (row < 0) {
+    const int row = ui->returnLoansTable->currentIndex().row();
+    const auto *loan = returnModel_->loanAt(row);
+    if (!loan) {
         ui->returnItemResultLabel->setText("Please select an item to return.");
         return;
     }
 
-    // Column 0 holds the Item ID
-    QTableWidgetItem *idItem = table->item(row, 0);
-    if (!idItem) {
-        ui->returnItemResultLabel->setText("Internal error: no item id in row.");
-        return;
-    }
-
-    QString itemIdStr = idItem->text();
-    auto result = db_->ReturnItem(currentReturnPatronId,
-                                  itemIdStr.toStdString());
+    const hinlibs::ItemId itemId = loan->itemId;
+    auto result = db_->ReturnItem(currentReturnPatronId, itemId);
 
     if (result.ok) {
         ui->returnItemResultLabel->setStyleSheet("QLabel { color: #2e7d32; }");
         ui->returnItemResultLabel->setText("Item returned successfully.");
 
-        // Refresh the patron's loans in the table
-        auto loans = db_->GetPatronActiveLoans(currentReturnPatronId);
-        if (loans.empty()) {
-            clearReturnTable();
+        // Drop just this row; the other loans are unchanged
+        returnModel_->removeItem(itemId);
+        if (returnModel_->rowCount() == 0)
             ui->returnPatronStatusLabel->setText("All items returned. No active loans.");
-        } else {
-            fillReturnTable(loans);
-        }
     } else {
         ui->returnItemResultLabel->setStyleSheet("QLabel { color: #c62828; }");
         ui->returnItemResultLabel->setText(
@@ -314,61 +356,5 @@ void librarianWindow::on_returnSelectedItemButton_clicked()
 
 void librarianWindow::clearReturnTable()
 {
-    QTableWidget *table = ui->returnLoansTable;
-    table->clearContents();
-    table->setRowCount(0);
-}
-
-void librarianWindow::fillReturnTable(const std::vector<hinlibs::LoanSnapshot> &loans)
-{
-    QTableWidget *table = ui->returnLoansTable;
-
-    table->setColumnCount(4);
-    table->setHorizontalHeaderLabels(
-        QStringList() << "Item ID" << "Title" << "Format" << "Due date"
-    );
-
-    table->setRowCount(static_cast<int>(loans.size()));
-
-    int row = 0;
-    for (const auto &loan : loans) {
-        auto detailsOpt = db_->GetItemDetails(loan.itemId);
-        if (!detailsOpt) continue;
-        const auto &details = *detailsOpt;
-
-        // Convert due date to string
-        using namespace std::chrono;
-        auto tp       = loan.dueDate;
-        auto secs     = time_point_cast<seconds>(tp).time_since_epoch().count();
-        QDateTime dt  = QDateTime::fromSecsSinceEpoch(secs, Qt::LocalTime);
-        QString dueStr = dt.toString("yyyy-MM-dd");
-
-        // Item ID
-        table->setItem(row, 0, new QTableWidgetItem(
-            QString::fromStdString(details.id)
-        ));
-
-        // Title
-        table->setItem(row, 1, new QTableWidgetItem(
-            QString::fromStdString(details.title)
-        ));
-
-        // Format (rough string; you can swap in a helper if you have one)
-        QString fmtStr;
-        switch (details.format) {
-        case hinlibs::ItemFormat::Book:      fmtStr = "Book"; break;
-        case hinlibs::ItemFormat::Magazine:  fmtStr = "Magazine"; break;
-        case hinlibs::ItemFormat::Movie:     fmtStr = "Movie"; break;
-        case hinlibs::ItemFormat::VideoGame: fmtStr = "Video game"; break;
-        default:                             fmtStr = "Unknown"; break;
-        }
-        table->setItem(row, 2, new QTableWidgetItem(fmtStr));
-
-        // Due date
-        table->setItem(row, 3, new QTableWidgetItem(dueStr));
-
-        ++row;
-    }
-
-    table->resizeColumnsToContents();
+    returnModel_->clear();
 }
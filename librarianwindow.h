@@ -1,8 +1,14 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QVector>
 #include <string>
 #include "types.h"
+#include "changenotifier.h"
+
+class ReturnLoansModel;
+class QCompleter;
+class QStringListModel;
 
 namespace hinlibs {
     class Database;
@@ -20,7 +26,7 @@ public:
     explicit librarianWindow(const std::string &username_display,
                              QWidget *parent = nullptr);
 
-    void setDatabase(hinlibs::Database* db) { db_ = db; }
+    void setDatabase(hinlibs::Database* db);
 
 signals:
     void logoutRequest();
@@ -44,6 +50,8 @@ private slots:
     void on_BackFromReturnItem_clicked();
     void on_findPatronButton_clicked();         // <--- NEW
     void on_returnSelectedItemButton_clicked(); // <--- NEW
+    void onDatabaseChanged(const QVector<hinlibs::ChangeEvent>& events);
+    void onReturnUsernameEdited(const QString& text);
 
 private:
     Ui::librarianWindow *ui;
@@ -53,7 +61,12 @@ private:
     // Stores the selected patron ID while returning items
     std::string currentReturnPatronId;
 
-    // Helpers for Return Item page
+    // Return Item page: one joined query per patron lookup; returns remove rows in place
+    ReturnLoansModel* returnModel_ { nullptr };
     void clearReturnTable();   // <--- NEW
-    void fillReturnTable(const std::vector<hinlibs::LoanSnapshot>& loans); // <--- NEW
+
+    // Patron username suggestions, served by Database::CompleteUsernames
+    static constexpr int kUsernameSuggestions = 20;
+    QStringListModel* usernameSuggestions_ { nullptr };
+    QCompleter* usernameCompleter_ { nullptr };
 };
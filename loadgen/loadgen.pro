@@ -0,0 +1,25 @@
+# Concurrent circulation workload replayer; see main.cpp for options.
+
+QT -= gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = hinlibs-loadgen
+
+include(../hinlibs_core.pri)
+
+# Shares the synthetic dataset generator with the benchmark
+INCLUDEPATH += $$PWD/../bench
+
+SOURCES += \
+    ../bench/datagen.cpp \
+    main.cpp \
+    workload.cpp
+
+HEADERS += \
+    ../bench/datagen.h \
+    ../bench/zipf.h \
+    workload.h
+
+RESOURCES += \
+    ../bench/bench.qrc
@@ -0,0 +1,187 @@
+// hinlibs-loadgen: replays a mix of patron circulation actions from many
+// concurrent sessions (one thread + one SQLite connection each) and reports
+// throughput, latency percentiles, SQLITE_BUSY retries and invariant
+// violations at each concurrency level.
+
+#include "datagen.h"
+#include "workload.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTextStream>
+
+using namespace hinlibs;
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("hinlibs-loadgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Multi-session circulation workload replayer.");
+    parser.addHelpOption();
+    QCommandLineOption dbOpt("db", "Database file. Generated unless --reuse is given.", "path");
+    QCommandLineOption reuseOpt("reuse", "Run against an existing hinlibs-bench/loadgen dataset in --db.");
+    QCommandLineOption itemsOpt("items", "Synthetic catalogue size (default 100000).", "n");
+    QCommandLineOption patronsOpt("patrons", "Synthetic patrons (default 20000).", "n");
+    QCommandLineOption threadsOpt("threads", "Concurrency levels to run, e.g. 1,2,4,8,16 (default).", "list");
+    QCommandLineOption secondsOpt("seconds", "Duration of each level (default 10).", "s");
+    QCommandLineOption mixOpt("mix", "Operation weights, e.g. signin:10,browse:1,borrow:35,return:30,hold:15,cancel:9.", "mix");
+    QCommandLineOption zipfOpt("zipf", "Item popularity skew exponent (default 1.0).", "s");
+    QCommandLineOption busyOpt("busy-timeout", "SQLite busy timeout in ms; 0 retries in the driver (default).", "ms");
+    QCommandLineOption journalOpt("journal", "Journal mode: wal (default) or delete.", "mode");
+    QCommandLineOption seedOpt("seed", "Random seed.", "n");
+    QCommandLineOption outOpt("out", "Write JSON results here instead of stdout.", "path");
+    QCommandLineOption simStepOpt("sim-step", "Run on a simulated clock that moves this many minutes per operation.", "minutes");
+    parser.addOptions({ dbOpt, reuseOpt, itemsOpt, patronsOpt, threadsOpt, secondsOpt, mixOpt,
+                        zipfOpt, busyOpt, journalOpt, seedOpt, outOpt, simStepOpt });
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    loadgen::WorkloadConfig config;
+    if (parser.isSet(mixOpt)) {
+        QString error;
+        if (!loadgen::ParseMix(parser.value(mixOpt), &config.mix, &error)) {
+            err << error << "\n";
+            return 1;
+        }
+    }
+    if (parser.isSet(secondsOpt)) config.seconds = parser.value(secondsOpt).toDouble();
+    if (parser.isSet(zipfOpt)) config.zipfExponent = parser.value(zipfOpt).toDouble();
+    if (parser.isSet(busyOpt)) config.busyTimeoutMs = parser.value(busyOpt).toInt();
+    if (parser.isSet(seedOpt)) config.seed = parser.value(seedOpt).toULongLong();
+    if (parser.isSet(simStepOpt)) {
+        const double minutes = parser.value(simStepOpt).toDouble();
+        if (minutes <= 0) {
+            err << "--sim-step must be a positive number of minutes\n";
+            return 1;
+        }
+        config.clock = std::make_shared<SimulatedClock>();
+        config.simulatedStep = std::chrono::seconds(static_cast<qint64>(minutes * 60));
+    }
+
+    QList<int> levels = { 1, 2, 4, 8, 16 };
+    if (parser.isSet(threadsOpt)) {
+        levels.clear();
+        for (const QString& n : parser.value(threadsOpt).split(',', Qt::SkipEmptyParts)) {
+            if (n.toInt() > 0) levels << n.toInt();
+        }
+    }
+
+    const bool tempDb = !parser.isSet(dbOpt);
+    config.dbPath = tempDb ? QDir::temp().filePath(QString("hinlibs-loadgen-%1.sqlite3").arg(QCoreApplication::applicationPid()))
+                           : parser.value(dbOpt);
+    const QString journal = parser.isSet(journalOpt) ? parser.value(journalOpt).toLower() : QString("wal");
+
+    QJsonArray steps;
+    QJsonObject dataset;
+    {
+        QSqlDatabase setup = QSqlDatabase::addDatabase("QSQLITE", "loadgen-setup");
+        setup.setDatabaseName(config.dbPath);
+
+        if (parser.isSet(reuseOpt)) {
+            if (!setup.open()) {
+                err << "Cannot open " << config.dbPath << "\n";
+                return 1;
+            }
+            QSqlQuery q(setup);
+            if (q.exec("SELECT COUNT(*) FROM users WHERE username LIKE 'patron%'") && q.next())
+                config.patrons = q.value(0).toULongLong();
+            if (q.exec("SELECT COUNT(*) FROM items WHERE id GLOB 'I[0-9][0-9][0-9][0-9][0-9][0-9][0-9]'") && q.next())
+                config.items = q.value(0).toULongLong();
+        } else {
+            QFile::remove(config.dbPath);
+            if (!setup.open()) {
+                err << "Cannot open " << config.dbPath << "\n";
+                return 1;
+            }
+            bench::DatasetConfig gen;
+            gen.items = parser.isSet(itemsOpt) ? parser.value(itemsOpt).toULongLong() : 100000;
+            gen.patrons = parser.isSet(patronsOpt) ? parser.value(patronsOpt).toULongLong() : 20000;
+            gen.loans = gen.items * 3 / 10;
+            gen.holds = gen.items / 5;
+            gen.zipfExponent = config.zipfExponent;
+            gen.seed = config.seed;
+            err << "Generating " << gen.items << " items, " << gen.patrons << " patrons...\n";
+            err.flush();
+            bench::DatasetStats stats;
+            QString error;
+            if (!bench::GenerateDataset(setup, gen, &stats, &error)) {
+                err << "Generation failed: " << error << "\n";
+                return 1;
+            }
+            config.items = stats.items;
+            config.patrons = stats.patrons;
+        }
+
+        if (config.items == 0 || config.patrons == 0) {
+            err << "No synthetic items/patrons in " << config.dbPath << "\n";
+            return 1;
+        }
+
+        QSqlQuery pragma(setup);
+        pragma.exec(QString("PRAGMA journal_mode=%1").arg(journal == "delete" ? "DELETE" : "WAL"));
+
+        dataset["items"] = static_cast<qint64>(config.items);
+        dataset["patrons"] = static_cast<qint64>(config.patrons);
+        dataset["journalMode"] = journal;
+
+        for (int threads : levels) {
+            config.threads = threads;
+            err << "Running " << threads << " session(s) for " << config.seconds << " s...\n";
+            err.flush();
+
+            auto step = loadgen::RunWorkload(config);
+            QJsonObject o = loadgen::ToJson(step);
+            o["invariantViolations"] = loadgen::CheckInvariants(setup);
+            steps.append(o);
+
+            err << "  " << o["throughputOpsPerSec"].toDouble() << " ops/s, "
+                << o["busyRetries"].toInt() << " busy retries, "
+                << o["invariantViolations"].toObject()["total"].toInt() << " invariant violations\n";
+            err.flush();
+        }
+        setup.close();
+    }
+    QSqlDatabase::removeDatabase("loadgen-setup");
+    if (tempDb) {
+        QFile::remove(config.dbPath);
+        QFile::remove(config.dbPath + "-wal");
+        QFile::remove(config.dbPath + "-shm");
+    }
+
+    QJsonObject mix;
+    for (std::size_t op = 0; op < loadgen::kOpCount; ++op)
+        mix[loadgen::OpName(static_cast<loadgen::Op>(op))] = static_cast<int>(config.mix.weights[op]);
+
+    QJsonObject root;
+    root["tool"] = "hinlibs-loadgen";
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["dataset"] = dataset;
+    root["mix"] = mix;
+    root["zipfExponent"] = config.zipfExponent;
+    if (config.clock) root["simulatedMinutesPerOp"] = config.simulatedStep.count() / 60.0;
+    root["busyTimeoutMs"] = config.busyTimeoutMs;
+    root["steps"] = steps;
+
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outOpt)) {
+        QFile out(parser.value(outOpt));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "Cannot write " << parser.value(outOpt) << "\n";
+            return 1;
+        }
+        out.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,339 @@
+#include "workload.h"
+
+#include "database.h"
+#include "datagen.h"
+#include "patron.h"
+#include "session.h"
+#include "zipf.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace hinlibs::loadgen {
+
+const char* OpName(Op op) {
+    switch (op) {
+        case Op::SignIn:     return "signIn";
+        case Op::Browse:     return "browseCatalogue";
+        case Op::Borrow:     return "borrowItem";
+        case Op::Return:     return "returnItem";
+        case Op::PlaceHold:  return "placeHold";
+        case Op::CancelHold: return "cancelHold";
+    }
+    return "unknown";
+}
+
+bool ParseMix(const QString& text, OperationMix* mix, QString* error) {
+    static const std::pair<const char*, Op> names[] = {
+        { "signin", Op::SignIn }, { "browse", Op::Browse }, { "borrow", Op::Borrow },
+        { "return", Op::Return }, { "hold", Op::PlaceHold }, { "cancel", Op::CancelHold },
+    };
+
+    OperationMix parsed;
+    parsed.weights.fill(0);
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        const QStringList kv = part.split(':');
+        bool ok = false;
+        const unsigned weight = kv.size() == 2 ? kv[1].trimmed().toUInt(&ok) : 0;
+        const QString name = kv.value(0).trimmed().toLower();
+        auto it = std::find_if(std::begin(names), std::end(names),
+                               [&](const auto& n) { return name == n.first; });
+        if (!ok || it == std::end(names)) {
+            if (error) *error = QString("Bad mix entry '%1'").arg(part);
+            return false;
+        }
+        parsed.weights[static_cast<std::size_t>(it->second)] = weight;
+    }
+    if (std::all_of(parsed.weights.begin(), parsed.weights.end(), [](unsigned w) { return w == 0; })) {
+        if (error) *error = "Mix has no non-zero weights";
+        return false;
+    }
+    *mix = parsed;
+    return true;
+}
+
+namespace {
+
+struct WorkerResult {
+    std::array<OpStats, kOpCount> perOp;
+    std::uint64_t busyRetries = 0;
+    std::uint64_t busyErrors = 0;
+    QString error;
+};
+
+class Worker {
+public:
+    Worker(int index, const WorkloadConfig& config, const std::atomic<bool>& stop, WorkerResult& out)
+        : index_(index), config_(config), stop_(stop), out_(out),
+          rng_(config.seed * 7919 + static_cast<std::uint64_t>(index)),
+          itemRank_(std::max<std::size_t>(config.items, 1), config.zipfExponent),
+          anyPatron_(0, config.patrons ? config.patrons - 1 : 0),
+          pickOp_(config.mix.weights.begin(), config.mix.weights.end()) {}
+
+    void run() {
+        const QString connection = QString("loadgen-%1").arg(index_);
+        {
+            QSqlDatabase sql = QSqlDatabase::addDatabase("QSQLITE", connection);
+            sql.setDatabaseName(config_.dbPath);
+            sql.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(config_.busyTimeoutMs));
+            if (!sql.open()) {
+                out_.error = sql.lastError().text();
+            } else {
+                db_ = std::make_shared<Database>(sql);
+                session_ = std::make_unique<Session>(db_, config_.clock);
+                loop();
+                out_.busyErrors = db_->Stats().busyCount();
+                patron_.reset();
+                session_.reset();
+                db_.reset();
+            }
+            sql.close();
+        }
+        QSqlDatabase::removeDatabase(connection);
+    }
+
+private:
+    void loop() {
+        while (!stop_.load(std::memory_order_relaxed)) {
+            Op op = static_cast<Op>(pickOp_(rng_));
+            if (!patron_) op = Op::SignIn;
+            // Nothing to give back yet: borrow/hold instead so the mix keeps moving.
+            if (op == Op::Return && loans_.empty()) op = Op::Borrow;
+            if (op == Op::CancelHold && holds_.empty()) op = Op::PlaceHold;
+
+            QElapsedTimer timer;
+            timer.start();
+            auto& stats = out_.perOp[static_cast<std::size_t>(op)];
+            CirculationError error = CirculationError::None;
+            bool ok = true;
+
+            switch (op) {
+                case Op::SignIn:
+                    ok = signIn();
+                    if (!ok) error = CirculationError::StorageError;
+                    break;
+                case Op::Browse:
+                    patron_->browseCatalogue();
+                    break;
+                case Op::Borrow: {
+                    const ItemId item = randomItem();
+                    auto r = withRetry([&] { return patron_->borrowItem(item); });
+                    ok = r.ok; error = r.error;
+                    if (ok) loans_.push_back(item);
+                    break;
+                }
+                case Op::Return: {
+                    const std::size_t i = std::uniform_int_distribution<std::size_t>(0, loans_.size() - 1)(rng_);
+                    auto r = withRetry([&] { return patron_->returnItem(loans_[i]); });
+                    ok = r.ok; error = r.error;
+                    if (ok || error == CirculationError::LoanNotFound) {
+                        loans_[i] = loans_.back();
+                        loans_.pop_back();
+                    }
+                    break;
+                }
+                case Op::PlaceHold: {
+                    const ItemId item = randomItem();
+                    auto r = withRetry([&] { return patron_->placeHold(item); });
+                    ok = r.ok; error = r.error;
+                    if (ok && r.message.empty()) holds_.push_back(item);
+                    break;
+                }
+                case Op::CancelHold: {
+                    const std::size_t i = std::uniform_int_distribution<std::size_t>(0, holds_.size() - 1)(rng_);
+                    auto r = withRetry([&] { return patron_->cancelHold(holds_[i]); });
+                    ok = r.ok; error = r.error;
+                    if (ok || error == CirculationError::HoldNotFound) {
+                        holds_[i] = holds_.back();
+                        holds_.pop_back();
+                    }
+                    break;
+                }
+            }
+
+            stats.latenciesNs.push_back(timer.nsecsElapsed());
+            if (config_.clock) config_.clock->advance(config_.simulatedStep);
+            if (ok) ++stats.ok;
+            else if (error == CirculationError::StorageError || error == CirculationError::Busy) ++stats.errors;
+            else ++stats.rejected[error];
+        }
+    }
+
+    bool signIn() {
+        patron_.reset();
+        loans_.clear();
+        holds_.clear();
+        if (!session_->signIn(bench::SyntheticUsername(anyPatron_(rng_)).toStdString())) return false;
+        patron_ = std::dynamic_pointer_cast<Patron>(session_->currentUser());
+        if (!patron_) return false;
+
+        // Pick up what this patron already has so returns/cancels hit real rows.
+        const auto dash = patron_->dashboard();
+        for (const auto& l : dash.loans) loans_.push_back(l.loan.itemId);
+        for (const auto& h : dash.holds) holds_.push_back(h.hold.itemId);
+        return true;
+    }
+
+    ItemId randomItem() {
+        return bench::SyntheticItemId(itemRank_(rng_) - 1).toStdString();
+    }
+
+    // Busy means another desk held the write lock: back off with jitter and retry.
+    template <typename Fn>
+    auto withRetry(Fn&& fn) -> decltype(fn()) {
+        auto r = fn();
+        for (int attempt = 0; r.error == CirculationError::Busy && attempt < config_.maxRetries; ++attempt) {
+            ++out_.busyRetries;
+            const int capUs = std::min(100 << std::min(attempt, 8), 20000);
+            std::this_thread::sleep_for(std::chrono::microseconds(
+                std::uniform_int_distribution<int>(capUs / 2, capUs)(rng_)));
+            r = fn();
+        }
+        return r;
+    }
+
+    int index_;
+    const WorkloadConfig& config_;
+    const std::atomic<bool>& stop_;
+    WorkerResult& out_;
+
+    std::mt19937_64 rng_;
+    bench::ZipfDistribution itemRank_;
+    std::uniform_int_distribution<std::size_t> anyPatron_;
+    std::discrete_distribution<std::size_t> pickOp_;
+
+    std::shared_ptr<Database> db_;
+    std::unique_ptr<Session> session_;
+    std::shared_ptr<Patron> patron_;
+    std::vector<ItemId> loans_;
+    std::vector<ItemId> holds_;
+};
+
+double percentileUs(std::vector<qint64>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))] / 1.0e3;
+}
+
+qint64 countRows(QSqlDatabase db, const QString& sql) {
+    QSqlQuery q(db);
+    if (!q.exec(sql) || !q.next()) return -1;
+    return q.value(0).toLongLong();
+}
+
+} // namespace
+
+StepResult RunWorkload(const WorkloadConfig& config) {
+    std::atomic<bool> stop{false};
+    std::vector<WorkerResult> results(static_cast<std::size_t>(config.threads));
+    std::vector<std::thread> threads;
+
+    const Clock::time_point simulatedStart = config.clock ? config.clock->now() : Clock::time_point{};
+    QElapsedTimer wall;
+    wall.start();
+    for (int i = 0; i < config.threads; ++i) {
+        threads.emplace_back([&, i] {
+            Worker(i, config, stop, results[static_cast<std::size_t>(i)]).run();
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.seconds));
+    stop.store(true);
+    for (auto& t : threads) t.join();
+
+    StepResult step;
+    step.threads = config.threads;
+    step.seconds = wall.nsecsElapsed() / 1.0e9;
+    if (config.clock) {
+        step.simulatedDays = std::chrono::duration<double, std::ratio<86400>>(config.clock->now() - simulatedStart).count();
+    }
+    for (auto& r : results) {
+        if (!r.error.isEmpty()) step.workerErrors << r.error;
+        step.busyRetries += r.busyRetries;
+        step.busyErrors += r.busyErrors;
+        for (std::size_t op = 0; op < kOpCount; ++op) {
+            auto& dst = step.perOp[op];
+            auto& src = r.perOp[op];
+            dst.latenciesNs.insert(dst.latenciesNs.end(), src.latenciesNs.begin(), src.latenciesNs.end());
+            dst.ok += src.ok;
+            dst.errors += src.errors;
+            for (const auto& [reason, n] : src.rejected) dst.rejected[reason] += n;
+            step.operations += src.latenciesNs.size();
+        }
+    }
+    return step;
+}
+
+QJsonObject CheckInvariants(QSqlDatabase db) {
+    QJsonObject o;
+    o["doubleLoans"] = countRows(db,
+        "SELECT COUNT(*) FROM (SELECT itemId FROM loans GROUP BY itemId HAVING COUNT(*) > 1)");
+    o["loanedButAvailable"] = countRows(db,
+        "SELECT COUNT(*) FROM loans l JOIN items i ON i.id = l.itemId WHERE i.status = 'Available'");
+    o["checkedOutWithoutLoan"] = countRows(db,
+        "SELECT COUNT(*) FROM items i WHERE i.status = 'CheckedOut' "
+        "AND NOT EXISTS (SELECT 1 FROM loans l WHERE l.itemId = i.id)");
+    o["patronsOverLimit"] = countRows(db,
+        "SELECT COUNT(*) FROM (SELECT patronId FROM loans GROUP BY patronId "
+        "HAVING COUNT(*) > IFNULL((SELECT maxActiveLoansPerPatron FROM policy), 3))");
+    o["brokenHoldQueues"] = countRows(db,
+        "SELECT COUNT(*) FROM (SELECT itemId FROM holds GROUP BY itemId "
+        "HAVING MIN(queuePosition) <> 1 OR MAX(queuePosition) <> COUNT(*) "
+        "OR COUNT(DISTINCT queuePosition) <> COUNT(*))");
+    o["duplicateHolds"] = countRows(db,
+        "SELECT COUNT(*) FROM (SELECT patronId, itemId FROM holds GROUP BY patronId, itemId HAVING COUNT(*) > 1)");
+
+    qint64 total = 0;
+    for (const QString& key : o.keys()) total += std::max<qint64>(0, o[key].toInt());
+    o["total"] = total;
+    return o;
+}
+
+QJsonObject ToJson(StepResult& step) {
+    QJsonObject perOp;
+    for (std::size_t op = 0; op < kOpCount; ++op) {
+        auto& s = step.perOp[op];
+        if (s.latenciesNs.empty()) continue;
+        std::sort(s.latenciesNs.begin(), s.latenciesNs.end());
+
+        QJsonObject rejected;
+        for (const auto& [reason, n] : s.rejected) rejected[CirculationErrorName(reason)] = static_cast<qint64>(n);
+
+        QJsonObject o;
+        o["count"] = static_cast<qint64>(s.latenciesNs.size());
+        o["ok"] = static_cast<qint64>(s.ok);
+        o["errors"] = static_cast<qint64>(s.errors);
+        o["rejected"] = rejected;
+        o["p50Us"] = percentileUs(s.latenciesNs, 0.50);
+        o["p95Us"] = percentileUs(s.latenciesNs, 0.95);
+        o["p99Us"] = percentileUs(s.latenciesNs, 0.99);
+        o["maxUs"] = s.latenciesNs.back() / 1.0e3;
+        perOp[OpName(static_cast<Op>(op))] = o;
+    }
+
+    QJsonObject o;
+    o["threads"] = step.threads;
+    o["seconds"] = step.seconds;
+    o["operations"] = static_cast<qint64>(step.operations);
+    o["throughputOpsPerSec"] = step.seconds > 0 ? step.operations / step.seconds : 0.0;
+    o["busyRetries"] = static_cast<qint64>(step.busyRetries);
+    o["busyErrors"] = static_cast<qint64>(step.busyErrors);
+    if (step.simulatedDays > 0) o["simulatedDays"] = step.simulatedDays;
+    o["perOp"] = perOp;
+    if (!step.workerErrors.isEmpty()) {
+        QJsonArray errors;
+        for (const QString& e : step.workerErrors) errors.append(e);
+        o["workerErrors"] = errors;
+    }
+    return o;
+}
+
+} // namespace hinlibs::loadgen
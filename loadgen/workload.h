@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QString>
+
+#include "clock.h"
+#include "types.h"
+
+namespace hinlibs::loadgen {
+
+enum class Op { SignIn, Browse, Borrow, Return, PlaceHold, CancelHold };
+constexpr std::size_t kOpCount = 6;
+
+const char* OpName(Op op);
+
+// Relative weights; an op whose weight is zero never runs.
+struct OperationMix {
+    std::array<unsigned, kOpCount> weights{ 10, 1, 35, 30, 15, 9 };
+};
+
+// Parses "signin:10,browse:1,borrow:35,return:30,hold:15,cancel:9".
+bool ParseMix(const QString& text, OperationMix* mix, QString* error);
+
+struct WorkloadConfig {
+    QString dbPath;
+    int threads = 1;
+    double seconds = 10.0;
+    std::size_t items = 0;      // synthetic ids I0000001..; see bench/datagen.h
+    std::size_t patrons = 0;    // synthetic usernames patron0000001..
+    double zipfExponent = 1.0;
+    int busyTimeoutMs = 0;      // 0: surface SQLITE_BUSY immediately and retry here
+    int maxRetries = 20;
+    std::uint64_t seed = 7;
+    OperationMix mix;
+    // When set, every session runs on this clock and each operation moves it
+    // forward by simulatedStep, so due dates pass within a run.
+    std::shared_ptr<SimulatedClock> clock;
+    std::chrono::seconds simulatedStep{0};
+};
+
+struct OpStats {
+    std::vector<qint64> latenciesNs;
+    std::uint64_t ok = 0;
+    std::uint64_t errors = 0;                          // StorageError / Busy after retries
+    std::map<CirculationError, std::uint64_t> rejected; // business-rule refusals
+};
+
+struct StepResult {
+    int threads = 0;
+    double seconds = 0.0;
+    std::uint64_t operations = 0;
+    std::uint64_t busyRetries = 0;
+    std::uint64_t busyErrors = 0;   // as seen by Database's QueryStats
+    double simulatedDays = 0.0;     // how far config.clock moved
+    std::array<OpStats, kOpCount> perOp;
+    QStringList workerErrors;
+};
+
+// Runs config.threads sessions, each on its own thread and connection, for
+// config.seconds.
+StepResult RunWorkload(const WorkloadConfig& config);
+
+// Circulation invariants over the whole database: items with two loans,
+// status/loan disagreements, patrons over the loan limit, hold queues that
+// aren't 1..n, and duplicate holds.
+QJsonObject CheckInvariants(QSqlDatabase db);
+
+QJsonObject ToJson(StepResult& step);
+
+} // namespace hinlibs::loadgen
@@ -7,21 +7,26 @@ namespace hinlibs {
 
 std::optional<LoanSnapshot> Loan::snapshot() const {
     if (!db_) return std::nullopt;
-    return db_->GetLoanById(id_);
+    if (!snapshot_) snapshot_ = db_->GetLoanById(id_);
+    return snapshot_;
 }
 
 std::shared_ptr<Patron> Loan::patron() const {
-    if (!db_) return nullptr;
-    auto snap = db_->GetLoanById(id_);
-    if (!snap) return nullptr;
-    return std::make_shared<Patron>(db_, snap->patronId);
+    if (!patron_) {
+        auto snap = snapshot();
+        if (!snap) return nullptr;
+        patron_ = std::make_shared<Patron>(db_, snap->patronId);
+    }
+    return patron_;
 }
 
 std::shared_ptr<Item> Loan::item() const {
-    if (!db_) return nullptr;
-    auto snap = db_->GetLoanById(id_);
-    if (!snap) return nullptr;
-    return std::make_shared<Item>(db_, snap->itemId);
+    if (!item_) {
+        auto snap = snapshot();
+        if (!snap) return nullptr;
+        item_ = std::make_shared<Item>(db_, snap->itemId);
+    }
+    return item_;
 }
 
 } // namespace hinlibs
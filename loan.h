@@ -12,7 +12,11 @@ class Item;
 class Loan {
 public:
     // Constructor
+    // From an id: the snapshot is read once, on first use.
     Loan(std::shared_ptr<Database> db, LoanId id) : db_(std::move(db)), id_(std::move(id)) {}
+    // From a snapshot already in hand (CheckoutItem): no query.
+    Loan(std::shared_ptr<Database> db, LoanSnapshot snapshot)
+        : db_(std::move(db)), id_(snapshot.id), snapshot_(std::move(snapshot)) {}
     ~Loan() = default;
 
     // Functions
@@ -24,6 +28,9 @@ public:
 private:
     std::shared_ptr<Database> db_;
     LoanId id_;
+    mutable std::optional<LoanSnapshot> snapshot_;
+    mutable std::shared_ptr<Patron> patron_;
+    mutable std::shared_ptr<Item> item_;
 };
 
 }
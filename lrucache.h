@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace hinlibs {
+
+// Small fixed-capacity LRU map. Lookups and inserts are O(1); the least
+// recently used entry is evicted once capacity is reached.
+// Not thread-safe (same as the QSqlDatabase connection it sits next to).
+template <typename Key, typename Value>
+class LruCache {
+public:
+    explicit LruCache(std::size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    std::optional<Value> get(const Key& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return std::nullopt;
+        entries_.splice(entries_.begin(), entries_, it->second);  // mark as most recent
+        return it->second->second;
+    }
+
+    void put(const Key& key, Value value) {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        entries_.emplace_front(key, std::move(value));
+        index_[key] = entries_.begin();
+    }
+
+    void erase(const Key& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return;
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+
+    void clear() {
+        entries_.clear();
+        index_.clear();
+    }
+
+    std::size_t size() const { return entries_.size(); }
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    using Entry = std::pair<Key, Value>;
+
+    std::size_t capacity_;
+    std::list<Entry> entries_;  // front = most recently used
+    std::unordered_map<Key, typename std::list<Entry>::iterator> index_;
+};
+
+} // namespace hinlibs
@@ -9,6 +9,8 @@
 #include "mainwindow.h"
 #include "database.h"
 #include "session.h"
+#include "cataloguesnapshot.h"
+#include "oplog.h"
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
@@ -23,14 +25,75 @@ int main(int argc, char *argv[]) {
     } else {
         qDebug() << "Database opened successfully";
         qDebug() << "Database path:" << sqlDb.databaseName();
+        // Readers (exports, backups) then never block circulation writes.
+        QSqlQuery(sqlDb).exec("PRAGMA journal_mode=WAL");
     }
 
     // Wrap in your Database and Session classes
     auto database = std::make_shared<hinlibs::Database>(sqlDb);
     auto session  = std::make_shared<hinlibs::Session>(database);
 
+    // Query instrumentation: HINLIBS_SLOW_QUERY_MS sets the slow-query log
+    // threshold, HINLIBS_QUERY_STATS names a file for a JSON snapshot on exit
+    // (and turns on row counting, which the snapshot reports).
+    bool thresholdOk = false;
+    const int slowMs = qEnvironmentVariableIntValue("HINLIBS_SLOW_QUERY_MS", &thresholdOk);
+    if (thresholdOk) {
+        database->Stats().setSlowQueryThreshold(std::chrono::milliseconds(slowMs));
+    }
+    database->Stats().setCountRows(!qEnvironmentVariableIsEmpty("HINLIBS_QUERY_STATS"));
+
+    // Catalogue snapshot: mapped now so the first home screen needs no
+    // query, rewritten on exit if the database changed since it was written.
+    // A stale one (written before another program changed the catalogue) is
+    // not attached; the exit rewrite replaces it.
+    const QString snapshotPath = QCoreApplication::applicationDirPath() + "/hinlibs.catalogue";
+    QString snapshotError;
+    std::uint32_t snapshotStamp = 0;
+    if (auto snapshot = hinlibs::CatalogueSnapshot::Open(snapshotPath, &snapshotError)) {
+        const std::uint32_t stamp = database->CatalogueStamp();
+        if (stamp != 0 && snapshot->sourceStamp() == stamp) {
+            snapshotStamp = stamp;
+            database->AttachCatalogueSnapshot(std::move(snapshot));
+        } else {
+            qDebug() << "Ignoring stale catalogue snapshot";
+        }
+    } else if (QFile::exists(snapshotPath)) {
+        qDebug() << "Ignoring catalogue snapshot:" << snapshotError;
+    }
+
+    // Operation log: every committed circulation change, for audit and
+    // for rebuilding loans and holds with `hinlibs-cli oplog replay`.
+    auto opLog = std::make_shared<hinlibs::OpLogWriter>(QCoreApplication::applicationDirPath() + "/hinlibs.oplog");
+    QString opLogError;
+    if (opLog->open(&opLogError)) {
+        database->AttachOpLog(opLog);
+    } else {
+        qDebug() << "Operation log disabled:" << opLogError;
+    }
+
     MainWindow w(session);
     w.show();
 
-    return app.exec();
+    const int rc = app.exec();
+
+    const std::uint32_t stamp = database->CatalogueStamp();
+    if (sqlDb.isOpen() && (stamp == 0 || stamp != snapshotStamp)) {
+        if (!hinlibs::CatalogueSnapshot::Write(snapshotPath, database->GetCatalogueSummaries(),
+                                               stamp, &snapshotError)) {
+            qDebug() << "Could not write catalogue snapshot:" << snapshotError;
+        }
+    }
+
+    const QString statsPath = qEnvironmentVariable("HINLIBS_QUERY_STATS");
+    if (!statsPath.isEmpty()) {
+        QFile out(statsPath);
+        if (out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            out.write(database->Stats().toJson());
+        } else {
+            qDebug() << "Could not write query stats to" << statsPath;
+        }
+    }
+
+    return rc;
 }
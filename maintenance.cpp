@@ -0,0 +1,422 @@
+#include "maintenance.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QVariant>
+
+namespace hinlibs {
+
+// One run of one or more tasks; lines become the finished() summary.
+struct MaintenanceService::Run {
+    QStringList lines;
+    bool ok = true;
+};
+
+namespace {
+
+QStringList userTables(QSqlDatabase& db) {
+    QStringList out;
+    QSqlQuery q(db);
+    if (q.exec("SELECT name FROM sqlite_master WHERE type='table' AND name NOT LIKE 'sqlite_%' ORDER BY name")) {
+        while (q.next()) out << q.value(0).toString();
+    }
+    return out;
+}
+
+qlonglong pragmaInt(QSqlDatabase& db, const QString& pragma) {
+    QSqlQuery q(db);
+    if (!q.exec("PRAGMA " + pragma) || !q.next()) return -1;
+    return q.value(0).toLongLong();
+}
+
+QString quoted(const QString& identifier) {
+    return QString("\"%1\"").arg(QString(identifier).replace("\"", "\"\""));
+}
+
+} // namespace
+
+MaintenanceService::MaintenanceService(QString databasePath, QObject* parent)
+    : QObject(parent),
+      path_(std::move(databasePath)),
+      connection_(QString("hinlibs-maintenance-%1").arg(reinterpret_cast<quintptr>(this), 0, 16)) {}
+
+MaintenanceService::~MaintenanceService() {
+    stop();
+}
+
+bool MaintenanceService::start(QString* error) {
+    if (thread_.joinable()) return true;
+    std::promise<bool> ready;
+    auto opened = ready.get_future();
+    stopping_ = false;
+    thread_ = std::thread([this, &ready]() { loop(&ready); });
+    if (!opened.get()) {
+        thread_.join();
+        if (error) *error = "Could not open " + path_ + " for maintenance";
+        return false;
+    }
+    return true;
+}
+
+void MaintenanceService::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cancel_ = true;
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void MaintenanceService::trigger(int tasks) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requested_ |= tasks & (AllTasks | Backup);
+    }
+    cv_.notify_one();
+}
+
+void MaintenanceService::setSchedule(int tasks, std::chrono::minutes every) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = std::chrono::steady_clock::now();
+        for (int i = 0; i < kTaskCount; ++i) {
+            if (!(tasks & (1 << i))) continue;
+            schedules_[i].interval = every;
+            schedules_[i].next = now + every;
+        }
+    }
+    cv_.notify_one();
+}
+
+void MaintenanceService::setBackupTarget(const QString& directory, int keep) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    backupDir_ = directory;
+    backupKeep_ = keep;
+}
+
+// Both called with mutex_ held.
+int MaintenanceService::dueTasks(std::chrono::steady_clock::time_point now) const {
+    int tasks = 0;
+    for (int i = 0; i < kTaskCount; ++i) {
+        if (schedules_[i].interval.count() > 0 && now >= schedules_[i].next) tasks |= 1 << i;
+    }
+    return tasks;
+}
+
+std::chrono::steady_clock::time_point MaintenanceService::nextDue() const {
+    auto next = std::chrono::steady_clock::time_point::max();
+    for (const Schedule& s : schedules_) {
+        if (s.interval.count() > 0) next = std::min(next, s.next);
+    }
+    return next;
+}
+
+void MaintenanceService::cancel() {
+    cancel_ = true;
+}
+
+bool MaintenanceService::pause() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_for(lock, std::chrono::milliseconds(pauseMs_.load()), [this] { return stopping_; });
+    return !stopping_ && !cancel_;
+}
+
+void MaintenanceService::loop(std::promise<bool>* ready) {
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection_);
+        db.setDatabaseName(path_);
+        // Wait for the main connection's short transactions rather than fail
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=2000");
+        const bool ok = db.open();
+        ready->set_value(ok);
+
+        while (ok) {
+            int tasks = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                auto wake = [this] {
+                    return stopping_ || requested_ != 0 || dueTasks(std::chrono::steady_clock::now()) != 0;
+                };
+                const auto next = nextDue();
+                if (next != std::chrono::steady_clock::time_point::max()) cv_.wait_until(lock, next, wake);
+                else cv_.wait(lock, wake);
+                if (stopping_) break;
+
+                const auto now = std::chrono::steady_clock::now();
+                const int due = dueTasks(now);
+                for (int i = 0; i < kTaskCount; ++i) {
+                    if (due & (1 << i)) schedules_[i].next = now + schedules_[i].interval;
+                }
+                tasks = requested_ | due;
+                requested_ = 0;
+            }
+            if (tasks) runTasks(db, tasks);
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection_);
+}
+
+void MaintenanceService::runTasks(QSqlDatabase& db, int tasks) {
+    cancel_ = false;
+    busy_ = true;
+    QElapsedTimer timer;
+    timer.start();
+
+    Run run;
+    bool completed = true;
+    if (completed && (tasks & Analyze)) completed = analyze(db, run);
+    if (completed && (tasks & IncrementalVacuum)) completed = vacuum(db, run);
+    if (completed && (tasks & Checkpoint)) completed = checkpoint(db, run);
+    if (completed && (tasks & IntegrityCheck)) completed = integrityCheck(db, run);
+    if (completed && (tasks & Backup)) completed = backup(run);
+
+    if (!completed) {
+        run.ok = false;
+        run.lines << "Cancelled.";
+    }
+    run.lines << QString("Finished in %1 s.").arg(timer.elapsed() / 1000.0, 0, 'f', 2);
+    busy_ = false;
+    emit finished(run.lines.join('\n'), run.ok);
+}
+
+// ----- ANALYZE: one table per step, sampled, then PRAGMA optimize -----
+bool MaintenanceService::analyze(QSqlDatabase& db, Run& run) {
+    // Per connection, so it covers PRAGMA optimize below as well. SQLite
+    // before 3.32 doesn't know the pragma and reads back nothing.
+    QSqlQuery limit(db);
+    limit.exec(QString("PRAGMA analysis_limit=%1").arg(analysisLimit_.load()));
+    const qlonglong sampled = pragmaInt(db, "analysis_limit");
+
+    const QStringList tables = userTables(db);
+    const int steps = tables.size() + 1;
+    int step = 0;
+    for (const QString& table : tables) {
+        QSqlQuery q(db);
+        if (!q.exec("ANALYZE " + quoted(table))) {
+            run.ok = false;
+            run.lines << QString("ANALYZE %1 failed: %2").arg(table, q.lastError().text());
+        }
+        emit progress("Analyze", ++step, steps, table);
+        if (!pause()) return false;
+    }
+    QSqlQuery opt(db);
+    opt.exec("PRAGMA optimize");
+    emit progress("Analyze", ++step, steps, "optimize");
+
+    // What the planner will now work from
+    run.lines << (sampled > 0
+                      ? QString("Analyzed %1 tables, sampling up to %2 rows per index.").arg(tables.size()).arg(sampled)
+                      : QString("Analyzed %1 tables in full.").arg(tables.size()));
+    QSqlQuery stats(db);
+    if (stats.exec("SELECT tbl, idx, stat FROM sqlite_stat1 WHERE idx IS NOT NULL ORDER BY tbl, idx")) {
+        while (stats.next()) {
+            const QStringList parts = stats.value(2).toString().split(' ');
+            const QString rows = parts.value(0);
+            const QString perKey = parts.value(1, "?");
+            run.lines << QString("  %1.%2: %3 rows, ~%4 per key")
+                             .arg(stats.value(0).toString(), stats.value(1).toString(), rows, perKey);
+        }
+    }
+    return true;
+}
+
+// ----- Incremental VACUUM: pagesPerStep free pages per step -----
+bool MaintenanceService::vacuum(QSqlDatabase& db, Run& run) {
+    const qlonglong pageSize = pragmaInt(db, "page_size");
+    const qlonglong before = pragmaInt(db, "freelist_count");
+    if (pragmaInt(db, "auto_vacuum") != 2) {
+        // Switching auto_vacuum on an existing file needs a full VACUUM,
+        // which locks the database for its whole duration.
+        run.lines << QString("Vacuum skipped: auto_vacuum is not INCREMENTAL (%1 free pages).").arg(before);
+        emit progress("Vacuum", 1, 1, "not enabled");
+        return true;
+    }
+
+    qlonglong remaining = before;
+    const int steps = before > 0 ? int((before + pagesPerStep_ - 1) / pagesPerStep_) : 1;
+    int step = 0;
+    while (remaining > 0) {
+        QSqlQuery q(db);
+        if (!q.exec(QString("PRAGMA incremental_vacuum(%1)").arg(pagesPerStep_.load()))) {
+            run.ok = false;
+            run.lines << "Vacuum failed: " + q.lastError().text();
+            break;
+        }
+        while (q.next()) {}   // the pragma works as rows are stepped
+        const qlonglong now = pragmaInt(db, "freelist_count");
+        if (now >= remaining) break;   // nothing more to give back
+        remaining = now;
+        emit progress("Vacuum", ++step, steps, QString("%1 free pages left").arg(remaining));
+        if (!pause()) return false;
+    }
+    const qlonglong reclaimed = before - remaining;
+    run.lines << QString("Vacuum reclaimed %1 pages (%2 KiB); %3 free pages left.")
+                     .arg(reclaimed).arg(reclaimed * pageSize / 1024).arg(remaining);
+    if (step == 0) emit progress("Vacuum", 1, 1, "nothing to reclaim");
+    return true;
+}
+
+// ----- WAL checkpoint -----
+bool MaintenanceService::checkpoint(QSqlDatabase& db, Run& run) {
+    QSqlQuery mode(db);
+    const QString journal = mode.exec("PRAGMA journal_mode") && mode.next() ? mode.value(0).toString() : QString();
+    if (journal.compare("wal", Qt::CaseInsensitive) != 0) {
+        run.lines << QString("Checkpoint skipped: journal mode is %1, not WAL.").arg(journal);
+        emit progress("Checkpoint", 1, 1, "not in WAL mode");
+        return true;
+    }
+    // PASSIVE never waits for readers or writers
+    QSqlQuery q(db);
+    if (q.exec("PRAGMA wal_checkpoint(PASSIVE)") && q.next()) {
+        run.lines << QString("Checkpoint: %1 of %2 WAL frames copied%3.")
+                         .arg(q.value(2).toLongLong()).arg(q.value(1).toLongLong())
+                         .arg(q.value(0).toInt() ? " (partly blocked by readers)" : "");
+    } else {
+        run.ok = false;
+        run.lines << "Checkpoint failed: " + q.lastError().text();
+    }
+    emit progress("Checkpoint", 1, 1, "done");
+    return true;
+}
+
+// ----- quick_check: one table per step -----
+bool MaintenanceService::integrityCheck(QSqlDatabase& db, Run& run) {
+    const QStringList tables = userTables(db);
+    QStringList problems;
+    int step = 0;
+    for (const QString& table : tables) {
+        QSqlQuery q(db);
+        if (!q.exec(QString("PRAGMA quick_check(%1)").arg(quoted(table)))) {
+            // SQLite before 3.33 checks only the whole file
+            QSqlQuery whole(db);
+            if (whole.exec("PRAGMA quick_check")) {
+                while (whole.next()) {
+                    if (whole.value(0).toString() != "ok") problems << whole.value(0).toString();
+                }
+            } else {
+                problems << whole.lastError().text();
+            }
+            emit progress("Integrity check", 1, 1, "whole database");
+            break;
+        }
+        while (q.next()) {
+            if (q.value(0).toString() != "ok") problems << q.value(0).toString();
+        }
+        emit progress("Integrity check", ++step, tables.size(), table);
+        if (!pause()) return false;
+    }
+    if (problems.isEmpty()) {
+        run.lines << "Integrity check: ok.";
+    } else {
+        run.ok = false;
+        run.lines << QString("Integrity check found %1 problems:").arg(problems.size());
+        for (const QString& p : problems.mid(0, 20)) run.lines << "  " + p;
+    }
+    return true;
+}
+
+// ----- Online backup: run by hinlibs-cli, then rotation -----
+// This process has the database open through QSQLITE, whose SQLite may be
+// Qt's bundled copy rather than the one BackupDatabase links; closing a file
+// in one copy drops the other's POSIX locks. So the copy runs in a
+// hinlibs-cli process of its own, which reports each step on stdout.
+bool MaintenanceService::backup(Run& run) {
+    QString dir;
+    int keep;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dir = backupDir_;
+        keep = backupKeep_;
+    }
+    if (dir.isEmpty()) {
+        run.ok = false;
+        run.lines << "Backup skipped: no backup directory set.";
+        return true;
+    }
+    const QString appDir = QCoreApplication::applicationDirPath();
+    QString program = QStandardPaths::findExecutable("hinlibs-cli", { appDir, appDir + "/../cli" });
+    if (program.isEmpty()) program = QStandardPaths::findExecutable("hinlibs-cli");
+    if (program.isEmpty()) {
+        run.ok = false;
+        run.lines << "Backup failed: hinlibs-cli was not found next to the application or on the PATH.";
+        return true;
+    }
+
+    QProcess cli;
+    cli.setProgram(program);
+    cli.setArguments({ "--db", path_, "backup", "--out", dir, "--keep", QString::number(keep),
+                       "--pages", QString::number(pagesPerStep_.load()), "--pause", QString::number(pauseMs_.load()),
+                       "--progress" });
+    // File times may be whole seconds
+    const QDateTime started = QDateTime::currentDateTime().addSecs(-1);
+    cli.start();
+    if (!cli.waitForStarted()) {
+        run.ok = false;
+        run.lines << "Backup failed: cannot run " + program + ": " + cli.errorString();
+        return true;
+    }
+
+    QString target;
+    auto readLines = [&]() {
+        while (cli.canReadLine()) {
+            const QString line = QString::fromUtf8(cli.readLine()).trimmed();
+            const QStringList parts = line.split(' ');
+            if (parts.size() == 3 && parts[0] == "progress") {
+                emit progress("Backup", parts[1].toInt(), parts[2].toInt(), QString("%1 of %2 pages").arg(parts[1], parts[2]));
+            } else if (!line.isEmpty()) {
+                target = line;   // the last line names the finished backup
+            }
+        }
+    };
+    bool cancelled = false;
+    while (cli.state() != QProcess::NotRunning) {
+        cli.waitForReadyRead(100);
+        readLines();
+        bool stopping;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping = stopping_;
+        }
+        if (stopping || cancel_) {
+            cancelled = true;
+            cli.kill();
+            cli.waitForFinished();
+            break;
+        }
+    }
+    readLines();
+
+    if (cancelled) {
+        // The copy killed mid-way is still named *.part
+        QDir backups(dir);
+        for (const QString& name : backups.entryList({ "hinlibs-*.sqlite3.part" }, QDir::Files)) {
+            if (QFileInfo(backups.filePath(name)).lastModified() >= started) backups.remove(name);
+        }
+        return false;
+    }
+
+    // The CLI's report (or its error) is on stderr
+    const QStringList report = QString::fromUtf8(cli.readAllStandardError()).split('\n', Qt::SkipEmptyParts);
+    if (cli.exitStatus() != QProcess::NormalExit || cli.exitCode() != 0 || target.isEmpty()) {
+        run.ok = false;
+        run.lines << "Backup failed:";
+        for (const QString& line : report) run.lines << "  " + line;
+        return true;
+    }
+    emit progress("Backup", 1, 1, "verified");
+    run.lines << "Backup: " + target;
+    for (const QString& line : report) run.lines << "  " + line.trimmed();
+    return true;
+}
+
+} // namespace hinlibs
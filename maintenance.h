@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+class QSqlDatabase;
+
+namespace hinlibs {
+
+// Database upkeep for the SysAdmin window: ANALYZE, incremental VACUUM, WAL
+// checkpoint, integrity checks and online backups (in a hinlibs-cli process). Work runs on a thread of its own with its
+// own connection, split into short steps (one table, or pagesPerStep pages)
+// that each hold the write lock only briefly, with a pause between steps so
+// circulation on the main connection is never held up for long.
+//
+// Tasks run when triggered or on a schedule of their own. Progress and a summary are
+// reported through signals, delivered on the receiver's thread.
+class MaintenanceService : public QObject {
+    Q_OBJECT
+public:
+    enum Task {
+        Analyze           = 0x1,   // ANALYZE each table (sampled), then PRAGMA optimize
+        IncrementalVacuum = 0x2,   // return free pages to the file system
+        Checkpoint        = 0x4,   // fold the WAL back into the database
+        IntegrityCheck    = 0x8,   // PRAGMA quick_check, table by table
+        AllTasks          = 0xF,
+        Backup            = 0x10   // online copy by hinlibs-cli into the backup directory; not in AllTasks
+    };
+
+    explicit MaintenanceService(QString databasePath, QObject* parent = nullptr);
+    ~MaintenanceService() override;
+
+    bool start(QString* error = nullptr);
+    void stop();
+
+    // All thread-safe. A trigger while tasks are running is queued behind them.
+    void trigger(int tasks);
+    void setSchedule(int tasks, std::chrono::minutes every);   // every == 0 unschedules tasks
+    void cancel();                                            // abandons the current run
+    void setPagesPerStep(int pages) { pagesPerStep_ = pages > 0 ? pages : 1; }
+    void setPauseBetweenSteps(std::chrono::milliseconds pause) { pauseMs_ = static_cast<int>(pause.count()); }
+    // PRAGMA analysis_limit for Analyze: rows sampled per index, so one
+    // large table can't hold a step for seconds. 0 analyzes everything.
+    void setAnalysisLimit(int rows) { analysisLimit_ = rows > 0 ? rows : 0; }
+    // Where Backup writes, and how many backups to keep there.
+    void setBackupTarget(const QString& directory, int keep);
+
+    bool isBusy() const { return busy_; }
+
+signals:
+    void progress(const QString& task, int step, int steps, const QString& detail);
+    void finished(const QString& summary, bool ok);
+
+private:
+    struct Run;
+
+    void loop(std::promise<bool>* ready);
+    void runTasks(QSqlDatabase& db, int tasks);
+    bool pause();   // false when cancelled or stopping
+
+    bool analyze(QSqlDatabase& db, Run& run);
+    bool vacuum(QSqlDatabase& db, Run& run);
+    bool checkpoint(QSqlDatabase& db, Run& run);
+    bool integrityCheck(QSqlDatabase& db, Run& run);
+    bool backup(Run& run);
+
+    struct Schedule {
+        std::chrono::minutes interval{0};
+        std::chrono::steady_clock::time_point next;
+    };
+    static constexpr int kTaskCount = 5;
+    int dueTasks(std::chrono::steady_clock::time_point now) const;
+    std::chrono::steady_clock::time_point nextDue() const;
+
+    const QString path_;
+    const QString connection_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int requested_ = 0;
+    std::array<Schedule, kTaskCount> schedules_;   // one per Task bit
+    QString backupDir_;
+    int backupKeep_ = 7;
+    bool stopping_ = false;
+
+    std::atomic<bool> cancel_{false};
+    std::atomic<bool> busy_{false};
+    std::atomic<int> pagesPerStep_{64};
+    std::atomic<int> pauseMs_{50};
+    std::atomic<int> analysisLimit_{1000};
+};
+
+} // namespace hinlibs
@@ -5,6 +5,7 @@
 #include "librarian.h"
 #include "sysadminwindow.h"
 #include "sysadmin.h"
+#include "database.h"
 
 #include <QString>
 #include <QDebug>
@@ -93,7 +94,7 @@ void MainWindow::on_loginButton_clicked() {
 
         case hinlibs::Role::SysAdmin: {
             auto sysadmin = std::dynamic_pointer_cast<hinlibs::SysAdmin>(user);
-            auto home = new SysadminWindow(sysadmin->getUsername(), this);
+            auto home = new SysadminWindow(sysadmin->getUsername(), session->db()->DatabaseName(), this);
 
             connect(home, &SysadminWindow::logoutRequest, this, [this, home]() {
                 home->close();
@@ -0,0 +1,674 @@
+#include "oplog.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+#include <QtEndian>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace hinlibs {
+
+namespace {
+
+constexpr char kMagic[8] = { 'H', 'L', 'O', 'P', 'L', 'O', 'G', '\0' };
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kCheckpointFlag = 0x1;
+constexpr int kHeaderSize = 24;
+constexpr int kFrameHeadSize = 8;
+constexpr std::uint32_t kMaxPayload = 1 << 20;     // anything larger is damage
+
+std::uint32_t crc32(const char* data, std::size_t n) {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    std::uint32_t c = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < n; ++i) c = table[(c ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+template <class T>
+void put(QByteArray& out, T v) {
+    char b[sizeof(T)];
+    qToLittleEndian<T>(v, b);
+    out.append(b, static_cast<int>(sizeof(T)));
+}
+
+void putString(QByteArray& out, const std::string& s) {
+    const auto n = static_cast<std::uint16_t>(std::min<std::size_t>(s.size(), 0xFFFF));
+    put<std::uint16_t>(out, n);
+    out.append(s.data(), n);
+}
+
+// Bounds-checked reads from one payload.
+struct Cursor {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    template <class T>
+    T get() {
+        if (end - p < static_cast<std::ptrdiff_t>(sizeof(T))) { ok = false; return T(); }
+        const T v = qFromLittleEndian<T>(p);
+        p += sizeof(T);
+        return v;
+    }
+    std::string getString() {
+        const auto n = get<std::uint16_t>();
+        if (!ok || end - p < n) { ok = false; return std::string(); }
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+QByteArray header(std::uint32_t flags, std::uint64_t baseSeq) {
+    QByteArray h(kMagic, sizeof kMagic);
+    put<std::uint32_t>(h, kVersion);
+    put<std::uint32_t>(h, flags);
+    put<std::uint64_t>(h, baseSeq);
+    return h;
+}
+
+QByteArray frame(const OpRecord& r) {
+    QByteArray payload;
+    put<std::uint64_t>(payload, r.seq);
+    put<std::int64_t>(payload, r.atMs);
+    put<std::uint8_t>(payload, static_cast<std::uint8_t>(r.kind));
+    put<std::uint8_t>(payload, 0);
+    put<std::int64_t>(payload, r.value);
+    putString(payload, r.patronId);
+    putString(payload, r.itemId);
+    putString(payload, r.recordId);
+
+    QByteArray out;
+    out.reserve(kFrameHeadSize + payload.size());
+    put<std::uint32_t>(out, static_cast<std::uint32_t>(payload.size()));
+    put<std::uint32_t>(out, crc32(payload.constData(), static_cast<std::size_t>(payload.size())));
+    out.append(payload);
+    return out;
+}
+
+bool decode(const char* data, std::uint32_t length, OpRecord* record) {
+    Cursor c{ data, data + length };
+    OpRecord r;
+    r.seq = c.get<std::uint64_t>();
+    r.atMs = c.get<std::int64_t>();
+    r.kind = static_cast<OpKind>(c.get<std::uint8_t>());
+    c.get<std::uint8_t>();
+    r.value = c.get<std::int64_t>();
+    r.patronId = c.getString();
+    r.itemId = c.getString();
+    r.recordId = c.getString();
+    if (!c.ok) return false;
+    *record = std::move(r);
+    return true;
+}
+
+// Size of the intact frame at p, or 0.
+qint64 frameAt(const char* p, const char* end) {
+    if (end - p < kFrameHeadSize) return 0;
+    const auto length = qFromLittleEndian<std::uint32_t>(p);
+    const auto crc = qFromLittleEndian<std::uint32_t>(p + 4);
+    if (length > kMaxPayload || end - p - kFrameHeadSize < static_cast<qint64>(length)) return 0;
+    if (crc32(p + kFrameHeadSize, length) != crc) return 0;
+    OpRecord r;
+    return decode(p + kFrameHeadSize, length, &r) ? kFrameHeadSize + length : 0;
+}
+
+bool syncToDisk(QFile& f) {
+    if (!f.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(f.handle()) == 0;
+#else
+    return ::fsync(f.handle()) == 0;
+#endif
+}
+
+std::int64_t toMs(std::chrono::system_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point fromMs(std::int64_t ms) {
+    return std::chrono::system_clock::time_point{std::chrono::milliseconds(ms)};
+}
+
+// Same text form database.cpp stores.
+QString toIso(std::chrono::system_clock::time_point tp) {
+    const auto secs = std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count();
+    return QDateTime::fromSecsSinceEpoch(secs, Qt::UTC).toString(Qt::ISODate);
+}
+
+std::chrono::system_clock::time_point fromIso(const QString& iso) {
+    const QDateTime dt = QDateTime::fromString(iso, Qt::ISODate);
+    return std::chrono::system_clock::time_point{std::chrono::seconds(dt.toSecsSinceEpoch())};
+}
+
+} // namespace
+
+const char* OpKindName(OpKind kind) {
+    switch (kind) {
+        case OpKind::Checkout: return "checkout";
+        case OpKind::Return: return "return";
+        case OpKind::PlaceHold: return "hold";
+        case OpKind::CancelHold: return "cancel";
+        case OpKind::ItemAdded: return "add-item";
+        case OpKind::ItemRemoved: return "remove-item";
+        case OpKind::FinePaid: return "fine-paid";
+        case OpKind::FineWaived: return "fine-waived";
+        case OpKind::FineBalance: return "fine-balance";
+        case OpKind::FineCharged: return "fine-charged";
+    }
+    return "unknown";
+}
+
+// ----- Writer -----
+OpLogWriter::OpLogWriter(QString path, Options options)
+    : path_(std::move(path)), options_(options), lock_(path_ + ".lock") {
+    // Held for as long as the writer lives; only a dead owner makes it stale.
+    lock_.setStaleLockTime(0);
+}
+
+OpLogWriter::~OpLogWriter() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_.isOpen()) syncLocked();
+}
+
+bool OpLogWriter::open(QString* error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto fail = [error](const QString& why) {
+        if (error) *error = why;
+        return false;
+    };
+
+    // Two writers would hand out the same sequence numbers.
+    if (!lock_.isLocked() && !lock_.tryLock(0)) {
+        qint64 pid = 0;
+        QString host, app;
+        if (lock_.error() == QLockFile::LockFailedError && lock_.getLockInfo(&pid, &host, &app)) {
+            return fail(QString("%1 is open for writing by %2 (pid %3 on %4)").arg(path_, app).arg(pid).arg(host));
+        }
+        return fail(QString("Cannot lock %1 for writing").arg(path_));
+    }
+
+    if (QFile::exists(path_) && QFileInfo(path_).size() > 0) {
+        OpLogReader reader;
+        QString why;
+        if (!reader.open(path_, &why)) return fail(why);
+        if (reader.isCheckpoint()) return fail(path_ + " is a checkpoint, not a log");
+        lastSeq_ = reader.baseSequence();
+        OpRecord r;
+        while (reader.next(&r)) lastSeq_ = std::max(lastSeq_, r.seq);
+        if (reader.tornTail()) {
+            // A torn last append was never acknowledged and can go. Intact
+            // records past the damage mean corruption mid-log: keep them.
+            if (const std::uint64_t past = reader.recordsPastDamage()) {
+                return fail(QString("%1 is damaged at byte %2 with %3 intact records after it; "
+                                    "move it aside or recover it with oplog dump")
+                                .arg(path_).arg(reader.validBytes()).arg(past));
+            }
+            QFile torn(path_);
+            if (!torn.resize(reader.validBytes())) return fail("Cannot truncate torn record: " + torn.errorString());
+        }
+        file_.setFileName(path_);
+        if (!file_.open(QIODevice::WriteOnly | QIODevice::Append)) return fail(file_.errorString());
+    } else {
+        file_.setFileName(path_);
+        if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) return fail(file_.errorString());
+        const QByteArray h = header(0, 0);
+        if (file_.write(h) != h.size() || !syncToDisk(file_)) return fail(file_.errorString());
+    }
+    unsynced_ = 0;
+    sinceSync_.start();
+    return true;
+}
+
+std::uint64_t OpLogWriter::append(OpRecord record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.isOpen()) return 0;
+    record.seq = lastSeq_ + 1;
+    const QByteArray f = frame(record);
+    if (file_.write(f) != f.size() || !file_.flush()) return 0;
+    lastSeq_ = record.seq;
+
+    // Batched: the records in between are in the page cache, so they
+    // survive a crash of the app but not of the machine.
+    if (unsynced_++ == 0) sinceSync_.restart();
+    if (unsynced_ >= options_.syncEveryRecords || sinceSync_.elapsed() >= options_.syncInterval.count()) {
+        syncLocked();
+    }
+    return record.seq;
+}
+
+bool OpLogWriter::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return syncLocked();
+}
+
+bool OpLogWriter::syncLocked() {
+    if (!file_.isOpen()) return false;
+    if (unsynced_ == 0) return file_.flush();
+    unsynced_ = 0;
+    return syncToDisk(file_);
+}
+
+std::uint64_t OpLogWriter::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastSeq_;
+}
+
+// ----- Reader -----
+bool OpLogReader::open(const QString& path, QString* error) {
+    auto fail = [error](const QString& why) {
+        if (error) *error = why;
+        return false;
+    };
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly)) return fail(file_.errorString());
+
+    const QByteArray h = file_.read(kHeaderSize);
+    if (h.size() != kHeaderSize || std::memcmp(h.constData(), kMagic, sizeof kMagic) != 0)
+        return fail(path + " is not an operation log");
+    Cursor c{ h.constData() + sizeof kMagic, h.constData() + h.size() };
+    const auto version = c.get<std::uint32_t>();
+    const auto flags = c.get<std::uint32_t>();
+    baseSeq_ = c.get<std::uint64_t>();
+    if (version != kVersion) return fail(QString("Operation log version %1, expected %2").arg(version).arg(kVersion));
+    checkpoint_ = flags & kCheckpointFlag;
+    validBytes_ = kHeaderSize;
+    torn_ = false;
+    return true;
+}
+
+bool OpLogReader::next(OpRecord* record) {
+    if (!file_.isOpen() || torn_) return false;
+
+    const QByteArray head = file_.read(kFrameHeadSize);
+    if (head.isEmpty()) return false;   // clean end
+    torn_ = true;                       // until this frame checks out
+    if (head.size() != kFrameHeadSize) return false;
+
+    Cursor hc{ head.constData(), head.constData() + head.size() };
+    const auto length = hc.get<std::uint32_t>();
+    const auto crc = hc.get<std::uint32_t>();
+    if (length > kMaxPayload) return false;
+    const QByteArray payload = file_.read(length);
+    if (payload.size() != static_cast<int>(length)) return false;
+    if (crc32(payload.constData(), length) != crc) return false;
+
+    if (!decode(payload.constData(), length, record)) return false;
+
+    torn_ = false;
+    validBytes_ = file_.pos();
+    return true;
+}
+
+std::uint64_t OpLogReader::recordsPastDamage() {
+    if (!torn_ || !file_.isOpen() || !file_.seek(validBytes_)) return 0;
+    // Only read on this rare path: try every offset past the damaged frame
+    const QByteArray rest = file_.readAll();
+    const char* p = rest.constData() + 1;
+    const char* end = rest.constData() + rest.size();
+    std::uint64_t found = 0;
+    while (p < end) {
+        if (const qint64 size = frameAt(p, end)) {
+            ++found;
+            p += size;
+        } else {
+            ++p;
+        }
+    }
+    return found;
+}
+
+// ----- State -----
+bool CirculationState::apply(const OpRecord& r, std::string* problem) {
+    auto note = [&](const std::string& why) {
+        if (problem) *problem = "#" + std::to_string(r.seq) + " " + OpKindName(r.kind) + " " + r.itemId + ": " + why;
+        return false;
+    };
+    if (r.seq > seq) seq = r.seq;
+
+    switch (r.kind) {
+        case OpKind::Checkout: {
+            const bool clash = loans.count(r.itemId) > 0;
+            loans[r.itemId] = LoanSnapshot{ r.recordId, r.patronId, r.itemId, fromMs(r.atMs), fromMs(r.value) };
+            return clash ? note("item was already on loan") : true;
+        }
+        case OpKind::Return: {
+            auto it = loans.find(r.itemId);
+            if (it == loans.end()) return note("no open loan");
+            const bool other = it->second.patronId != r.patronId;
+            loans.erase(it);
+            if (r.value > 0) fines[r.patronId] += r.value;
+            return other ? note("loan belonged to another patron") : true;
+        }
+        case OpKind::PlaceHold: {
+            auto& queue = holds[r.itemId];
+            queue.push_back(HoldSnapshot{ r.recordId, r.patronId, r.itemId, queue.size() + 1 });
+            return static_cast<std::int64_t>(queue.size()) == r.value ? true : note("queue position differs");
+        }
+        case OpKind::CancelHold: {
+            auto q = holds.find(r.itemId);
+            if (q == holds.end()) return note("no holds on item");
+            auto& queue = q->second;
+            auto it = std::find_if(queue.begin(), queue.end(), [&r](const HoldSnapshot& h) {
+                return r.recordId.empty() ? h.patronId == r.patronId : h.id == r.recordId;
+            });
+            if (it == queue.end()) return note("no such hold");
+            queue.erase(it);
+            for (std::size_t i = 0; i < queue.size(); ++i) queue[i].queuePosition = i + 1;
+            if (queue.empty()) holds.erase(q);
+            return true;
+        }
+        case OpKind::ItemRemoved: {
+            const bool busy = loans.erase(r.itemId) + holds.erase(r.itemId) > 0;
+            return busy ? note("removed item still had loans or holds") : true;
+        }
+        case OpKind::ItemAdded:
+            return true;
+        case OpKind::FinePaid:
+        case OpKind::FineWaived: {
+            auto it = fines.find(r.patronId);
+            const std::int64_t owed = it == fines.end() ? 0 : it->second;
+            if (owed > r.value) {
+                it->second -= r.value;
+                return true;
+            }
+            if (it != fines.end()) fines.erase(it);
+            return owed == r.value ? true : note("more than " + r.patronId + " owed");
+        }
+        case OpKind::FineCharged:
+            if (r.value <= 0) return note("charge is not positive");
+            fines[r.patronId] += r.value;
+            return true;
+        case OpKind::FineBalance:
+            if (r.value != 0) fines[r.patronId] = r.value;
+            else fines.erase(r.patronId);
+            return true;
+    }
+    return note("unknown record kind");
+}
+
+// ----- Replay -----
+bool ReplayOpLog(const QString& checkpointPath, const QString& logPath,
+                 CirculationState* state, ReplayReport* report) {
+    ReplayReport out;
+    CirculationState s;
+    auto finish = [&](bool ok) {
+        if (state) *state = std::move(s);
+        if (report) *report = std::move(out);
+        return ok;
+    };
+    auto noteProblem = [&out](const std::string& why) {
+        if (out.problems.size() < 100) out.problems.push_back(why);
+    };
+
+    OpRecord r;
+    std::string problem;
+    if (!checkpointPath.isEmpty()) {
+        OpLogReader cp;
+        QString why;
+        if (!cp.open(checkpointPath, &why)) { out.error = why.toStdString(); return finish(false); }
+        if (!cp.isCheckpoint()) { out.error = checkpointPath.toStdString() + " is not a checkpoint"; return finish(false); }
+        while (cp.next(&r)) {
+            if (!s.apply(r, &problem)) noteProblem(problem);
+            ++out.checkpointRecords;
+        }
+        if (cp.tornTail()) { out.error = "Checkpoint is damaged"; return finish(false); }
+        s.seq = cp.baseSequence();
+    }
+
+    if (!logPath.isEmpty()) {
+        OpLogReader log;
+        QString why;
+        if (!log.open(logPath, &why)) { out.error = why.toStdString(); return finish(false); }
+        if (log.isCheckpoint()) { out.error = logPath.toStdString() + " is a checkpoint, not a log"; return finish(false); }
+        bool started = false;
+        while (log.next(&r)) {
+            if (!started && r.seq <= s.seq) { ++out.skipped; continue; }
+            started = true;
+            if (r.seq > s.seq + 1) {
+                noteProblem("records " + std::to_string(s.seq + 1) + ".." + std::to_string(r.seq - 1) + " are missing");
+            } else if (r.seq <= s.seq) {
+                // Still applied: it is a real change, but its order against
+                // the others can't be trusted.
+                noteProblem("#" + std::to_string(r.seq) + " follows #" + std::to_string(s.seq)
+                            + "; sequence numbers repeat (more than one writer?)");
+            }
+            if (!s.apply(r, &problem)) noteProblem(problem);
+            ++out.applied;
+        }
+        out.tornTail = log.tornTail();
+        if (out.tornTail) {
+            out.recordsPastDamage = log.recordsPastDamage();
+            if (out.recordsPastDamage > 0) {
+                noteProblem("log is damaged after #" + std::to_string(s.seq) + "; "
+                            + std::to_string(out.recordsPastDamage) + " intact records after it were not replayed");
+            }
+        }
+    }
+    return finish(true);
+}
+
+bool WriteOpLogCheckpoint(const QString& path, const CirculationState& state, QString* error) {
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        if (error) *error = out.errorString();
+        return false;
+    }
+    QByteArray buf = header(kCheckpointFlag, state.seq);
+    for (const auto& [item, loan] : state.loans) {
+        OpRecord r;
+        r.seq = state.seq;
+        r.kind = OpKind::Checkout;
+        r.atMs = toMs(loan.checkoutDate);
+        r.value = toMs(loan.dueDate);
+        r.patronId = loan.patronId;
+        r.itemId = item;
+        r.recordId = loan.id;
+        buf.append(frame(r));
+    }
+    for (const auto& [item, queue] : state.holds) {
+        for (const HoldSnapshot& h : queue) {
+            OpRecord r;
+            r.seq = state.seq;
+            r.kind = OpKind::PlaceHold;
+            r.value = static_cast<std::int64_t>(h.queuePosition);
+            r.patronId = h.patronId;
+            r.itemId = item;
+            r.recordId = h.id;
+            buf.append(frame(r));
+        }
+    }
+    for (const auto& [patron, cents] : state.fines) {
+        OpRecord r;
+        r.seq = state.seq;
+        r.kind = OpKind::FineBalance;
+        r.value = cents;
+        r.patronId = patron;
+        buf.append(frame(r));
+    }
+    if (out.write(buf) != buf.size() || !out.commit()) {
+        if (error) *error = out.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Reads the tables into *s inside the caller's transaction.
+static bool readTables(QSqlDatabase& db, CirculationState* s, QString* error) {
+    auto fail = [&](const QSqlQuery& q) {
+        if (error) *error = q.lastError().text();
+        return false;
+    };
+
+    QSqlQuery loans(db);
+    loans.setForwardOnly(true);
+    if (!loans.exec("SELECT id, patronId, itemId, checkoutDate, dueDate FROM loans")) return fail(loans);
+    while (loans.next()) {
+        const ItemId item = loans.value(2).toString().toStdString();
+        s->loans[item] = LoanSnapshot{ loans.value(0).toString().toStdString(), loans.value(1).toString().toStdString(),
+                                       item, fromIso(loans.value(3).toString()), fromIso(loans.value(4).toString()) };
+    }
+
+    QSqlQuery holds(db);
+    holds.setForwardOnly(true);
+    if (!holds.exec("SELECT id, patronId, itemId FROM holds ORDER BY itemId, queuePosition")) return fail(holds);
+    while (holds.next()) {
+        const ItemId item = holds.value(2).toString().toStdString();
+        auto& queue = s->holds[item];
+        queue.push_back(HoldSnapshot{ holds.value(0).toString().toStdString(),
+                                      holds.value(1).toString().toStdString(), item, queue.size() + 1 });
+    }
+
+    QSqlQuery fines(db);
+    fines.setForwardOnly(true);
+    if (!fines.exec("SELECT id, fineBalanceCents FROM users WHERE fineBalanceCents <> 0")) return fail(fines);
+    while (fines.next()) s->fines[fines.value(0).toString().toStdString()] = fines.value(1).toLongLong();
+    return true;
+}
+
+bool ReadCirculation(QSqlDatabase db, std::uint64_t seq, CirculationState* state, QString* error) {
+    CirculationState s;
+    s.seq = seq;
+    if (!db.transaction()) {
+        if (error) *error = db.lastError().text();
+        return false;
+    }
+    if (!readTables(db, &s, error)) {
+        db.rollback();
+        return false;
+    }
+    db.commit();
+    *state = std::move(s);
+    return true;
+}
+
+std::vector<std::string> UnexplainedCirculation(const CirculationState& live, const CirculationState& replayed) {
+    std::vector<std::string> out;
+    for (const auto& [item, l] : live.loans) {
+        const auto it = replayed.loans.find(item);
+        if (it == replayed.loans.end() || it->second.id != l.id) {
+            out.push_back("loan " + l.id + " of " + item + " to " + l.patronId + " is not in the log");
+        }
+    }
+    for (const auto& [item, queue] : live.holds) {
+        const auto it = replayed.holds.find(item);
+        for (const HoldSnapshot& h : queue) {
+            const bool known = it != replayed.holds.end()
+                && std::any_of(it->second.begin(), it->second.end(), [&](const HoldSnapshot& r) { return r.id == h.id; });
+            if (!known) out.push_back("hold " + h.id + " on " + item + " for " + h.patronId + " is not in the log");
+        }
+    }
+    for (const auto& [patron, cents] : live.fines) {
+        const auto it = replayed.fines.find(patron);
+        const std::int64_t logged = it == replayed.fines.end() ? 0 : it->second;
+        if (logged != cents) {
+            out.push_back("fine balance of " + patron + " is " + std::to_string(cents) + " cents, the log says "
+                          + std::to_string(logged));
+        }
+    }
+    return out;
+}
+
+bool RestoreCirculation(QSqlDatabase db, const CirculationState& state, QString* error) {
+    auto fail = [&](const QSqlQuery& q) {
+        if (error) *error = q.lastError().text();
+        db.rollback();
+        return false;
+    };
+    if (!db.transaction()) {
+        if (error) *error = db.lastError().text();
+        return false;
+    }
+
+    // A change committed just before a crash may never have reached the log;
+    // replacing the tables would silently undo it.
+    CirculationState live;
+    if (!readTables(db, &live, error)) {
+        db.rollback();
+        return false;
+    }
+    const std::vector<std::string> unexplained = UnexplainedCirculation(live, state);
+    if (!unexplained.empty()) {
+        db.rollback();
+        if (error) {
+            QStringList lines;
+            for (std::size_t i = 0; i < unexplained.size() && i < 10; ++i) lines << QString::fromStdString(unexplained[i]);
+            if (unexplained.size() > 10) lines << QString("... %1 more").arg(unexplained.size() - 10);
+            *error = QString("the database has %1 change(s) the log does not explain:\n  ").arg(unexplained.size())
+                     + lines.join("\n  ");
+        }
+        return false;
+    }
+
+    QSqlQuery q(db);
+    for (const char* sql : { "DELETE FROM holds", "DELETE FROM loans", "UPDATE items SET status='Available'",
+                             "UPDATE users SET fineBalanceCents = 0" }) {
+        if (!q.exec(sql)) return fail(q);
+    }
+
+    QSqlQuery loan(db);
+    loan.prepare("INSERT INTO loans (id, patronId, itemId, checkoutDate, dueDate) VALUES (?, ?, ?, ?, ?)");
+    QSqlQuery out(db);
+    out.prepare("UPDATE items SET status='CheckedOut' WHERE id=?");
+    for (const auto& [item, l] : state.loans) {
+        loan.addBindValue(QString::fromStdString(l.id));
+        loan.addBindValue(QString::fromStdString(l.patronId));
+        loan.addBindValue(QString::fromStdString(item));
+        loan.addBindValue(toIso(l.checkoutDate));
+        loan.addBindValue(toIso(l.dueDate));
+        if (!loan.exec()) return fail(loan);
+        out.addBindValue(QString::fromStdString(item));
+        if (!out.exec()) return fail(out);
+    }
+
+    QSqlQuery hold(db);
+    hold.prepare("INSERT INTO holds (id, patronId, itemId, queuePosition) VALUES (?, ?, ?, ?)");
+    for (const auto& [item, queue] : state.holds) {
+        for (const HoldSnapshot& h : queue) {
+            hold.addBindValue(QString::fromStdString(h.id));
+            hold.addBindValue(QString::fromStdString(h.patronId));
+            hold.addBindValue(QString::fromStdString(item));
+            hold.addBindValue(static_cast<qulonglong>(h.queuePosition));
+            if (!hold.exec()) return fail(hold);
+        }
+    }
+
+    QSqlQuery fine(db);
+    fine.prepare("UPDATE users SET fineBalanceCents = ? WHERE id = ?");
+    for (const auto& [patron, cents] : state.fines) {
+        fine.addBindValue(static_cast<qlonglong>(cents));
+        fine.addBindValue(QString::fromStdString(patron));
+        if (!fine.exec()) return fail(fine);
+    }
+
+    if (!db.commit()) {
+        if (error) *error = db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+} // namespace hinlibs
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLockFile>
+#include <QSqlDatabase>
+#include <QString>
+
+namespace hinlibs {
+
+// Append-only log of committed circulation changes, for audit, recovery
+// and analytics without touching the live tables.
+//
+//   Header      "HLOPLOG\0", version, flags, baseSequence (24 bytes)
+//   Frame*      u32 payload length, u32 CRC-32 of payload, payload
+//
+// A payload is seq (u64), atMs (i64), kind (u8), one reserved byte, value
+// (i64), then patronId, itemId and recordId as u16-length UTF-8. Integers
+// are little-endian. A frame cut short by a crash fails its length or CRC
+// check; readers stop there and the writer truncates it on open, unless
+// intact frames follow it (damage mid-log), in which case it refuses to open.
+//
+// A checkpoint is a file in the same format with the Checkpoint flag set:
+// one Checkout per open loan, one PlaceHold per hold, in queue order, and
+// one FineBalance per patron who owes, standing for the state after
+// baseSequence.
+enum class OpKind : std::uint8_t {
+    Checkout = 1,       // recordId: loan id, value: due date (ms since epoch)
+    Return = 2,         // value: fine added to the patron's balance (cents)
+    PlaceHold = 3,      // recordId: hold id, value: queue position
+    CancelHold = 4,     // recordId: hold id, value: position it had
+    ItemAdded = 5,
+    ItemRemoved = 6,
+    FinePaid = 7,       // value: cents taken off the balance
+    FineWaived = 8,     // value: cents taken off the balance
+    FineBalance = 9,    // checkpoints only; value: the patron's balance
+    FineCharged = 10    // recordId: the branch fine's reference, value: cents added
+};
+
+struct OpRecord {
+    std::uint64_t seq = 0;
+    std::int64_t atMs = 0;
+    OpKind kind = OpKind::Checkout;
+    PatronId patronId;
+    ItemId itemId;
+    std::string recordId;
+    std::int64_t value = 0;
+};
+
+const char* OpKindName(OpKind kind);
+
+class OpLogWriter {
+public:
+    struct Options {
+        // fsync once this many records are unsynced, or once the oldest
+        // unsynced record is this old (checked on append), whichever is first.
+        int syncEveryRecords = 64;
+        std::chrono::milliseconds syncInterval{100};
+    };
+
+    explicit OpLogWriter(QString path) : OpLogWriter(std::move(path), Options{}) {}
+    OpLogWriter(QString path, Options options);
+    ~OpLogWriter();
+
+    // Creates the log, or checks an existing one, drops a torn last frame
+    // and continues its sequence. Fails, touching nothing, when intact
+    // records follow a damaged frame, or when another writer (in any
+    // process) has the log open: the writer holds "<path>.lock" until it is
+    // destroyed.
+    bool open(QString* error = nullptr);
+
+    // Stamps record.seq and appends it. Thread-safe. Returns the sequence
+    // number, or 0 when the write failed.
+    std::uint64_t append(OpRecord record);
+
+    // Forces everything appended so far to disk.
+    bool sync();
+
+    std::uint64_t lastSequence() const;
+    const QString& path() const { return path_; }
+
+private:
+    bool syncLocked();
+
+    const QString path_;
+    const Options options_;
+    mutable std::mutex mutex_;
+    QLockFile lock_;
+    QFile file_;
+    std::uint64_t lastSeq_ = 0;
+    int unsynced_ = 0;
+    QElapsedTimer sinceSync_;
+};
+
+class OpLogReader {
+public:
+    bool open(const QString& path, QString* error = nullptr);
+    // False at the end of the log or at the first damaged frame.
+    bool next(OpRecord* record);
+
+    bool isCheckpoint() const { return checkpoint_; }
+    std::uint64_t baseSequence() const { return baseSeq_; }
+    // After next() has returned false: the log ended in a damaged frame.
+    bool tornTail() const { return torn_; }
+    // Bytes up to the end of the last good frame.
+    qint64 validBytes() const { return validBytes_; }
+    // After a torn tail: intact frames found further on by scanning every
+    // offset past the damage. Nonzero means the log was damaged mid-way,
+    // not cut short.
+    std::uint64_t recordsPastDamage();
+
+private:
+    QFile file_;
+    bool checkpoint_ = false;
+    std::uint64_t baseSeq_ = 0;
+    bool torn_ = false;
+    qint64 validBytes_ = 0;
+};
+
+// Loans, holds and fine balances as the log describes them.
+struct CirculationState {
+    std::uint64_t seq = 0;                              // last record applied
+    std::map<ItemId, LoanSnapshot> loans;               // one per item
+    std::map<ItemId, std::vector<HoldSnapshot>> holds;  // queue order
+    std::map<PatronId, std::int64_t> fines;             // settled balances, nonzero only
+
+    // Applies one record. Returns false (the state still moves on) when it
+    // does not fit, e.g. a return with no loan; *problem says why.
+    bool apply(const OpRecord& record, std::string* problem = nullptr);
+};
+
+struct ReplayReport {
+    std::uint64_t checkpointRecords = 0;
+    std::uint64_t applied = 0;
+    std::uint64_t skipped = 0;          // leading records at or before the checkpoint
+    std::vector<std::string> problems;  // first 100
+    bool tornTail = false;
+    std::uint64_t recordsPastDamage = 0;   // also listed in problems
+    std::string error;
+};
+
+// Loads checkpointPath (may be empty), then applies every record in logPath
+// after the checkpoint's sequence. Past that point sequence numbers must
+// rise by one per record; a gap, or one that repeats or goes back (two
+// writers on one log), is reported as a problem.
+bool ReplayOpLog(const QString& checkpointPath, const QString& logPath,
+                 CirculationState* state, ReplayReport* report);
+
+// Writes state as a checkpoint file (temporary file + rename).
+bool WriteOpLogCheckpoint(const QString& path, const CirculationState& state, QString* error = nullptr);
+
+// The loans and holds tables and the patrons' fine balances, read in one
+// transaction, as a state standing for the log up to seq. Written as a checkpoint, it lets a log be replayed
+// on top of a database whose circulation predates the log.
+bool ReadCirculation(QSqlDatabase db, std::uint64_t seq, CirculationState* state, QString* error = nullptr);
+
+// What live has that replayed can't account for: loans and holds missing
+// from replayed (by id), and fine balances that differ. Rows only in
+// replayed are what a restore puts back, and are not listed.
+std::vector<std::string> UnexplainedCirculation(const CirculationState& live, const CirculationState& replayed);
+
+// Replaces the loans and holds tables and every fine balance with state,
+// and sets every item's status to match, in one transaction. Everything not in state is lost, so
+// only apply a replay that reported no problems. Refuses, changing nothing,
+// when the live tables hold anything UnexplainedCirculation lists, e.g. a
+// change committed just before a crash that never reached the log.
+bool RestoreCirculation(QSqlDatabase db, const CirculationState& state, QString* error = nullptr);
+
+} // namespace hinlibs
@@ -9,56 +9,27 @@
 
 namespace hinlibs {
 
-namespace {
-
-// Validate that this user exists and is a Patron.
-inline std::optional<std::string> ValidatePatron(std::shared_ptr<Database> db,
-                                                 const PatronId& id) {
-    if (!db) return std::optional<std::string>{"No database handle"};
-    auto rec = db->GetUserById(id);
-    if (!rec) return std::optional<std::string>{"User not found"};
-    if (rec->role != Role::Patron) return std::optional<std::string>{"User is not a patron"};
-    return std::nullopt;
-}
-
-// Find an active loan (owned by patron) for a given item, if any.
-inline std::optional<LoanSnapshot>
-FindOwnedLoanForItem(std::shared_ptr<Database> db,
-                     const PatronId& patronId,
-                     const ItemId& itemId) {
-    auto loans = db->GetPatronActiveLoans(patronId);
-    for (const auto& l : loans) {
-        if (l.itemId == itemId) return l;
-    }
-    return std::nullopt;
-}
-
-// Find an active hold (owned by patron) for a given item, if any.
-inline std::optional<HoldSnapshot>
-FindOwnedHoldForItem(std::shared_ptr<Database> db,
-                     const PatronId& patronId,
-                     const ItemId& itemId) {
-    auto holds = db->GetPatronActiveHolds(patronId);
-    for (const auto& h : holds) {
-        if (h.itemId == itemId) return h;
-    }
-    return std::nullopt;
-}
-
-} // namespace
-
 // -------------------------------
 // Patron interface implementation
 // -------------------------------
+std::optional<std::string> Patron::validate() const {
+    if (!db_) return std::optional<std::string>{"No database handle"};
+    auto ident = identity();
+    if (!ident) return std::optional<std::string>{"User not found"};
+    if (ident->user.role != Role::Patron) return std::optional<std::string>{"User is not a patron"};
+    return std::nullopt;
+}
+
 std::string Patron::getUsername() const {
-    return db_->GetUserById(id_)->username;
+    auto ident = identity();
+    return ident ? ident->user.username : std::string{};
 }
 
 std::vector<ItemDetails> Patron::browseCatalogue() const {
     std::vector<ItemDetails> out;
 
     // Verify patron exists
-    if (auto err = ValidatePatron(db_, id_)) {
+    if (auto err = validate()) {
         // On identity failure, return empty; UI can show an error elsewhere if desired.
         return out;
     }
@@ -81,7 +52,7 @@ std::vector<ItemDetails> Patron::browseCatalogueAll() const {
     std::vector<ItemDetails> out;
 
     // Reuse the same identity check helper we already have
-    if (auto err = ValidatePatron(db_, id_)) {
+    if (auto err = validate()) {
         return out; // invalid user -> empty list
     }
 
@@ -98,137 +69,83 @@ std::vector<ItemDetails> Patron::browseCatalogueAll() const {
     return out;
 }
 
+std::optional<std::vector<ItemSummary>> Patron::browseCatalogueSnapshot(bool all) const {
+    if (validate()) return std::nullopt;
+    return db_->GetSnapshotCatalogue(!all);
+}
+
 
 ValueResult<std::shared_ptr<Loan>> Patron::borrowItem(const ItemId& itemId) {
     ValueResult<std::shared_ptr<Loan>> res;
 
-    if (auto err = ValidatePatron(db_, id_)) {
+    if (auto err = validate()) {
         res.ok = false; res.message = *err; return res;
     }
 
-    auto current = db_->GetActiveLoanCount(id_);
-    if (current >= db_->MaxActiveLoansPerPatron()) {
-        res.ok = false; res.message = "Loan limit reached"; return res;
-    }
-
-    auto summary = db_->GetItemSummary(itemId);
-    if (!summary) { res.ok = false; res.message = "Item not found"; return res; }
-    if (summary->status != ItemStatus::Available) {
-        res.ok = false; res.message = "Item is not available"; return res;
-    }
-
+    // Loan limit and availability are checked inside the checkout transaction.
     auto loanRes = db_->CheckoutItem(id_, itemId);
     if (!loanRes.ok || !loanRes.value) {
-        res.ok = false; res.message = loanRes.message.empty() ? "Checkout failed" : loanRes.message;
+        res.ok = false;
+        res.error = loanRes.error;
+        res.message = loanRes.message.empty() ? "Checkout failed" : loanRes.message;
         return res;
     }
 
-    // Wrap snapshot id into a Loan interface
+    // Wrap the snapshot into a Loan interface; it keeps it, so no re-read
     res.ok = true;
     res.message.clear();
-    res.value = std::make_shared<Loan>(db_, loanRes.value->id);
+    res.value = std::make_shared<Loan>(db_, std::move(*loanRes.value));
     return res;
 }
 
 OperationResult Patron::returnItem(const ItemId& itemId) {
-    OperationResult r;
-
     // Verify patron exists
-    if (auto err = ValidatePatron(db_, id_)) {
+    if (auto err = validate()) {
+        OperationResult r;
         r.ok = false; r.message = *err; return r;
     }
 
-    // Must have an active loan for this item
-    auto owned = FindOwnedLoanForItem(db_, id_, itemId);
-    if (!owned) {
-        r.ok = false; r.message = "No active loan for this item by this patron";
-        return r;
-    }
-
-    // Atomic return
-    auto dbres = db_->ReturnItem(id_, itemId);
-    if (!dbres.ok) return dbres;
-
-    r.ok = true; r.message.clear();
-    return r;
+    // Atomic return; fails with LoanNotFound if this patron doesn't have the item
+    return db_->ReturnItem(id_, itemId);
 }
 
 ValueResult<std::size_t> Patron::placeHold(const ItemId& itemId) {
     ValueResult<std::size_t> out;
 
     // Verify patron exists
-    if (auto err = ValidatePatron(db_, id_)) {
+    if (auto err = validate()) {
         out.ok = false; out.message = *err; return out;
     }
 
-    // Item existence
-    auto summary = db_->GetItemSummary(itemId);
-    if (!summary) {
-        out.ok = false; out.message = "Item not found";
-        return out;
-    }
-
-    // Allowed only when item is NOT available
-    if (summary->status == ItemStatus::Available) {
-        out.ok = false; out.message = "Cannot place a hold on an available item";
-        return out;
-    }
-
-    // Optional: avoid duplicate holds (DB.PlaceHold is idempotent per our impl, but we can fast-path)
-    if (FindOwnedHoldForItem(db_, id_, itemId)) {
-        // Return current position via DB to keep source of truth
-        auto queue = db_->GetHoldQueueForItem(itemId);
-        for (const auto& h : queue) {
-            if (h.patronId == id_) {
-                out.ok = true;
-                out.value = h.queuePosition;
-                out.message = "Hold already exists";
-                return out;
-            }
-        }
-        // Fallback if not found in queue map (should not happen):
-        out.ok = false; out.message = "Hold state inconsistent";
-        return out;
-    }
-
-    // Place hold
     auto posRes = db_->PlaceHold(id_, itemId);
+
     if (!posRes.ok || !posRes.value) {
-        out.ok = false; out.message = posRes.message.empty() ? "Failed to place hold" : posRes.message;
+        out.ok = false;
+        out.error = posRes.error;
+        out.message = posRes.message.empty() ? "Failed to place hold" : posRes.message;
         return out;
     }
 
     out.ok = true;
     out.value = *posRes.value;
-    out.message.clear();
+    out.message = posRes.message;   // "Hold already exists" on a repeat request
     return out;
 }
 
 OperationResult Patron::cancelHold(const ItemId& itemId) {
-    OperationResult r;
-
     // Verify patron exists
-    if (auto err = ValidatePatron(db_, id_)) {
+    if (auto err = validate()) {
+        OperationResult r;
         r.ok = false; r.message = *err; return r;
     }
 
-    // Ensure there is a hold owned by this patron for this item
-    if (!FindOwnedHoldForItem(db_, id_, itemId)) {
-        r.ok = false; r.message = "No hold for this item by this patron";
-        return r;
-    }
-
-    // Cancel via DB (also re-numbers queue)
-    auto dbres = db_->CancelHold(id_, itemId);
-    if (!dbres.ok) return dbres;
-
-    r.ok = true; r.message.clear();
-    return r;
+    // Cancel via DB (checks ownership and re-numbers the queue)
+    return db_->CancelHold(id_, itemId);
 }
 
 AccountStatusView Patron::viewAccountStatus() const {
     // If patron invalid, return empty view (UI can choose to show an error elsewhere)
-    if (auto err = ValidatePatron(db_, id_)) {
+    if (auto err = validate()) {
         return AccountStatusView{};
     }
     return db_->GetPatronAccountStatus(id_);
@@ -237,20 +154,25 @@ AccountStatusView Patron::viewAccountStatus() const {
 // ---- Non-state-altering helpers ----
 
 std::size_t Patron::activeLoanCount() const {
-    if (auto err = ValidatePatron(db_, id_)) return 0;
+    if (auto err = validate()) return 0;
     return db_->GetActiveLoanCount(id_);
 }
 
 std::vector<LoanSnapshot> Patron::activeLoans() const {
-    if (auto err = ValidatePatron(db_, id_)) return {};
+    if (auto err = validate()) return {};
     return db_->GetPatronActiveLoans(id_);
 }
 
 std::vector<HoldSnapshot> Patron::activeHolds() const {
-    if (auto err = ValidatePatron(db_, id_)) return {};
+    if (auto err = validate()) return {};
     return db_->GetPatronActiveHolds(id_);
 }
 
+PatronDashboard Patron::dashboard() const {
+    if (auto err = validate()) return {};
+    return db_->GetPatronDashboard(id_);
+}
+
 std::optional<hinlibs::ItemDetails> Patron::getItemDetails(ItemId itemId)
 {
     return db_->GetItemDetails(itemId);
@@ -13,11 +13,15 @@ class Patron : public User {
 public:
     // Constructor
     Patron(std::shared_ptr<Database> db, PatronId id) : User(std::move(db), std::move(id)) {}
+    Patron(std::shared_ptr<Database> db, IdentityToken identity) : User(std::move(db), std::move(identity)) {}
     Role role() const override { return Role::Patron; }
 
     // Functions
     std::vector<ItemDetails> browseCatalogue() const;
     std::vector<ItemDetails> browseCatalogueAll() const;
+    // Summaries from the startup snapshot, for a first render before SQLite
+    // is queried; nullopt once the catalogue has changed or without one.
+    std::optional<std::vector<ItemSummary>> browseCatalogueSnapshot(bool all) const;
     ValueResult<std::shared_ptr<Loan>> borrowItem(const ItemId& itemId);
     OperationResult returnItem(const ItemId& itemId);
     ValueResult<std::size_t> placeHold(const ItemId& itemId);
@@ -26,9 +30,14 @@ public:
     std::size_t activeLoanCount() const;
     std::vector<LoanSnapshot> activeLoans() const;
     std::vector<HoldSnapshot> activeHolds() const;
+    PatronDashboard dashboard() const;
     std::string getUsername() const;
     std::optional<hinlibs::ItemDetails> getItemDetails(ItemId itemId);
 
+private:
+    // Confirms this user exists and is a Patron, using the cached identity.
+    std::optional<std::string> validate() const;
+
 };
 
 }
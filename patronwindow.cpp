@@ -4,6 +4,8 @@
 #include <QString>
 #include <string>
 #include "types.h"
+#include "loan.h"
+#include <chrono>
 
 
 std::string statusToString(hinlibs::ItemStatus status) {
@@ -37,7 +39,14 @@ void PatronWindow::on_borrowButton_clicked() {
     auto result = patron_->borrowItem(itemId);
     ui->outputArea->clear();
     if (result.ok) {
-        ui->outputArea->append("Item borrowed successfully. Due in 14 days.");
+        // The Loan carries the checkout snapshot, so this is not a query
+        const auto loan = result.value ? (*result.value)->snapshot() : std::nullopt;
+        if (loan) {
+            const auto days = std::chrono::duration_cast<std::chrono::hours>(loan->dueDate - loan->checkoutDate).count() / 24;
+            ui->outputArea->append(QString("Item borrowed successfully. Due in %1 days.").arg(days));
+        } else {
+            ui->outputArea->append("Item borrowed successfully.");
+        }
     } else {
         ui->outputArea->append(QString::fromStdString("Borrow failed: " + result.message));
     }
@@ -80,11 +89,15 @@ void PatronWindow::on_accountStatusButton_clicked() {
     ui->outputArea->clear();
     auto status = patron_->viewAccountStatus();
 
+    auto money = [](std::int64_t cents) { return QString("$%1").arg(cents / 100.0, 0, 'f', 2); };
+
     ui->outputArea->append("Active Loans:");
     for (const auto& loan : status.loans) {
-        ui->outputArea->append(QString::fromStdString(
+        QString line = QString::fromStdString(
             loan.itemTitle + " — Due in " + std::to_string(loan.daysRemaining) + " days"
-        ));
+        );
+        if (loan.fineCents > 0) line += " — Fine so far: " + money(loan.fineCents);
+        ui->outputArea->append(line);
     }
 
     ui->outputArea->append("\nActive Holds:");
@@ -93,6 +106,11 @@ void PatronWindow::on_accountStatusButton_clicked() {
             hold.itemTitle + " — Queue position: " + std::to_string(hold.queuePosition)
         ));
     }
+
+    ui->outputArea->append("\nFines owed: " + money(status.fineBalanceCents));
+    if (status.fineLimitCents && status.fineBalanceCents > *status.fineLimitCents) {
+        ui->outputArea->append("Borrowing is blocked until fines are at or below " + money(*status.fineLimitCents) + ".");
+    }
 }
 
 void PatronWindow::on_logoutButton_clicked() {
@@ -0,0 +1,128 @@
+#include "querystats.h"
+
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace hinlibs {
+
+static std::size_t bucketFor(std::uint64_t elapsedNs) {
+    std::uint64_t us = elapsedNs / 1000;
+    std::size_t bucket = 0;
+    while (us > 0 && bucket + 1 < StatementStats::kBuckets) {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void QueryStats::setSlowQueryThreshold(std::chrono::microseconds threshold) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slowThreshold_ = threshold;
+}
+
+std::chrono::microseconds QueryStats::slowQueryThreshold() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slowThreshold_;
+}
+
+void QueryStats::recordStatement(const QString& sql, std::uint64_t elapsedNs, long long rows, bool ok) {
+    // Prepared SQL spans several lines in database.cpp; key on the collapsed text.
+    const QString key = sql.simplified();
+    bool slow = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& s = statements_[key.toStdString()];
+        ++s.count;
+        ++totalStatements_;
+        if (!ok) ++s.errors;
+        if (rows > 0) s.rowsReturned += static_cast<std::uint64_t>(rows);
+        s.totalNs += elapsedNs;
+        if (elapsedNs > s.maxNs) s.maxNs = elapsedNs;
+        ++s.histogram[bucketFor(elapsedNs)];
+        slow = slowThreshold_.count() > 0
+               && elapsedNs >= static_cast<std::uint64_t>(slowThreshold_.count()) * 1000;
+    }
+    if (slow) {
+        qWarning().noquote() << QString("Slow query (%1 ms):").arg(elapsedNs / 1.0e6, 0, 'f', 2) << key;
+    }
+}
+
+void QueryStats::recordLockWait(std::uint64_t elapsedNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lockWaitNs_ += elapsedNs;
+    ++lockWaits_;
+}
+
+void QueryStats::recordBusy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++busyCount_;
+}
+
+std::uint64_t QueryStats::statementCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalStatements_;
+}
+
+std::uint64_t QueryStats::lockWaitNs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lockWaitNs_;
+}
+
+std::uint64_t QueryStats::busyCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return busyCount_;
+}
+
+std::map<std::string, StatementStats> QueryStats::statements() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statements_;
+}
+
+void QueryStats::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statements_.clear();
+    totalStatements_ = 0;
+    lockWaitNs_ = 0;
+    lockWaits_ = 0;
+    busyCount_ = 0;
+}
+
+QByteArray QueryStats::toJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    QJsonArray statements;
+    for (const auto& [sql, s] : statements_) {
+        QJsonArray histogram;
+        for (std::size_t i = 0; i < s.histogram.size(); ++i) {
+            if (s.histogram[i] == 0) continue;
+            QJsonObject bucket;
+            bucket["ltUs"] = static_cast<qint64>(1) << i;
+            bucket["count"] = static_cast<qint64>(s.histogram[i]);
+            histogram.append(bucket);
+        }
+
+        QJsonObject o;
+        o["sql"] = QString::fromStdString(sql);
+        o["count"] = static_cast<qint64>(s.count);
+        o["errors"] = static_cast<qint64>(s.errors);
+        o["rowsReturned"] = static_cast<qint64>(s.rowsReturned);
+        o["totalMs"] = s.totalNs / 1.0e6;
+        o["meanUs"] = s.count ? (s.totalNs / 1.0e3) / s.count : 0.0;
+        o["maxUs"] = s.maxNs / 1.0e3;
+        o["latencyHistogram"] = histogram;
+        statements.append(o);
+    }
+
+    QJsonObject root;
+    root["statementCount"] = static_cast<qint64>(totalStatements_);
+    root["lockWaitMs"] = lockWaitNs_ / 1.0e6;
+    root["lockWaits"] = static_cast<qint64>(lockWaits_);
+    root["busyErrors"] = static_cast<qint64>(busyCount_);
+    root["slowQueryThresholdUs"] = static_cast<qint64>(slowThreshold_.count());
+    root["statements"] = statements;
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+} // namespace hinlibs
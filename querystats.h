@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <QByteArray>
+#include <QString>
+
+namespace hinlibs {
+
+// Per-statement counters collected by Database::exec().
+struct StatementStats {
+    // Bucket i counts executions that took < 2^i microseconds; the last
+    // bucket also takes everything slower.
+    static constexpr std::size_t kBuckets = 22;   // up to ~2 s
+
+    std::uint64_t count = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t rowsReturned = 0;
+    std::uint64_t totalNs = 0;
+    std::uint64_t maxNs = 0;
+    std::array<std::uint64_t, kBuckets> histogram{};
+};
+
+// Query instrumentation for one Database connection: statement counts,
+// latency histograms, rows returned, time spent waiting for the database
+// lock, and a slow-query log. Safe to read from another thread.
+class QueryStats {
+public:
+    QueryStats() = default;
+    QueryStats(const QueryStats&) = delete;
+    QueryStats& operator=(const QueryStats&) = delete;
+
+    // Statements slower than this are logged with qWarning(). Zero disables.
+    void setSlowQueryThreshold(std::chrono::microseconds threshold);
+    std::chrono::microseconds slowQueryThreshold() const;
+
+    // Off by default. When on, Database::exec walks each scrollable SELECT's
+    // result once to count its rows, which fetches the whole result before
+    // the caller reads any of it; the walk is not counted as latency.
+    void setCountRows(bool on) { countRows_.store(on, std::memory_order_relaxed); }
+    bool countRows() const { return countRows_.load(std::memory_order_relaxed); }
+
+    // `rows` < 0 means the row count is unknown (counting off, forward-only
+    // queries, DML).
+    void recordStatement(const QString& sql, std::uint64_t elapsedNs, long long rows, bool ok);
+    // Time spent blocked acquiring or releasing a transaction (BEGIN/COMMIT).
+    void recordLockWait(std::uint64_t elapsedNs);
+    // A statement or commit that failed with SQLITE_BUSY/SQLITE_LOCKED.
+    void recordBusy();
+
+    std::uint64_t statementCount() const;
+    std::uint64_t lockWaitNs() const;
+    std::uint64_t busyCount() const;
+    std::map<std::string, StatementStats> statements() const;
+
+    void reset();
+
+    // Snapshot of everything above as a JSON document.
+    QByteArray toJson() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, StatementStats> statements_;
+    std::uint64_t totalStatements_ = 0;
+    std::uint64_t lockWaitNs_ = 0;
+    std::uint64_t lockWaits_ = 0;
+    std::uint64_t busyCount_ = 0;
+    std::chrono::microseconds slowThreshold_{50000};
+    std::atomic<bool> countRows_{false};
+};
+
+} // namespace hinlibs
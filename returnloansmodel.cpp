@@ -0,0 +1,87 @@
+#include "returnloansmodel.h"
+
+#include <QDateTime>
+#include <chrono>
+
+ReturnLoansModel::ReturnLoansModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+int ReturnLoansModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(loans_.size());
+}
+
+int ReturnLoansModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ReturnLoansModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole) return QVariant();
+    const auto *loan = loanAt(index.row());
+    if (!loan) return QVariant();
+
+    switch (index.column()) {
+    case ItemIdColumn:
+        return QString::fromStdString(loan->itemId);
+    case TitleColumn:
+        return QString::fromStdString(loan->itemTitle);
+    case FormatColumn:
+        switch (loan->itemFormat) {
+        case hinlibs::ItemFormat::Book:      return QStringLiteral("Book");
+        case hinlibs::ItemFormat::Magazine:  return QStringLiteral("Magazine");
+        case hinlibs::ItemFormat::Movie:     return QStringLiteral("Movie");
+        case hinlibs::ItemFormat::VideoGame: return QStringLiteral("Video game");
+        }
+        return QStringLiteral("Unknown");
+    case DueDateColumn: {
+        using namespace std::chrono;
+        const auto secs = time_point_cast<seconds>(loan->dueDate).time_since_epoch().count();
+        return QDateTime::fromSecsSinceEpoch(secs, Qt::LocalTime).toString("yyyy-MM-dd");
+    }
+    }
+    return QVariant();
+}
+
+QVariant ReturnLoansModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) return QVariant();
+    switch (section) {
+    case ItemIdColumn:  return tr("Item ID");
+    case TitleColumn:   return tr("Title");
+    case FormatColumn:  return tr("Format");
+    case DueDateColumn: return tr("Due date");
+    }
+    return QVariant();
+}
+
+void ReturnLoansModel::setLoans(std::vector<hinlibs::LoanSnapshotWithItem> loans)
+{
+    beginResetModel();
+    loans_ = std::move(loans);
+    endResetModel();
+}
+
+void ReturnLoansModel::clear()
+{
+    setLoans({});
+}
+
+const hinlibs::LoanSnapshotWithItem *ReturnLoansModel::loanAt(int row) const
+{
+    if (row < 0 || row >= static_cast<int>(loans_.size())) return nullptr;
+    return &loans_[static_cast<std::size_t>(row)];
+}
+
+bool ReturnLoansModel::removeItem(const hinlibs::ItemId &itemId)
+{
+    for (std::size_t i = 0; i < loans_.size(); ++i) {
+        if (loans_[i].itemId != itemId) continue;
+        const int row = static_cast<int>(i);
+        beginRemoveRows(QModelIndex(), row, row);
+        loans_.erase(loans_.begin() + static_cast<std::ptrdiff_t>(i));
+        endRemoveRows();
+        return true;
+    }
+    return false;
+}
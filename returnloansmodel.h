@@ -0,0 +1,36 @@
+#ifndef RETURNLOANSMODEL_H
+#define RETURNLOANSMODEL_H
+
+#include <QAbstractTableModel>
+#include <vector>
+#include "types.h"
+
+// Rows for the librarian's return page: one per loan, with the item's title
+// and format already joined in. Returned loans are removed in place.
+class ReturnLoansModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { ItemIdColumn, TitleColumn, FormatColumn, DueDateColumn, ColumnCount };
+
+    explicit ReturnLoansModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void setLoans(std::vector<hinlibs::LoanSnapshotWithItem> loans);
+    void clear();
+
+    // nullptr when row is out of range
+    const hinlibs::LoanSnapshotWithItem *loanAt(int row) const;
+    // Removes the row for itemId, if present. Returns whether one was removed.
+    bool removeItem(const hinlibs::ItemId &itemId);
+
+private:
+    std::vector<hinlibs::LoanSnapshotWithItem> loans_;
+};
+
+#endif // RETURNLOANSMODEL_H
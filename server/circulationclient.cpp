@@ -0,0 +1,41 @@
+#include "circulationclient.h"
+
+#include "protocol.h"
+
+#include <QJsonDocument>
+
+namespace hinlibs {
+
+bool CirculationClient::connectTo(const QString& name, int timeoutMs) {
+    socket_.connectToServer(name);
+    return socket_.waitForConnected(timeoutMs);
+}
+
+std::uint64_t CirculationClient::send(QJsonObject request) {
+    const std::uint64_t id = nextId_++;
+    request["id"] = static_cast<qint64>(id);
+    socket_.write(service::Frame(request));
+    return id;
+}
+
+std::optional<QJsonObject> CirculationClient::receive(int timeoutMs) {
+    socket_.flush();
+    int nl;
+    while ((nl = inbox_.indexOf('\n')) < 0) {
+        if (!socket_.waitForReadyRead(timeoutMs)) return std::nullopt;
+        inbox_.append(socket_.readAll());
+    }
+    const QByteArray line = inbox_.left(nl);
+    inbox_.remove(0, nl + 1);
+
+    const QJsonDocument doc = QJsonDocument::fromJson(line);
+    if (!doc.isObject()) return std::nullopt;
+    return doc.object();
+}
+
+std::optional<QJsonObject> CirculationClient::call(const QJsonObject& request, int timeoutMs) {
+    send(request);
+    return receive(timeoutMs);
+}
+
+} // namespace hinlibs
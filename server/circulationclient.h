@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QString>
+
+#include <cstdint>
+#include <optional>
+
+namespace hinlibs {
+
+// Blocking client for hinlibs-server. send() only queues a request, so callers
+// can pipeline several and then collect the responses with receive(), which
+// returns them in the order they were sent.
+class CirculationClient {
+public:
+    bool connectTo(const QString& name, int timeoutMs = 3000);
+    QString errorString() const { return socket_.errorString(); }
+
+    // Assigns and returns the request id.
+    std::uint64_t send(QJsonObject request);
+    std::optional<QJsonObject> receive(int timeoutMs = 30000);
+
+    // send() + receive() for one request.
+    std::optional<QJsonObject> call(const QJsonObject& request, int timeoutMs = 30000);
+
+private:
+    QLocalSocket socket_;
+    QByteArray inbox_;
+    std::uint64_t nextId_ = 1;
+};
+
+} // namespace hinlibs
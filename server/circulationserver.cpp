@@ -0,0 +1,145 @@
+#include "circulationserver.h"
+
+#include "protocol.h"
+
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include <utility>
+#include <vector>
+
+namespace hinlibs {
+
+CirculationServer::CirculationServer(Handler handler, QObject* parent)
+    : QObject(parent), handler_(std::move(handler)) {
+    connect(&server_, &QLocalServer::newConnection, this, &CirculationServer::onNewConnection);
+}
+
+bool CirculationServer::listen(const QString& name, QString* error) {
+    // A previous server that crashed leaves its socket file behind.
+    QLocalServer::removeServer(name);
+    if (!server_.listen(name)) {
+        if (error) *error = server_.errorString();
+        return false;
+    }
+    return true;
+}
+
+void CirculationServer::onNewConnection() {
+    while (QLocalSocket* socket = server_.nextPendingConnection()) {
+        clients_.insert(socket, Client{});
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            clients_.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void CirculationServer::onReadyRead(QLocalSocket* socket) {
+    auto it = clients_.find(socket);
+    if (it == clients_.end()) return;
+    it->inbox.append(socket->readAll());
+
+    int start = 0;
+    int end;
+    while ((end = it->inbox.indexOf('\n', start)) >= 0) {
+        const QByteArray line = it->inbox.mid(start, end - start);
+        start = end + 1;
+        if (line.trimmed().isEmpty()) continue;
+        ++requests_;
+
+        // A malformed line becomes an empty request and gets an error reply
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        const QJsonObject request = doc.isObject() ? doc.object() : QJsonObject();
+
+        if (it->queued > 0 || service::IsWriteOp(request.value("op").toString())) {
+            enqueue(socket, request);
+        } else {
+            reply(socket, request, handler_(request));
+        }
+    }
+    it->inbox.remove(0, start);
+    flush(socket);
+}
+
+void CirculationServer::enqueue(QLocalSocket* socket, const QJsonObject& request) {
+    pending_.push_back(Pending{ socket, request });
+    ++clients_[socket].queued;
+    scheduleDrain();
+}
+
+void CirculationServer::scheduleDrain() {
+    if (drainScheduled_) return;
+    drainScheduled_ = true;
+    // Runs after the readyRead events already queued in this pass, or once
+    // the group-commit window has let more writes arrive
+    const int delay = group_.begin ? group_.windowMs : 0;
+    QTimer::singleShot(delay, this, &CirculationServer::drain);
+}
+
+void CirculationServer::drain() {
+    drainScheduled_ = false;
+    if (pending_.empty()) return;
+    ++batches_;
+
+    // When the shared transaction cannot be opened (e.g. busy) the batch
+    // runs as before, each write committing on its own.
+    const bool grouped = group_.begin && group_.begin();
+    std::vector<std::pair<Pending, QJsonObject>> held;
+
+    QList<QLocalSocket*> touched;
+    for (int n = 0; n < maxBatch_ && !pending_.empty(); ++n) {
+        Pending p = std::move(pending_.front());
+        pending_.pop_front();
+        QLocalSocket* socket = p.socket.data();
+        if (!socket || !clients_.contains(socket)) continue;
+
+        --clients_[socket].queued;
+        QJsonObject response = handler_(p.request);
+        if (grouped) held.emplace_back(std::move(p), std::move(response));
+        else reply(socket, p.request, std::move(response));
+        if (!touched.contains(socket)) touched.append(socket);
+    }
+
+    if (grouped) {
+        ++groupCommits_;
+        const bool committed = group_.end();
+        if (!committed) ++groupFailures_;
+        for (auto& [p, response] : held) {
+            QLocalSocket* socket = p.socket.data();
+            if (!socket || !clients_.contains(socket)) continue;
+            if (!committed && response.value("ok").toBool() && service::IsWriteOp(p.request.value("op").toString())) {
+                response = QJsonObject();
+                response["ok"] = false;
+                response["error"] = CirculationErrorName(CirculationError::StorageError);
+                response["message"] = "Commit failed";
+            }
+            reply(socket, p.request, std::move(response));
+        }
+    }
+    for (QLocalSocket* socket : touched) flush(socket);
+
+    if (!pending_.empty()) scheduleDrain();
+}
+
+void CirculationServer::reply(QLocalSocket* socket, const QJsonObject& request, QJsonObject response) {
+    if (request.isEmpty()) {
+        response = QJsonObject();
+        response["ok"] = false;
+        response["error"] = CirculationErrorName(CirculationError::BadRequest);
+        response["message"] = "Malformed request";
+    }
+    if (request.contains("id")) response["id"] = request.value("id");
+    clients_[socket].outbox.append(service::Frame(response));
+}
+
+void CirculationServer::flush(QLocalSocket* socket) {
+    auto it = clients_.find(socket);
+    if (it == clients_.end() || it->outbox.isEmpty()) return;
+    socket->write(it->outbox);
+    it->outbox.clear();
+}
+
+} // namespace hinlibs
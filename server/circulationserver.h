@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QObject>
+#include <QPointer>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+class QLocalSocket;
+
+namespace hinlibs {
+
+// Owns the only database connection (or the branch router) and serves the
+// line protocol in protocol.h to any number of local clients.
+//
+// Reads are answered as soon as they are parsed. Writes from every client
+// are queued and drained together once per event-loop pass, so a dozen desks
+// become one writer issuing mutations back to back instead of a dozen
+// connections contending for the SQLite lock. A client's read that follows
+// one of its own queued writes waits behind it, keeping responses in order.
+//
+// With group commit on, the first queued write opens a short window (a few
+// ms) for others to join, and the drained batch runs inside one transaction
+// (see Database::BeginGroup): one fsync per batch instead of one per write.
+// Replies are held until that commit, and if it fails every write in the
+// batch is answered with the failure.
+class CirculationServer : public QObject {
+    Q_OBJECT
+public:
+    // Runs one request; see service::HandleRequest.
+    using Handler = std::function<QJsonObject(const QJsonObject&)>;
+    // Opens / commits the shared transaction for one batch. end returns
+    // false when the commit failed and the batch was rolled back.
+    struct GroupCommit {
+        std::function<bool()> begin;
+        std::function<bool()> end;
+        int windowMs = 2;
+    };
+
+    explicit CirculationServer(Handler handler, QObject* parent = nullptr);
+
+    bool listen(const QString& name, QString* error = nullptr);
+    void setMaxBatch(int n) { maxBatch_ = n > 0 ? n : 1; }
+    void setGroupCommit(GroupCommit group) { group_ = std::move(group); }
+
+    // Totals since start, for the shutdown summary.
+    std::uint64_t requestCount() const { return requests_; }
+    std::uint64_t batchCount() const { return batches_; }
+    std::uint64_t groupCommitCount() const { return groupCommits_; }
+    std::uint64_t groupCommitFailures() const { return groupFailures_; }
+
+private slots:
+    void onNewConnection();
+
+private:
+    struct Client {
+        QByteArray inbox;
+        QByteArray outbox;
+        int queued = 0;     // requests waiting in pending_
+    };
+    struct Pending {
+        QPointer<QLocalSocket> socket;
+        QJsonObject request;
+    };
+
+    void onReadyRead(QLocalSocket* socket);
+    void enqueue(QLocalSocket* socket, const QJsonObject& request);
+    void scheduleDrain();
+    void drain();
+    void reply(QLocalSocket* socket, const QJsonObject& request, QJsonObject response);
+    void flush(QLocalSocket* socket);
+
+    Handler handler_;
+    QLocalServer server_;
+    QHash<QLocalSocket*, Client> clients_;
+    std::deque<Pending> pending_;
+    bool drainScheduled_ = false;
+    int maxBatch_ = 256;
+    GroupCommit group_;
+    std::uint64_t requests_ = 0;
+    std::uint64_t batches_ = 0;
+    std::uint64_t groupCommits_ = 0;
+    std::uint64_t groupFailures_ = 0;
+};
+
+} // namespace hinlibs
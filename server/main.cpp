@@ -0,0 +1,116 @@
+// hinlibs-server: long-running circulation service. Owns the SQLite database
+// and serves catalogue and circulation requests to local clients over a Unix
+// domain socket (see protocol.h), so that many desks share one writer.
+
+#include "branchrouter.h"
+#include "circulationserver.h"
+#include "database.h"
+#include "oplog.h"
+#include "protocol.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTextStream>
+
+#include <algorithm>
+#include <memory>
+
+using namespace hinlibs;
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("hinlibs-server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("HinLIBS circulation service.");
+    parser.addHelpOption();
+    QCommandLineOption dbOpt("db", "Database file (default: hinlibs.sqlite3 in the current directory).", "path");
+    QCommandLineOption socketOpt("socket", QString("Socket name or path (default: %1).").arg(service::kDefaultSocketName), "name");
+    QCommandLineOption branchesOpt("branches", "Shard items, loans and holds per branch, one file each in this directory.", "dir");
+    QCommandLineOption addBranchOpt("add-branch", "Register a branch before serving (with --branches).", "code:name");
+    QCommandLineOption batchOpt("max-batch", "Most queued requests drained per event-loop pass (default 256).", "n");
+    QCommandLineOption groupOpt("group-commit", "Commit each write batch as one transaction, waiting up to ms "
+                                                "for writes to join it (e.g. 2). Not with --branches.", "ms");
+    QCommandLineOption opLogOpt("oplog", "Append every committed change to this operation log. Not with --branches.", "path");
+    parser.addOptions({ dbOpt, socketOpt, branchesOpt, addBranchOpt, batchOpt, groupOpt, opLogOpt });
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    const QString dbPath = parser.isSet(dbOpt) ? parser.value(dbOpt) : QString("hinlibs.sqlite3");
+    if (!QFileInfo::exists(dbPath)) {
+        err << "No database at " << dbPath << "\n";
+        return 2;
+    }
+    std::shared_ptr<Database> db;
+    std::unique_ptr<BranchRouter> router;
+    CirculationServer::Handler handler;
+    if (parser.isSet(branchesOpt)) {
+        router = std::make_unique<BranchRouter>(dbPath, parser.value(branchesOpt));
+        QString error;
+        if (!router->Open(&error)) {
+            err << error << "\n";
+            return 2;
+        }
+        for (const QString& spec : parser.values(addBranchOpt)) {
+            const QString code = spec.section(':', 0, 0);
+            const auto r = router->AddBranch(code.toStdString(), spec.section(':', 1).toStdString());
+            if (!r.ok) err << "Branch " << code << ": " << QString::fromStdString(r.message) << "\n";
+        }
+        handler = [&router](const QJsonObject& request) { return service::HandleRequest(*router, request); };
+    } else {
+        QSqlDatabase sqlDb = QSqlDatabase::addDatabase("QSQLITE");
+        sqlDb.setDatabaseName(dbPath);
+        if (!sqlDb.open()) {
+            err << "Cannot open " << dbPath << "\n";
+            return 2;
+        }
+        // Readers (exports, backups) then never block circulation writes.
+        QSqlQuery(sqlDb).exec("PRAGMA journal_mode=WAL");
+        db = std::make_shared<Database>(sqlDb);
+        if (parser.isSet(opLogOpt)) {
+            auto log = std::make_shared<OpLogWriter>(parser.value(opLogOpt));
+            QString error;
+            if (!log->open(&error)) {
+                err << "Cannot open operation log: " << error << "\n";
+                return 2;
+            }
+            db->AttachOpLog(std::move(log));
+        }
+        handler = [db](const QJsonObject& request) { return service::HandleRequest(*db, request); };
+    }
+
+    CirculationServer server(handler);
+    if (parser.isSet(batchOpt)) server.setMaxBatch(parser.value(batchOpt).toInt());
+    if (parser.isSet(groupOpt)) {
+        if (!db) {
+            err << "--group-commit needs a single database; ignored with --branches\n";
+        } else {
+            CirculationServer::GroupCommit group;
+            group.begin = [db]() { return db->BeginGroup(); };
+            group.end = [db]() { return db->EndGroup(); };
+            group.windowMs = std::max(0, parser.value(groupOpt).toInt());
+            server.setGroupCommit(group);
+        }
+    }
+
+    const QString name = parser.isSet(socketOpt) ? parser.value(socketOpt) : QString(service::kDefaultSocketName);
+    QString error;
+    if (!server.listen(name, &error)) {
+        err << "Cannot listen on " << name << ": " << error << "\n";
+        return 2;
+    }
+    err << "Serving " << dbPath << " on " << name << "\n";
+    err.flush();
+
+    const int rc = app.exec();
+    err << server.requestCount() << " requests, " << server.batchCount() << " write batches";
+    if (server.groupCommitCount()) {
+        err << ", " << server.groupCommitCount() << " group commits (" << server.groupCommitFailures() << " failed)";
+    }
+    err << "\n";
+    return rc;
+}
@@ -0,0 +1,232 @@
+#include "protocol.h"
+
+#include "branchrouter.h"
+#include "database.h"
+
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <chrono>
+
+namespace hinlibs::service {
+
+namespace {
+
+QString q(const std::string& s) { return QString::fromStdString(s); }
+
+QString isoDate(std::chrono::system_clock::time_point tp) {
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+    return QDateTime::fromMSecsSinceEpoch(ms).toString(Qt::ISODate);
+}
+
+QJsonObject summaryToJson(const ItemSummary& s) {
+    QJsonObject o;
+    o["id"] = q(s.id);
+    o["title"] = q(s.title);
+    o["author"] = q(s.authorOrCreator);
+    o["format"] = FormatName(s.format);
+    o["status"] = StatusName(s.status);
+    return o;
+}
+
+QJsonObject detailsToJson(const ItemDetails& d) {
+    QJsonObject o = summaryToJson(d);
+    if (d.publicationYear) o["year"] = *d.publicationYear;
+    if (d.isbn)            o["isbn"] = q(*d.isbn);
+    if (d.deweyDecimal)    o["dewey"] = q(*d.deweyDecimal);
+    if (d.genre)           o["genre"] = q(*d.genre);
+    if (d.rating)          o["rating"] = q(*d.rating);
+    if (d.issueNumber)     o["issue"] = q(*d.issueNumber);
+    return o;
+}
+
+QJsonObject loanToJson(const LoanSnapshot& l) {
+    QJsonObject o;
+    o["id"] = q(l.id);
+    o["item"] = q(l.itemId);
+    o["checkoutDate"] = isoDate(l.checkoutDate);
+    o["dueDate"] = isoDate(l.dueDate);
+    return o;
+}
+
+QJsonObject fail(CirculationError error, const std::string& message) {
+    QJsonObject o;
+    o["ok"] = false;
+    o["error"] = CirculationErrorName(error);
+    o["message"] = q(message);
+    return o;
+}
+
+QJsonObject succeed(const QJsonValue& result = QJsonValue()) {
+    QJsonObject o;
+    o["ok"] = true;
+    o["error"] = CirculationErrorName(CirculationError::None);
+    if (!result.isNull()) o["result"] = result;
+    return o;
+}
+
+template <typename R>
+QJsonObject fromResult(const R& r, const QJsonValue& result = QJsonValue()) {
+    if (!r.ok) return fail(r.error, r.message);
+    QJsonObject o = succeed(result);
+    if (!r.message.empty()) o["message"] = q(r.message);
+    return o;
+}
+
+QJsonValue statsJson(Database& db) {
+    return QJsonDocument::fromJson(db.Stats().toJson()).object();
+}
+
+QJsonValue statsJson(BranchRouter& router) {
+    QJsonArray branches;
+    for (const auto& b : router.Branches()) {
+        QJsonObject o;
+        o["code"] = q(b.code);
+        o["name"] = q(b.name);
+        branches.append(o);
+    }
+    QJsonObject o;
+    o["branches"] = branches;
+    return o;
+}
+
+template <typename Backend>
+QJsonObject handle(Backend& db, const QJsonObject& request, bool local);
+
+} // namespace
+
+QString FormatName(ItemFormat format) {
+    switch (format) {
+        case ItemFormat::Book:      return "Book";
+        case ItemFormat::Magazine:  return "Magazine";
+        case ItemFormat::Movie:     return "Movie";
+        case ItemFormat::VideoGame: return "VideoGame";
+    }
+    return "Unknown";
+}
+
+QString StatusName(ItemStatus status) {
+    switch (status) {
+        case ItemStatus::Available:  return "Available";
+        case ItemStatus::CheckedOut: return "CheckedOut";
+    }
+    return "Unknown";
+}
+
+bool IsWriteOp(const QString& op) {
+    return op == "borrow" || op == "return" || op == "hold" || op == "cancel" || op == "pay";
+}
+
+QJsonObject HandleRequest(Database& db, const QJsonObject& request) {
+    return handle(db, request, false);
+}
+
+QJsonObject HandleRequest(BranchRouter& router, const QJsonObject& request) {
+    return handle(router, request, false);
+}
+
+QJsonObject HandleLocalRequest(Database& db, const QJsonObject& request) {
+    return handle(db, request, true);
+}
+
+namespace {
+
+// Database and BranchRouter share the method names used here. local is
+// false for requests off the socket.
+template <typename Backend>
+QJsonObject handle(Backend& db, const QJsonObject& request, bool local) {
+    const QString op = request.value("op").toString();
+
+    // ----- Catalogue -----
+    if (op == "ping") return succeed();
+    if (op == "catalogue") {
+        const auto items = request.value("all").toBool() ? db.GetCatalogueSummaries()
+                                                         : db.GetAvailableCatalogue();
+        QJsonArray arr;
+        for (const auto& s : items) arr.append(summaryToJson(s));
+        return succeed(arr);
+    }
+    if (op == "item") {
+        const auto details = db.GetItemDetails(request.value("item").toString().toStdString());
+        if (!details) return fail(CirculationError::ItemNotFound, "Item not found");
+        return succeed(detailsToJson(*details));
+    }
+    if (op == "stats") {
+        return succeed(statsJson(db));
+    }
+
+    // ----- Patron operations -----
+    // Users are named per request; the server keeps no sessions.
+    const bool patronOp = op == "status" || op == "waive" || IsWriteOp(op);
+    if (!patronOp) return fail(CirculationError::BadRequest, "Unknown op: " + op.toStdString());
+    if (op == "waive" && !local) {
+        return fail(CirculationError::BadRequest, "Fines can only be waived with hinlibs-cli on the database file");
+    }
+
+    const auto user = db.FindUserByName(request.value("user").toString().toStdString());
+    if (!user) return fail(CirculationError::UserNotFound, "User not found");
+    if (user->role != Role::Patron) return fail(CirculationError::NotAPatron, "User is not a patron");
+
+    if (op == "status") {
+        const auto dash = db.GetPatronDashboard(user->id);
+        QJsonArray loans;
+        for (const auto& l : dash.loans) {
+            QJsonObject o = loanToJson(l.loan);
+            o["title"] = q(l.itemTitle);
+            loans.append(o);
+        }
+        QJsonArray holds;
+        for (const auto& h : dash.holds) {
+            QJsonObject o;
+            o["id"] = q(h.hold.id);
+            o["item"] = q(h.hold.itemId);
+            o["title"] = q(h.itemTitle);
+            o["position"] = static_cast<qint64>(h.hold.queuePosition);
+            holds.append(o);
+        }
+        QJsonObject result;
+        result["loans"] = loans;
+        result["holds"] = holds;
+        // Cents: balance plus fines still accruing, and the checkout limit
+        // (null for none).
+        result["finesOwed"] = static_cast<qint64>(db.GetFinesOwed(user->id));
+        const auto limit = db.FineThresholdCents();
+        result["fineLimit"] = limit ? QJsonValue(static_cast<qint64>(*limit)) : QJsonValue();
+        return succeed(result);
+    }
+
+    if (op == "pay" || op == "waive") {
+        const auto r = db.SettleFine(user->id, request.value("cents").toVariant().toLongLong(),
+                                     op == "waive" ? FineSettlement::Waiver : FineSettlement::Payment);
+        QJsonObject result;
+        if (r.value) result["balance"] = static_cast<qint64>(*r.value);
+        return fromResult(r, result);
+    }
+
+    const ItemId itemId = request.value("item").toString().toStdString();
+    if (op == "borrow") {
+        const auto r = db.CheckoutItem(user->id, itemId);
+        return fromResult(r, r.value ? QJsonValue(loanToJson(*r.value)) : QJsonValue());
+    }
+    if (op == "return") {
+        return fromResult(db.ReturnItem(user->id, itemId));
+    }
+    if (op == "hold") {
+        const auto r = db.PlaceHold(user->id, itemId);
+        QJsonObject result;
+        if (r.value) result["position"] = static_cast<qint64>(*r.value);
+        return fromResult(r, result);
+    }
+    return fromResult(db.CancelHold(user->id, itemId));
+}
+
+} // namespace
+
+QByteArray Frame(const QJsonObject& message) {
+    QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    return line;
+}
+
+} // namespace hinlibs::service
@@ -0,0 +1,51 @@
+#pragma once
+
+// Wire protocol of hinlibs-server: one compact JSON object per line, in both
+// directions. A client may pipeline any number of requests; each response
+// echoes the request's "id" and responses on a connection arrive in request
+// order.
+//
+//   -> {"id":7,"op":"borrow","user":"alice","item":"I0000042"}
+//   <- {"id":7,"ok":true,"error":"None","result":{...}}
+//   <- {"id":8,"ok":false,"error":"ItemNotAvailable","message":"Item is not available"}
+//
+// Ops: ping, catalogue {all}, item {item}, status {user}, borrow, return,
+// hold, cancel {user, item}, pay {user, cents}, stats. The socket is not
+// authenticated, so waive {user, cents} is only run by HandleLocalRequest.
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+#include "types.h"
+
+namespace hinlibs {
+
+class BranchRouter;
+class Database;
+
+namespace service {
+
+constexpr const char* kDefaultSocketName = "hinlibs";
+
+QString FormatName(ItemFormat format);
+QString StatusName(ItemStatus status);
+
+// True for ops that mutate the database and are funnelled through the
+// server's write batch.
+bool IsWriteOp(const QString& op);
+
+// Runs one request against db and builds its response (without "id").
+// Shared by the server and by hinlibs-cli when it runs without a server.
+QJsonObject HandleRequest(Database& db, const QJsonObject& request);
+// Same over branch shards; item ids carry the branch prefix ("DT.I004").
+QJsonObject HandleRequest(BranchRouter& router, const QJsonObject& request);
+// HandleRequest for a caller that opened the database file itself
+// (hinlibs-cli without --server), which may also waive fines.
+QJsonObject HandleLocalRequest(Database& db, const QJsonObject& request);
+
+// Compact JSON plus the terminating newline.
+QByteArray Frame(const QJsonObject& message);
+
+} // namespace service
+} // namespace hinlibs
@@ -0,0 +1,19 @@
+# Circulation service over a local socket; see main.cpp and protocol.h.
+
+QT -= gui
+QT += network
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = hinlibs-server
+
+include(../hinlibs_core.pri)
+
+SOURCES += \
+    circulationserver.cpp \
+    main.cpp \
+    protocol.cpp
+
+HEADERS += \
+    circulationserver.h \
+    protocol.h
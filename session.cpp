@@ -9,27 +9,34 @@
 
 namespace hinlibs {
 
-Session::Session(std::shared_ptr<Database> db)
-    : db_(std::move(db)) {}
+Session::Session(std::shared_ptr<Database> db, std::shared_ptr<const Clock> clock)
+    : db_(std::move(db)) {
+    if (clock && db_) db_->SetClock(std::move(clock));
+}
 
 Session::~Session() = default;
 
 bool Session::signIn(const std::string& username) {
     current_.reset();
+    identity_.reset();
     if (!db_) return false;
 
     auto rec = db_->FindUserByName(username);
     if (!rec) return false;
 
+    // The lookup above already validated the user; stamp it so the user
+    // object doesn't need to query the users table again per operation.
+    identity_ = IdentityToken{ *rec, db_->UserGeneration() };
+
     switch (rec->role) {
         case Role::Patron:
-            current_ = std::make_shared<Patron>(db_, rec->id);
+            current_ = std::make_shared<Patron>(db_, *identity_);
             break;
         case Role::Librarian:
-            current_ = std::make_shared<Librarian>(db_, rec->id);
+            current_ = std::make_shared<Librarian>(db_, *identity_);
             break;
         case Role::SysAdmin:
-            current_ = std::make_shared<SysAdmin>(db_, rec->id);
+            current_ = std::make_shared<SysAdmin>(db_, *identity_);
             break;
         default:
             return false;
@@ -39,10 +46,17 @@ bool Session::signIn(const std::string& username) {
 
 void Session::signOut() {
     current_.reset();
+    identity_.reset();
 }
 
 std::shared_ptr<User> Session::currentUser() const {
     return current_;
 }
 
+const Clock& Session::clock() const {
+    if (db_) return db_->GetClock();
+    static const std::shared_ptr<const Clock> fallback = SystemClock::instance();
+    return *fallback;
+}
+
 } // namespace hinlibs
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "clock.h"
+#include "types.h"
 #include <memory>
+#include <optional>
 #include <string>
 
 namespace hinlibs {
@@ -10,20 +13,28 @@ class User;
 
 class Session {
 public:
-    explicit Session(std::shared_ptr<Database> db);
+    // A non-null clock replaces the Database's clock (see Database::SetClock),
+    // so everything signed in through this session sees the same time.
+    explicit Session(std::shared_ptr<Database> db, std::shared_ptr<const Clock> clock = nullptr);
     ~Session();
 
     bool signIn(const std::string& username);
     void signOut();
 
     std::shared_ptr<User> currentUser() const;
+    const std::optional<IdentityToken>& identity() const { return identity_; }
 
     // 🔹 NEW: expose the shared Database so UI can use it
     std::shared_ptr<Database> db() const { return db_; }
 
+    // "Now" for date displays; always the Database's current clock, so a
+    // later Database::SetClock is seen here too.
+    const Clock& clock() const;
+
 private:
     std::shared_ptr<Database> db_;     // backing Database (MockDb now, SQLite later)
     std::shared_ptr<User>     current_; // currently signed-in user
+    std::optional<IdentityToken> identity_; // resolved at signIn
 };
 
 } // namespace hinlibs
@@ -8,6 +8,7 @@ class SysAdmin : public User {
 public:
     // Constructor
     SysAdmin(std::shared_ptr<Database> db, SysAdminId id) : User(std::move(db), std::move(id)) {}
+    SysAdmin(std::shared_ptr<Database> db, IdentityToken identity) : User(std::move(db), std::move(identity)) {}
     Role role() const override { return Role::SysAdmin; }
     virtual ~SysAdmin() = default;
     std::string getUsername() const;
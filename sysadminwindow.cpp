@@ -1,17 +1,90 @@
 #include "sysadminwindow.h"
 #include "ui_sysadminwindow.h"
+#include "maintenance.h"
 
-SysadminWindow::SysadminWindow(std::string username_display, QWidget *parent) :
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
+using hinlibs::MaintenanceService;
+
+SysadminWindow::SysadminWindow(std::string username_display, QString databasePath, QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::SysadminWindow)
+    ui(new Ui::SysadminWindow),
+    maintenance_(std::make_unique<MaintenanceService>(databasePath))
 {
     ui->setupUi(this);
     ui->welcomeUserLabelSysAdmin->setText(tr("Welcome, %1").arg(QString::fromStdString(username_display)));
 
     connect(ui->logOutButtonSysAdmin, &QToolButton::clicked, this, &SysadminWindow::logOutHandler);
+
+    // ---- Maintenance: runs on its own thread and connection ----
+    connect(maintenance_.get(), &MaintenanceService::progress, this, &SysadminWindow::onMaintenanceProgress);
+    connect(maintenance_.get(), &MaintenanceService::finished, this, &SysadminWindow::onMaintenanceFinished);
+
+    connect(ui->analyzeButton, &QPushButton::clicked, this, [this]() { runMaintenance(MaintenanceService::Analyze); });
+    connect(ui->vacuumButton, &QPushButton::clicked, this, [this]() { runMaintenance(MaintenanceService::IncrementalVacuum); });
+    connect(ui->checkpointButton, &QPushButton::clicked, this, [this]() { runMaintenance(MaintenanceService::Checkpoint); });
+    connect(ui->integrityCheckButton, &QPushButton::clicked, this, [this]() { runMaintenance(MaintenanceService::IntegrityCheck); });
+    connect(ui->runAllMaintenanceButton, &QPushButton::clicked, this, [this]() { runMaintenance(MaintenanceService::AllTasks); });
+    connect(ui->cancelMaintenanceButton, &QPushButton::clicked, this, [this]() { maintenance_->cancel(); });
+    connect(ui->scheduleHoursSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, &SysadminWindow::onScheduleChanged);
+
+    // Backups go next to the database, newest kBackupsKept kept
+    const QString backupDir = QFileInfo(databasePath).absoluteDir().filePath("backups");
+    maintenance_->setBackupTarget(backupDir, kBackupsKept);
+    ui->backupButton->setToolTip(tr("Copy the database into %1 while the library stays open").arg(backupDir));
+    connect(ui->backupButton, &QPushButton::clicked, this, [this]() { runMaintenance(MaintenanceService::Backup); });
+    connect(ui->backupHoursSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int hours) {
+        maintenance_->setSchedule(MaintenanceService::Backup, std::chrono::hours(hours));
+    });
+
+    QString error;
+    if (!maintenance_->start(&error)) {
+        ui->maintenanceStatusLabel->setText(error);
+        for (QWidget *w : { static_cast<QWidget *>(ui->analyzeButton), static_cast<QWidget *>(ui->vacuumButton),
+                            static_cast<QWidget *>(ui->checkpointButton), static_cast<QWidget *>(ui->integrityCheckButton),
+                            static_cast<QWidget *>(ui->runAllMaintenanceButton), static_cast<QWidget *>(ui->scheduleHoursSpin),
+                            static_cast<QWidget *>(ui->backupButton), static_cast<QWidget *>(ui->backupHoursSpin) }) {
+            w->setEnabled(false);
+        }
+    }
+}
+
+SysadminWindow::~SysadminWindow()
+{
+    // Joins the maintenance thread; a running step finishes first
+    maintenance_.reset();
+    delete ui;
 }
 
 void SysadminWindow::logOutHandler()
 {
     emit logoutRequest();
 }
+
+void SysadminWindow::runMaintenance(int tasks)
+{
+    ui->maintenanceStatusLabel->setText(maintenance_->isBusy() ? tr("Queued behind the current run.") : tr("Starting..."));
+    maintenance_->trigger(tasks);
+}
+
+void SysadminWindow::onMaintenanceProgress(const QString &task, int step, int steps, const QString &detail)
+{
+    ui->maintenanceProgress->setMaximum(steps > 0 ? steps : 1);
+    ui->maintenanceProgress->setValue(step);
+    ui->maintenanceStatusLabel->setText(tr("%1: %2").arg(task, detail));
+}
+
+void SysadminWindow::onMaintenanceFinished(const QString &summary, bool ok)
+{
+    ui->maintenanceStatusLabel->setText(ok ? tr("Maintenance finished.") : tr("Maintenance finished with problems."));
+    ui->maintenanceLog->appendPlainText(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+    ui->maintenanceLog->appendPlainText(summary);
+    ui->maintenanceLog->appendPlainText(QString());
+}
+
+void SysadminWindow::onScheduleChanged(int hours)
+{
+    maintenance_->setSchedule(MaintenanceService::AllTasks, std::chrono::hours(hours));
+}
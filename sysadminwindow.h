@@ -2,6 +2,11 @@
 #define SYSADMINWINDOW_H
 
 #include <QWidget>
+#include <memory>
+
+namespace hinlibs {
+class MaintenanceService;
+}
 
 namespace Ui {
 class SysadminWindow;
@@ -12,13 +17,21 @@ class SysadminWindow : public QWidget
     Q_OBJECT
 
 public:
-    explicit SysadminWindow(std::string username_display, QWidget *parent = nullptr);
-//    ~SysadminWindow();
+    // databasePath: the SQLite file the maintenance service opens its own connection to
+    explicit SysadminWindow(std::string username_display, QString databasePath, QWidget *parent = nullptr);
+    ~SysadminWindow();
 
 private:
+    static constexpr int kBackupsKept = 7;
+
     Ui::SysadminWindow *ui;
+    std::unique_ptr<hinlibs::MaintenanceService> maintenance_;
 
     void logOutHandler();
+    void runMaintenance(int tasks);
+    void onMaintenanceProgress(const QString &task, int step, int steps, const QString &detail);
+    void onMaintenanceFinished(const QString &summary, bool ok);
+    void onScheduleChanged(int hours);
 
 signals:
     void logoutRequest();
@@ -0,0 +1,96 @@
+#include "suites.h"
+
+#include "lrucache.h"
+#include "usernameindex.h"
+
+#include <string>
+#include <vector>
+
+namespace tests {
+
+namespace {
+
+using hinlibs::FoldUsername;
+using hinlibs::LruCache;
+using hinlibs::Role;
+using hinlibs::UserRecord;
+using hinlibs::UsernameIndex;
+
+int lruEviction() {
+    int failures = 0;
+    LruCache<std::string, int> cache(2);
+    cache.put("a", 1);
+    cache.put("b", 2);
+    failures += check(cache.get("a") == 1, "hit returns the value");
+    cache.put("c", 3);   // "b" is now the least recently used
+    failures += check(!cache.get("b"), "least recently used entry evicted");
+    failures += check(cache.get("a") == 1 && cache.get("c") == 3, "recent entries kept");
+    failures += check(cache.size() == 2, "size stays at capacity");
+
+    cache.put("a", 10);  // update in place, and mark as most recent
+    cache.put("d", 4);
+    failures += check(cache.get("a") == 10, "put on an existing key replaces its value");
+    failures += check(!cache.get("c"), "updated key counted as recently used");
+
+    cache.erase("a");
+    failures += check(!cache.get("a") && cache.size() == 1, "erase removes the entry");
+    cache.erase("missing");
+    failures += check(cache.size() == 1, "erasing a missing key is a no-op");
+    cache.clear();
+    failures += check(cache.size() == 0 && !cache.get("d"), "clear empties the cache");
+
+    LruCache<int, int> tiny(0);
+    failures += check(tiny.capacity() == 1, "zero capacity is raised to one");
+    tiny.put(1, 1);
+    tiny.put(2, 2);
+    failures += check(!tiny.get(1) && tiny.get(2) == 2, "capacity one keeps the latest entry");
+    return failures;
+}
+
+std::vector<std::string> names(const std::vector<UserRecord>& users) {
+    std::vector<std::string> out;
+    for (const auto& u : users) out.push_back(u.username);
+    return out;
+}
+
+int usernameCompletion() {
+    int failures = 0;
+    UsernameIndex index;
+    index.rebuild({
+        { "U1", "Sarah",       Role::Patron },
+        { "U2", "sam",         Role::Librarian },
+        { "U3", "SAMIR",       Role::Patron },
+        { "U4", "ahmed",       Role::Patron },
+        { "U5", "abdulrahman", Role::Patron },
+        { "U6", "sa",          Role::Patron },
+    });
+    failures += check(index.size() == 6, "every user indexed");
+
+    using Names = std::vector<std::string>;
+    failures += check(names(index.complete("sa", 10)) == Names{ "sa", "sam", "SAMIR", "Sarah" },
+                      "prefix matches in folded order, the exact name first");
+    failures += check(names(index.complete("SAM", 10)) == Names{ "sam", "SAMIR" }, "prefix is case-insensitive");
+    failures += check(names(index.complete("sa", 2)) == Names{ "sa", "sam" }, "limit applies");
+    failures += check(names(index.complete("sa", 10, Role::Patron)) == Names{ "sa", "SAMIR", "Sarah" },
+                      "role filter skips other roles");
+    failures += check(index.complete("sa", 0).empty(), "limit 0 returns nothing");
+    failures += check(index.complete("zz", 10).empty() && index.complete("b", 10).empty(),
+                      "no match past the end or between keys");
+    failures += check(index.complete("", 10).size() == 6, "empty prefix matches everyone");
+    failures += check(FoldUsername("AbC-9z") == "abc-9z", "folding lowers ASCII letters only");
+
+    index.rebuild({ { "U7", "zoe", Role::Patron } });
+    failures += check(index.size() == 1 && names(index.complete("", 10)) == Names{ "zoe" },
+                      "rebuild replaces the old entries");
+    index.clear();
+    failures += check(index.size() == 0 && index.complete("", 10).empty(), "clear empties the index");
+    return failures;
+}
+
+} // namespace
+
+int run_cache_tests() {
+    return lruEviction() + usernameCompletion();
+}
+
+} // namespace tests
@@ -0,0 +1,45 @@
+#include "suites.h"
+
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QTextStream>
+
+namespace tests {
+
+int check(bool ok, const QString& what) {
+    if (ok) return 0;
+    QTextStream(stderr) << "  FAIL: " << what << "\n";
+    return 1;
+}
+
+QSqlDatabase open_fixture(const QString& connection, QString* error) {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+    db.setDatabaseName(":memory:");
+    if (!db.open()) {
+        if (error) *error = db.lastError().text();
+        return QSqlDatabase();
+    }
+
+    QFile f(":/hinlibs.sql");
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Cannot read bundled hinlibs.sql";
+        return QSqlDatabase();
+    }
+    QStringList lines;
+    for (const QString& line : QString::fromUtf8(f.readAll()).split('\n')) {
+        if (!line.trimmed().startsWith("--")) lines << line;
+    }
+    QSqlQuery q(db);
+    for (const QString& stmt : lines.join("\n").split(';')) {
+        if (stmt.trimmed().isEmpty()) continue;
+        if (!q.exec(stmt)) {
+            if (error) *error = q.lastError().text();
+            return QSqlDatabase();
+        }
+    }
+    return db;
+}
+
+} // namespace tests
@@ -0,0 +1,30 @@
+#include "suites.h"
+
+#include <QCoreApplication>
+#include <QTextStream>
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    struct Suite {
+        const char* name;
+        int (*run)();
+    };
+    const Suite suites[] = {
+        { "transactions", tests::run_transaction_tests },
+        { "oplog",        tests::run_oplog_tests },
+        { "caches",       tests::run_cache_tests },
+    };
+
+    QTextStream err(stderr);
+    int failures = 0;
+    for (const auto& suite : suites) {
+        err << suite.name << "\n";
+        err.flush();
+        const int n = suite.run();
+        err << "  " << (n ? QString("%1 failed").arg(n) : QString("ok")) << "\n";
+        failures += n;
+    }
+    err << (failures ? "FAILED" : "All tests passed") << "\n";
+    return failures ? 1 : 0;
+}
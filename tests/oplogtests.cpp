@@ -0,0 +1,199 @@
+#include "suites.h"
+
+#include "oplog.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <memory>
+#include <vector>
+
+namespace tests {
+
+namespace {
+
+using hinlibs::CirculationState;
+using hinlibs::OpKind;
+using hinlibs::OpLogReader;
+using hinlibs::OpLogWriter;
+using hinlibs::OpRecord;
+using hinlibs::ReplayOpLog;
+using hinlibs::ReplayReport;
+
+OpRecord makeRecord(OpKind kind, const std::string& patron, const std::string& item,
+                    const std::string& recordId, std::int64_t value) {
+    OpRecord r;
+    r.atMs = 1700000000000 + value;
+    r.kind = kind;
+    r.patronId = patron;
+    r.itemId = item;
+    r.recordId = recordId;
+    r.value = value;
+    return r;
+}
+
+// Checkout, hold, return with a fine, then two more checkouts.
+std::vector<OpRecord> sampleRecords() {
+    return {
+        makeRecord(OpKind::Checkout,  "U001", "I001", "L1", 1700001000000),
+        makeRecord(OpKind::PlaceHold, "U002", "I001", "H1", 1),
+        makeRecord(OpKind::Return,    "U001", "I001", "",   50),
+        makeRecord(OpKind::Checkout,  "U003", "I002", "L2", 1700002000000),
+        makeRecord(OpKind::Checkout,  "U003", "I003", "L3", 1700003000000),
+    };
+}
+
+// Writes records to a new log at path and closes it.
+bool writeLog(const QString& path, const std::vector<OpRecord>& records, QString* error) {
+    OpLogWriter writer(path);
+    if (!writer.open(error)) return false;
+    for (const auto& r : records) {
+        if (writer.append(r) == 0) {
+            if (error) *error = "append failed";
+            return false;
+        }
+    }
+    return writer.sync();
+}
+
+std::vector<OpRecord> readAll(OpLogReader& reader) {
+    std::vector<OpRecord> out;
+    OpRecord r;
+    while (reader.next(&r)) out.push_back(r);
+    return out;
+}
+
+bool sameRecord(const OpRecord& a, const OpRecord& b) {
+    return a.atMs == b.atMs && a.kind == b.kind && a.patronId == b.patronId
+        && a.itemId == b.itemId && a.recordId == b.recordId && a.value == b.value;
+}
+
+int roundTrip(const QTemporaryDir& dir) {
+    int failures = 0;
+    const QString path = dir.filePath("roundtrip.hlog");
+    const auto records = sampleRecords();
+    QString error;
+    if (!writeLog(path, records, &error)) return check(false, "write log: " + error);
+
+    OpLogReader reader;
+    if (!reader.open(path, &error)) return check(false, "open log: " + error);
+    failures += check(!reader.isCheckpoint() && reader.baseSequence() == 0, "header read back");
+    const auto back = readAll(reader);
+    failures += check(back.size() == records.size(), QString("%1 records read back").arg(back.size()));
+    for (std::size_t i = 0; i < back.size() && i < records.size(); ++i) {
+        failures += check(back[i].seq == i + 1, QString("record %1 has seq %2").arg(i).arg(back[i].seq));
+        failures += check(sameRecord(back[i], records[i]), QString("record %1 fields match").arg(i));
+    }
+    failures += check(!reader.tornTail(), "clean log has no torn tail");
+    failures += check(reader.validBytes() == QFileInfo(path).size(), "every byte is in a good frame");
+
+    CirculationState state;
+    ReplayReport report;
+    failures += check(ReplayOpLog(QString(), path, &state, &report), "replay: " + QString::fromStdString(report.error));
+    failures += check(report.applied == records.size() && report.problems.empty(), "replay applies every record cleanly");
+    failures += check(state.seq == records.size(), "replay ends at the last sequence number");
+    failures += check(state.loans.size() == 2 && state.loans.count("I002") && state.loans.count("I003"),
+                      "the two open loans remain");
+    failures += check(state.holds.count("I001") && state.holds.at("I001").size() == 1, "the hold on I001 remains");
+    failures += check(state.fines.count("U001") && state.fines.at("U001") == 50, "the return's fine is owed");
+
+    // Reopening continues the sequence; a second writer is locked out.
+    OpLogWriter writer(path);
+    failures += check(writer.open(&error), "reopen: " + error);
+    failures += check(writer.lastSequence() == records.size(), "reopened writer continues the sequence");
+    OpLogWriter second(path);
+    failures += check(!second.open(&error), "second writer on the same log is refused");
+    failures += check(writer.append(records.front()) == records.size() + 1, "next append takes the next number");
+    return failures;
+}
+
+int tornTail(const QTemporaryDir& dir) {
+    int failures = 0;
+    const QString path = dir.filePath("torn.hlog");
+    const auto records = sampleRecords();
+    QString error;
+    if (!writeLog(path, records, &error)) return check(false, "write log: " + error);
+
+    // A crash halfway through the last append.
+    const qint64 fullSize = QFileInfo(path).size();
+    {
+        QFile f(path);
+        failures += check(f.resize(fullSize - 3), "cut the last frame short");
+    }
+
+    OpLogReader reader;
+    if (!reader.open(path, &error)) return failures + check(false, "open log: " + error);
+    const auto back = readAll(reader);
+    failures += check(back.size() == records.size() - 1, QString("%1 records before the tear").arg(back.size()));
+    failures += check(reader.tornTail(), "tear detected");
+    failures += check(reader.recordsPastDamage() == 0, "nothing intact past a torn tail");
+    const qint64 goodBytes = reader.validBytes();
+
+    CirculationState state;
+    ReplayReport report;
+    ReplayOpLog(QString(), path, &state, &report);
+    failures += check(report.tornTail && report.recordsPastDamage == 0, "replay reports the torn tail");
+    failures += check(report.applied == records.size() - 1, "replay applies the records before it");
+
+    OpLogWriter writer(path);
+    failures += check(writer.open(&error), "writer opens a torn log: " + error);
+    failures += check(QFileInfo(path).size() == goodBytes, "writer truncates the torn frame");
+    failures += check(writer.lastSequence() == records.size() - 1, "sequence continues from the last good record");
+    failures += check(writer.append(records.back()) == records.size(), "the lost number is reused");
+    return failures;
+}
+
+int damageMidLog(const QTemporaryDir& dir) {
+    int failures = 0;
+    const QString path = dir.filePath("damaged.hlog");
+    const auto records = sampleRecords();
+    QString error;
+    if (!writeLog(path, records, &error)) return check(false, "write log: " + error);
+
+    // Flip the first payload byte of the second frame; its CRC no longer
+    // matches, and the three frames after it stay intact.
+    qint64 secondFrame = 0;
+    {
+        OpLogReader reader;
+        OpRecord r;
+        if (!reader.open(path, &error) || !reader.next(&r)) return check(false, "read the first frame");
+        secondFrame = reader.validBytes();
+    }
+    {
+        QFile f(path);
+        char byte = 0;
+        const bool flipped = f.open(QIODevice::ReadWrite) && f.seek(secondFrame + 8) && f.read(&byte, 1) == 1
+                          && f.seek(secondFrame + 8) && (byte = static_cast<char>(byte ^ 0xFF), f.write(&byte, 1) == 1);
+        failures += check(flipped, "damage the second frame");
+    }
+    const qint64 size = QFileInfo(path).size();
+
+    OpLogReader reader;
+    if (!reader.open(path, &error)) return failures + check(false, "open log: " + error);
+    failures += check(readAll(reader).size() == 1, "reading stops at the damage");
+    failures += check(reader.tornTail(), "damage detected");
+    failures += check(reader.recordsPastDamage() == records.size() - 2,
+                      "the frames after the damage are found intact");
+
+    CirculationState state;
+    ReplayReport report;
+    ReplayOpLog(QString(), path, &state, &report);
+    failures += check(report.recordsPastDamage == records.size() - 2 && !report.problems.empty(),
+                      "replay reports the damage mid-log");
+
+    OpLogWriter writer(path);
+    failures += check(!writer.open(&error), "writer refuses a log damaged mid-way");
+    failures += check(QFileInfo(path).size() == size, "refusing leaves the file untouched");
+    return failures;
+}
+
+} // namespace
+
+int run_oplog_tests() {
+    QTemporaryDir dir;
+    if (!dir.isValid()) return check(false, "no temporary directory");
+    return roundTrip(dir) + tornTail(dir) + damageMidLog(dir);
+}
+
+} // namespace tests
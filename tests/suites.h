@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QSqlDatabase>
+#include <QString>
+
+namespace tests {
+
+// Each suite returns its number of failures (0 means success) and reports
+// every failed check on stderr.
+int run_transaction_tests();
+int run_oplog_tests();
+int run_cache_tests();
+
+// Counts one failure, printing what, unless ok.
+int check(bool ok, const QString& what);
+
+// An in-memory SQLite database on its own connection, holding the schema and
+// demo rows from the bundled hinlibs.sql. Invalid (with *error set) on
+// failure; remove the connection with QSqlDatabase::removeDatabase when done.
+QSqlDatabase open_fixture(const QString& connection, QString* error);
+
+} // namespace tests
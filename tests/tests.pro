@@ -0,0 +1,22 @@
+# Headless tests for the core library; exits nonzero when any check fails.
+
+QT -= gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = hinlibs-tests
+
+include(../hinlibs_core.pri)
+
+SOURCES += \
+    cachetests.cpp \
+    fixture.cpp \
+    main.cpp \
+    oplogtests.cpp \
+    transactiontests.cpp
+
+HEADERS += \
+    suites.h
+
+RESOURCES += \
+    tests.qrc
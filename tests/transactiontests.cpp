@@ -0,0 +1,137 @@
+#include "suites.h"
+
+#include "database.h"
+#include "oplog.h"
+
+#include <QTemporaryDir>
+
+#include <memory>
+#include <vector>
+
+namespace tests {
+
+namespace {
+
+using hinlibs::Database;
+using hinlibs::OpKind;
+using hinlibs::OpLogReader;
+using hinlibs::OpLogWriter;
+using hinlibs::OpRecord;
+
+std::vector<OpRecord> readLog(const QString& path) {
+    std::vector<OpRecord> out;
+    OpLogReader reader;
+    if (!reader.open(path)) return out;
+    OpRecord r;
+    while (reader.next(&r)) out.push_back(r);
+    return out;
+}
+
+// Runs body against a fresh fixture whose op log records every commit, and
+// returns its failures. The log is how the effects deferred by afterCommit
+// are observed: a record appears only once the outermost commit succeeds.
+template <typename Body>
+int withLoggedDatabase(const QString& name, Body body) {
+    int failures = 0;
+    QTemporaryDir dir;
+    if (!dir.isValid()) return check(false, name + ": no temporary directory");
+    const QString connection = "tests-" + name;
+    {
+        QString error;
+        QSqlDatabase sqlDb = open_fixture(connection, &error);
+        if (!sqlDb.isValid()) {
+            failures += check(false, name + ": " + error);
+        } else {
+            auto log = std::make_shared<OpLogWriter>(dir.filePath("ops.hlog"));
+            if (!log->open(&error)) {
+                failures += check(false, name + ": " + error);
+            } else {
+                Database db(sqlDb);
+                db.AttachOpLog(log);
+                failures += body(db, [&] { return readLog(log->path()); });
+            }
+        }
+    }
+    QSqlDatabase::removeDatabase(connection);
+    return failures;
+}
+
+int outerRollbackDiscardsNested() {
+    return withLoggedDatabase("outer-rollback", [](Database& db, auto records) {
+        int failures = 0;
+        {
+            Database::Transaction outer(db);
+            const auto loan = db.CheckoutItem("U001", "I001");
+            failures += check(loan.ok, "checkout inside the outer transaction");
+            outer.rollback();
+        }
+        failures += check(db.GetActiveLoanCount("U001") == 0, "rolled-back loan is gone");
+        failures += check(records().empty(), "rolled-back checkout is not logged");
+        return failures;
+    });
+}
+
+int nestedCommitWaitsForOuter() {
+    return withLoggedDatabase("nested-commit", [](Database& db, auto records) {
+        int failures = 0;
+        {
+            Database::Transaction outer(db);
+            {
+                Database::Transaction inner(db);
+                failures += check(db.CheckoutItem("U001", "I001").ok, "checkout two levels down");
+                failures += check(inner.commit(), "inner commit");
+            }
+            failures += check(records().empty(), "nothing logged before the outer commit");
+            failures += check(outer.commit(), "outer commit");
+        }
+        const auto logged = records();
+        failures += check(logged.size() == 1, QString("one record logged, got %1").arg(logged.size()));
+        if (!logged.empty()) {
+            failures += check(logged.front().kind == OpKind::Checkout && logged.front().itemId == "I001",
+                              "logged record is the checkout of I001");
+        }
+        failures += check(db.GetActiveLoanCount("U001") == 1, "loan committed");
+        return failures;
+    });
+}
+
+// The committed sibling's effect was queued two levels down; releasing its
+// savepoints must re-tag it to the outer level, or rolling back the next
+// sibling (at the level it was released from) would drop it too.
+int siblingRollbackKeepsCommittedSibling() {
+    return withLoggedDatabase("sibling-rollback", [](Database& db, auto records) {
+        int failures = 0;
+        {
+            Database::Transaction outer(db);
+            {
+                Database::Transaction kept(db);
+                failures += check(db.CheckoutItem("U001", "I001").ok, "first sibling's checkout");
+                failures += check(kept.commit(), "first sibling commits");
+            }
+            {
+                Database::Transaction dropped(db);
+                failures += check(db.CheckoutItem("U002", "I002").ok, "second sibling's checkout");
+                dropped.rollback();
+            }
+            failures += check(outer.commit(), "outer commit");
+        }
+        const auto logged = records();
+        failures += check(logged.size() == 1, QString("one record logged, got %1").arg(logged.size()));
+        if (!logged.empty()) {
+            failures += check(logged.front().itemId == "I001", "the committed sibling's checkout is logged");
+        }
+        failures += check(db.GetActiveLoanCount("U001") == 1, "first sibling's loan kept");
+        failures += check(db.GetActiveLoanCount("U002") == 0, "second sibling's loan rolled back");
+        return failures;
+    });
+}
+
+} // namespace
+
+int run_transaction_tests() {
+    return outerRollbackDiscardsNested()
+         + nestedCommitWaitsForOuter()
+         + siblingRollbackKeepsCommittedSibling();
+}
+
+} // namespace tests
@@ -0,0 +1,24 @@
+#include "types.h"
+
+namespace hinlibs {
+
+const char* CirculationErrorName(CirculationError error) {
+    switch (error) {
+        case CirculationError::None:             return "None";
+        case CirculationError::ItemNotFound:     return "ItemNotFound";
+        case CirculationError::ItemNotAvailable: return "ItemNotAvailable";
+        case CirculationError::ItemAvailable:    return "ItemAvailable";
+        case CirculationError::LoanLimitReached: return "LoanLimitReached";
+        case CirculationError::FinesOwed:        return "FinesOwed";
+        case CirculationError::LoanNotFound:     return "LoanNotFound";
+        case CirculationError::HoldNotFound:     return "HoldNotFound";
+        case CirculationError::UserNotFound:     return "UserNotFound";
+        case CirculationError::NotAPatron:       return "NotAPatron";
+        case CirculationError::BadRequest:       return "BadRequest";
+        case CirculationError::Busy:             return "Busy";
+        case CirculationError::StorageError:     return "StorageError";
+    }
+    return "Unknown";
+}
+
+} // namespace hinlibs
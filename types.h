@@ -54,6 +54,13 @@ struct UserRecord {
     Role     role;
 };
 
+// Identity resolved once (at sign-in or on first use) and reused until the
+// Database reports that user records changed (generation mismatch).
+struct IdentityToken {
+    UserRecord    user;
+    std::uint64_t generation = 0;
+};
+
 struct ItemSummary {
     ItemId      id;
     std::string title;
@@ -87,6 +94,8 @@ struct LoanSnapshotWithItem {
     ItemId      itemId;
     std::chrono::system_clock::time_point checkoutDate;
     std::chrono::system_clock::time_point dueDate;
+    std::string itemTitle;
+    ItemFormat  itemFormat = ItemFormat::Book;
 };
 
 struct HoldSnapshot {
@@ -107,6 +116,7 @@ struct LoanStatusView {
     std::string itemTitle;
     std::chrono::system_clock::time_point dueDate;
     int daysRemaining;  // signed int so negative can represent overdue if needed later
+    std::int64_t fineCents = 0;  // accrued so far; settled onto the balance at return
 };
 
 struct HoldStatusView {
@@ -117,12 +127,68 @@ struct HoldStatusView {
 struct AccountStatusView {
     std::vector<LoanStatusView> loans;
     std::vector<HoldStatusView> holds;
+    // Settled fines plus what the open loans have accrued; checkout is
+    // refused while it is above fineLimitCents (no limit when unset).
+    std::int64_t fineBalanceCents = 0;
+    std::optional<std::int64_t> fineLimitCents;
+};
+
+// How a fine balance was brought down (Database::SettleFine).
+enum class FineSettlement {
+    Payment,
+    Waiver
+};
+
+// A fine a return put into a database without the patron's record (a branch
+// shard), waiting to be charged to their balance at home.
+struct PendingFine {
+    std::int64_t id = 0;    // never reused within the file
+    PatronId     patronId;
+    std::int64_t cents = 0;
+};
+
+// ---------- Profile-page dashboard (loans + holds with titles) ----------
+struct DashboardLoan {
+    LoanSnapshot loan;
+    std::string  itemTitle;
+};
+
+struct DashboardHold {
+    HoldSnapshot hold;
+    std::string  itemTitle;
+};
+
+struct PatronDashboard {
+    std::vector<DashboardLoan> loans;
+    std::vector<DashboardHold> holds;
+};
+
+// ---------- Circulation failure reasons ----------
+enum class CirculationError {
+    None,
+    ItemNotFound,
+    ItemNotAvailable,   // checkout of an item that is already out
+    ItemAvailable,      // hold on an item that could simply be borrowed
+    LoanLimitReached,
+    FinesOwed,          // outstanding fines above policy.fineThresholdCents
+    LoanNotFound,
+    HoldNotFound,
+    UserNotFound,
+    NotAPatron,         // patron operation named a librarian or admin
+    BadRequest,         // malformed or unknown request, or an invalid amount
+    Busy,               // another connection held the lock; safe to retry
+    StorageError        // SQL failure; see message
 };
 
+// Stable name of each reason, e.g. "LoanLimitReached"; used on the wire
+// and in reports.
+const char* CirculationErrorName(CirculationError error);
+
 // ---------- Generic result carriers (no exceptions required) ----------
 struct OperationResult {
     bool ok = false;
     std::string message; // non-empty on failure; optional human-readable info on success
+    CirculationError error = CirculationError::None; // typed reason when ok==false
 };
 
 template <typename T>
@@ -130,6 +196,7 @@ struct ValueResult {
     bool ok = false;
     std::optional<T> value; // engaged when ok==true
     std::string message;    // diagnostic if ok==false
+    CirculationError error = CirculationError::None; // typed reason when ok==false
 };
 
 } // namespace hinlibs
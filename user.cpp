@@ -1,6 +1,21 @@
 #include "user.h"
+#include "database.h"
 
 namespace hinlibs {
 
+const IdentityToken* User::identity() const {
+    if (!db_) return nullptr;
+
+    const auto generation = db_->UserGeneration();
+    if (!identity_ || identity_->generation != generation) {
+        auto rec = db_->GetUserById(id_);
+        if (!rec) {
+            identity_.reset();
+            return nullptr;
+        }
+        identity_ = IdentityToken{ std::move(*rec), generation };
+    }
+    return &*identity_;
+}
 
 } // namespace hinlibs
@@ -2,6 +2,7 @@
 
 #include "types.h"
 #include <memory>
+#include <optional>
 
 namespace hinlibs {
 
@@ -15,11 +16,20 @@ public:
 
     virtual Role role() const = 0;
 
+    // Cached identity; re-resolved only when the Database's user generation moves.
+    // Returns nullptr if the user no longer exists.
+    const IdentityToken* identity() const;
+
 protected:
     User(std::shared_ptr<Database> db, UserId id) : db_(std::move(db)), id_(std::move(id)) {}
+    User(std::shared_ptr<Database> db, IdentityToken identity)
+        : db_(std::move(db)), id_(identity.user.id), identity_(std::move(identity)) {}
 
     std::shared_ptr<Database> db_;
     UserId id_;
+
+private:
+    mutable std::optional<IdentityToken> identity_;
 };
 
 } // namespace hinlibs
@@ -0,0 +1,42 @@
+#include "usernameindex.h"
+
+#include <algorithm>
+
+namespace hinlibs {
+
+std::string FoldUsername(std::string username) {
+    for (auto& c : username) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return username;
+}
+
+void UsernameIndex::rebuild(std::vector<UserRecord> users) {
+    entries_.clear();
+    entries_.reserve(users.size());
+    for (auto& u : users) {
+        std::string key = FoldUsername(u.username);
+        entries_.push_back(Entry{ std::move(key), std::move(u) });
+    }
+    std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+        return a.key < b.key;
+    });
+}
+
+std::vector<UserRecord> UsernameIndex::complete(const std::string& prefix, std::size_t limit,
+                                                std::optional<Role> role) const {
+    std::vector<UserRecord> out;
+    if (limit == 0) return out;
+
+    const std::string key = FoldUsername(prefix);
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), key,
+                               [](const Entry& e, const std::string& k) { return e.key < k; });
+    for (; it != entries_.end() && out.size() < limit; ++it) {
+        if (it->key.compare(0, key.size(), key) != 0) break;   // past the prefix range
+        if (role && it->user.role != *role) continue;
+        out.push_back(it->user);
+    }
+    return out;
+}
+
+} // namespace hinlibs
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hinlibs {
+
+// Folds ASCII letters to lower case, as SQLite's NOCASE collation does.
+std::string FoldUsername(std::string username);
+
+// In-memory prefix index over usernames: a sorted array of case-folded keys,
+// searched with a binary search to the first match and a short forward scan.
+// Rebuilt wholesale from the users table (see Database::CompleteUsernames);
+// not thread-safe.
+class UsernameIndex {
+public:
+    void rebuild(std::vector<UserRecord> users);
+    void clear() { entries_.clear(); }
+
+    // Up to `limit` users whose username starts with `prefix` (case-
+    // insensitively), in username order, optionally only those with `role`.
+    std::vector<UserRecord> complete(const std::string& prefix, std::size_t limit,
+                                     std::optional<Role> role = std::nullopt) const;
+
+    std::size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        std::string key;    // folded username
+        UserRecord  user;
+    };
+    std::vector<Entry> entries_;
+};
+
+} // namespace hinlibs